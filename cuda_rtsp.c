@@ -1,17 +1,78 @@
 
+#define _GNU_SOURCE
 #include "cuda_rtsp.h"
+#ifdef CU_RTSP_HOST
+#include "cuda_rtsp_convert.h"
+#endif
+#include "cuda_rtsp_trace.h"
 
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
+#ifdef __linux__
+#include <linux/sockios.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <linux/tcp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#endif
 
 #define GST_USE_UNSTABLE_API 1
 #include <gst/gst.h>
 #include <gst/app/gstappsrc.h>
+#include <gst/video/video.h>
+#ifdef CU_RTSP_HOST
+#include <gst/video/gstvideopool.h>
+#else
 #include <gst/cuda/cuda-gst.h>
 #include <gst/cuda/gstcudabufferpool.h>
 #include <gst/cuda/gstcudamemory.h>
+#endif
 #include <gst/rtsp-server/rtsp-server.h>
 
+#ifdef CU_RTSP_HOST
+#define CU_RTSP_CAPS_FEATURE ""
+#define CU_RTSP_MAP_WRITE GST_MAP_WRITE
+#define CU_RTSP_MAP_READ GST_MAP_READ
+#else
+#define CU_RTSP_CAPS_FEATURE "(memory:CUDAMemory)"
+#define CU_RTSP_MAP_WRITE (GST_MAP_WRITE | GST_MAP_CUDA)
+#define CU_RTSP_MAP_READ (GST_MAP_READ | GST_MAP_CUDA)
+#endif
+
+#define CU_RTSP_PENDING_FRAMES 32
+
+#define CU_RTSP_DEFAULT_POOL_MIN 2
+
+#define CU_RTSP_DEFAULT_MCAST_PORT_MIN 5000
+#define CU_RTSP_DEFAULT_MCAST_PORT_MAX 5999
+#define CU_RTSP_DEFAULT_MCAST_TTL 1
+
+// loss in 1/256
+#define CU_RTSP_ABR_LOSS_HIGH 26
+#define CU_RTSP_ABR_LOSS_LOW 5
+#define CU_RTSP_ABR_DECREASE_INTERVAL (G_TIME_SPAN_SECOND / 2)
+#define CU_RTSP_ABR_INCREASE_INTERVAL (2 * G_TIME_SPAN_SECOND)
+// 20 ms in 1/65536 s
+#define CU_RTSP_ABR_QUEUE_DELAY 1311
+#define CU_RTSP_ABR_RECEIVER_TIMEOUT (10 * G_TIME_SPAN_SECOND)
+
+// UDP GSO limits
+#define CU_RTSP_GSO_SEGMENTS 64
+#define CU_RTSP_GSO_BYTES 65000
+
+#define CU_RTSP_DEFAULT_SEGMENT_SECONDS 60
+#define CU_RTSP_RECORD_QUEUE_TIME (2 * GST_SECOND)
+
+#define CU_RTSP_SNAPSHOT_TIMEOUT GST_SECOND
+
+// repeat interval when neither idleIntervalMs nor gopLength is set
+#define CU_RTSP_DEFAULT_IDLE_INTERVAL (5 * G_TIME_SPAN_SECOND)
+
+#define CU_RTSP_BACKPRESSURE_INTERVAL_MS 20
+
 const char *FORMATS[] = {
     "NV12",
     "YV12",
@@ -26,56 +87,788 @@ const char *FORMATS[] = {
     "RGB",
 };
 
+const char *PAYLOADERS[] = {
+    "rtph264pay",
+    "rtph265pay",
+    "rtpav1pay",
+};
+
+const char *PARSERS[] = {
+    "h264parse config-interval=-1",
+    "h265parse config-interval=-1",
+    "av1parse",
+};
+
+const char *ENCODED_CAPS[] = {
+    "video/x-h264,stream-format=byte-stream,alignment=au",
+    "video/x-h265,stream-format=byte-stream,alignment=au",
+    "video/x-av1,stream-format=obu-stream,alignment=tu",
+};
+
+const char *MUXERS[] = {
+    "mp4mux",
+    "mpegtsmux",
+};
+
+const char *AGGREGATE_MODES[] = {
+    NULL,
+    "none",
+    "zero-latency",
+    "max",
+};
+
+typedef struct CUrtsp_encoder_desc_st
+{
+    CUrtsp_codec codec;
+    CUrtsp_encoder type;
+    const char *element;
+    const char *bitrate;
+    unsigned int bitrate_scale;
+    const char *gop;
+    const char *bframes;
+    const char *rate_control;
+    const char *rate_control_values[4];
+    const char *preset;
+    const char *tune;
+    const char *low_latency_preset;
+    const char *low_latency_tune;
+} CUrtsp_encoder_desc;
+
+// in order of preference
+const CUrtsp_encoder_desc ENCODERS[] = {
+    {CU_RTSP_CODEC_H264, CU_RTSP_ENCODER_NVENC, "nvh264enc", "bitrate", 1, "gop-size", "bframes", "rc-mode", {NULL, "cbr", "vbr", "constqp"}, "preset", "tune", "low-latency-hp", "ultra-low-latency"},
+    {CU_RTSP_CODEC_H264, CU_RTSP_ENCODER_NVENC, "nvcudah264enc", "bitrate", 1, "gop-size", "b-frames", "rate-control", {NULL, "cbr", "vbr", "cqp"}, "preset", "tune", "p1", "ultra-low-latency"},
+    {CU_RTSP_CODEC_H265, CU_RTSP_ENCODER_NVENC, "nvh265enc", "bitrate", 1, "gop-size", "bframes", "rc-mode", {NULL, "cbr", "vbr", "constqp"}, "preset", "tune", "low-latency-hp", "ultra-low-latency"},
+    {CU_RTSP_CODEC_H265, CU_RTSP_ENCODER_NVENC, "nvcudah265enc", "bitrate", 1, "gop-size", "b-frames", "rate-control", {NULL, "cbr", "vbr", "cqp"}, "preset", "tune", "p1", "ultra-low-latency"},
+    {CU_RTSP_CODEC_AV1, CU_RTSP_ENCODER_NVENC, "nvav1enc", "bitrate", 1, "gop-size", "b-frames", "rate-control", {NULL, "cbr", "vbr", "cqp"}, "preset", "tune", "p1", "ultra-low-latency"},
+    {CU_RTSP_CODEC_H264, CU_RTSP_ENCODER_SOFTWARE, "x264enc", "bitrate", 1, "key-int-max", "bframes", "pass", {NULL, "cbr", "qual", "quant"}, "speed-preset", "tune", "ultrafast", "zerolatency"},
+    {CU_RTSP_CODEC_H264, CU_RTSP_ENCODER_SOFTWARE, "openh264enc", "bitrate", 1000, "gop-size", NULL, "rate-control", {NULL, "bitrate", NULL, NULL}, NULL, NULL, NULL, NULL},
+    {CU_RTSP_CODEC_H265, CU_RTSP_ENCODER_SOFTWARE, "x265enc", "bitrate", 1, "key-int-max", NULL, NULL, {NULL, NULL, NULL, NULL}, "speed-preset", "tune", "ultrafast", "zerolatency"},
+    {CU_RTSP_CODEC_AV1, CU_RTSP_ENCODER_SOFTWARE, "svtav1enc", "target-bitrate", 1, "intra-period-length", NULL, NULL, {NULL, NULL, NULL, NULL}, "preset", NULL, "12", NULL},
+    {CU_RTSP_CODEC_AV1, CU_RTSP_ENCODER_SOFTWARE, "rav1enc", "bitrate", 1000, "max-key-frame-interval", NULL, NULL, {NULL, NULL, NULL, NULL}, "speed-preset", NULL, "10", NULL},
+};
+
+GstCaps *CAPTURE_CAPS = NULL;
+
+GQuark FENCE_QUARK = 0;
+
+// wrappers and buffer pools per CUDA context
+GHashTable *DEVICES = NULL;
+GMutex DEVICES_LOCK;
+
 typedef struct CUrtsp_server_st
 {
     GMainContext *context;
     GMainLoop *loop;
     GstRTSPServer *gst_rtsp_server;
     int server_id;
+    bool external;
+    bool prepared;
+    gint max_priority;
+    GPollFD *poll_fds;
+    gint poll_count;
+    gint poll_capacity;
 } CUrtsp_server_st;
 
+// thread-enter is a class method, so pinning takes a subclass
+typedef struct CUrtsp_thread_pool_st
+{
+    GstRTSPThreadPool parent;
+    int *cpus;
+    size_t cpu_count;
+    size_t next_cpu;
+} CUrtsp_thread_pool_st;
+
+typedef struct CUrtsp_thread_pool_class_st
+{
+    GstRTSPThreadPoolClass parent_class;
+} CUrtsp_thread_pool_class_st;
+
+static GstRTSPThreadPoolClass *THREAD_POOL_PARENT = NULL;
+
+typedef struct CUrtsp_device_st
+{
+    CUcontext context;
+#ifndef CU_RTSP_HOST
+    GstContext *gst_context;
+    GstCudaContext *gst_cuda_context;
+#endif
+    GHashTable *pools;
+    size_t ref_count;
+} CUrtsp_device_st;
+
+typedef struct CUrtsp_pool_st
+{
+    GstBufferPool *pool;
+    size_t users;
+} CUrtsp_pool_st;
+
 typedef struct CUrtsp_session_st
 {
     CUDA_RTSP_SESSION session_info;
+    const CUrtsp_encoder_desc *encoder;
     GstRTSPMediaFactory *gst_rtsp_media_factory;
+    CUDA_RTSP_RENDITION *renditions;
+    GstRTSPMediaFactory **rendition_factories;
+    CUrtsp_device_st *device;
+#ifndef CU_RTSP_HOST
     GstContext *gst_context;
     GstCudaContext *gst_cuda_context;
+    GstCudaStream *gst_cuda_stream;
+#endif
+    CUstream cu_stream;
     GstBufferPool *cu_buffer_pool;
-    GstClockTime timestamp;
+#ifdef CU_RTSP_HOST
+    GstBufferPool *convert_pool;
+    GstVideoInfo convert_info;
+#endif
+    GstCaps *caps;
+    GstVideoInfo video_info;
+    gsize frame_size;
+    CUDA_RTSP_SESSION_STATS stats;
+    GMutex lock;
+    GCond cond;
+    GQueue frames;
+    bool resync;
+    GstBuffer *last_frame;
+    size_t media_count;
+    GstRTSPMedia *prewarmed;
+    gint ref_count;
+    gint destroyed;
+    size_t callbacks_active;
+    GList *mounts;
+    GList *medias;
+    GstBuffer *shared_frame;
+    gint64 shared_slot;
+    bool producing;
+    struct CUrtsp_mosaic_st *mosaic;
+    uint32_t trace_id;
+    GMutex snapshot_lock;
+    GstBuffer *snapshot;
+    GstCaps *snapshot_caps;
+    GstClockTime snapshot_capture;
+    size_t snapshot_width;
+    size_t snapshot_height;
 } CUrtsp_session_st;
 
+typedef struct CUrtsp_tile_st
+{
+    CUrtsp_session source;
+    size_t x;
+    size_t y;
+    GstBuffer *frame;
+    gint64 updated;
+} CUrtsp_tile_st;
+
+typedef struct CUrtsp_mosaic_st
+{
+    CUrtsp_session session;
+    GMutex lock;
+    CUrtsp_tile_st *tiles;
+    size_t tile_count;
+} CUrtsp_mosaic_st;
+
+typedef struct CUrtsp_mount_st
+{
+    GstRTSPServer *server;
+    gchar *path;
+    gchar **rendition_paths;
+} CUrtsp_mount_st;
+
+// written without a lock, pts is cleared while the other fields change
+typedef struct CUrtsp_pending_frame_st
+{
+    GstClockTime pts;
+    guint64 frame;
+    GstClockTime capture;
+    GstClockTime pushed;
+    gint encoded;
+} CUrtsp_pending_frame;
+
+typedef struct CUrtsp_traced_frame_st
+{
+    GstClockTime pts;
+    guint64 frame;
+} CUrtsp_traced_frame;
+
+typedef struct CUrtsp_receiver_st
+{
+    guint fraction_lost;
+    guint round_trip;
+    guint min_round_trip;
+    gint64 updated;
+} CUrtsp_receiver;
+
+typedef struct CUrtsp_trace_pad_st
+{
+    GstPad *pad;
+    gulong id;
+} CUrtsp_trace_pad;
+
+typedef struct CUrtsp_media_st
+{
+    CUrtsp_session session;
+    GstElement *bin;
+    GstElement *appsrc;
+    GstClockTime timestamp;
+    guint64 frame_count;
+    GMutex lock;
+    CUrtsp_pending_frame pending[CU_RTSP_PENDING_FRAMES];
+    GstClockTime duration;
+    GstClockTime join_start;
+    GstClockTime join_pts;
+    GstElement *encoder;
+    guint mtu;
+    unsigned int bitrate;
+    gint64 bitrate_changed;
+    GHashTable *receivers;
+    GstClockTime pts_base;
+    bool synced;
+    gint64 slot_offset;
+    bool slot_aligned;
+    uint32_t trace_id;
+    CUrtsp_traced_frame traced[CU_RTSP_PENDING_FRAMES];
+    uint64_t interleaved_bytes;
+    uint64_t interleaved_packets;
+    bool tracing;
+    GArray *trace_pads;
+    uint64_t payloaded;
+    GstClockTime payloaded_pts;
+    GList *resuming;
+} CUrtsp_media_st;
+
+typedef struct CUrtsp_trace_probe_st
+{
+    CUrtsp_media_st *media;
+    const char *name;
+    char phase;
+    GstClockTime last_pts;
+} CUrtsp_trace_probe;
+
+typedef struct CUrtsp_backpressure_st
+{
+    GstRTSPStreamTransport *transport;
+    struct CUrtsp_media_st *media;
+    bool throttled;
+    bool waiting;
+    gint64 since;
+    guint64 frame;
+    uint64_t queued;
+    uint64_t events;
+    uint64_t frames_skipped;
+    uint64_t seen_bytes;
+    uint64_t seen_packets;
+    uint64_t bytes_sent;
+    uint64_t packets_sent;
+} CUrtsp_backpressure_st;
+
+// a client's send queue measured from its own context
+typedef struct CUrtsp_client_queue_st
+{
+    GSource *source;
+    bool started;
+    uint64_t acked;
+    uint64_t handed;
+    uint64_t queued;
+    gint64 now;
+    bool disconnect;
+} CUrtsp_client_queue_st;
+
+typedef void (*CUrtspTransportFunc)(
+    CUrtsp_session hSession,
+    GstRTSPMedia *media,
+    GstRTSPStreamTransport *transport,
+    CUrtsp_client_queue_st *queue);
+
+// shared by a buffer and its copies, each holder waits before it lets go
+typedef struct CUrtsp_fence_st
+{
+    CUcontext context;
+    CUevent event;
+    gint ref_count;
+} CUrtsp_fence_st;
+
+typedef struct CUrtsp_release_st
+{
+    CUrtspReleaseCallback callback;
+    void *user_data;
+} CUrtsp_release_st;
+
 // error buffer
 char current_error[256];
 
 // set contents of error buffer
 static void cuRTSPSetError(const char *format, ...);
 
+// register the pinning thread pool on first use
+static GType cuRTSPThreadPoolGetType(void);
+
+static void cuRTSPThreadPoolClassInit(
+    gpointer klass,
+    gpointer class_data);
+
+static void cuRTSPThreadPoolFinalize(
+    GObject *object);
+
+// pin a client thread to the next configured CPU, runs on the new thread
+static void cuRTSPThreadPoolThreadEnter(
+    GstRTSPThreadPool *pool,
+    GstRTSPThread *thread);
+
 // check if video format requires cudaconvert element
 static bool cuRTSPSessionNeedsConvert(CUrtsp_format format);
 
+#ifdef CU_RTSP_HOST
+// pool frames in the encoder's format, NULL when no conversion is needed
+static GstBufferPool *cuRTSPSessionConvertPool(
+    CUrtsp_session hSession,
+    const CUDA_RTSP_SESSION *pSessionInfo,
+    GstCaps **pCaps,
+    GstVideoInfo *pConvertInfo);
+
+// convert a frame into the convert pool, consumes the source
+static GstBuffer *cuRTSPSessionConvertBuffer(
+    CUrtsp_session hSession,
+    GstBuffer *buffer);
+#endif
+
+// pick the first installed encoder for a codec
+static const CUrtsp_encoder_desc *cuRTSPEncoderFind(CUrtsp_codec codec, CUrtsp_encoder type);
+
+// check that an encoder accepts the session's tuning
+static bool cuRTSPEncoderCheck(const CUrtsp_encoder_desc *encoder, const CUDA_RTSP_ENCODER *pEncoder, bool lowLatency);
+
+static bool cuRTSPEncoderCheckProperty(GstElement *element, const CUrtsp_encoder_desc *encoder, const char *what, const char *name, const char *value, bool required);
+
+// apply session tuning to an encoder element
+static void cuRTSPEncoderConfigure(GstElement *element, const CUrtsp_encoder_desc *encoder, const CUDA_RTSP_ENCODER *pEncoder, bool lowLatency);
+
+// set a property only if the element implements it
+static void cuRTSPElementSet(GstElement *element, const char *name, const char *value);
+
+static void cuRTSPEncoderSetBitrate(GstElement *element, const CUrtsp_encoder_desc *encoder, unsigned int bitrate);
+
+// launch description of a session or rendition pipeline
+static gchar *cuRTSPSessionLaunch(CUrtsp_session hSession, const CUDA_RTSP_RENDITION *pRendition);
+
+// append the elements from appsrc up to and including the encoder
+static void cuRTSPSessionLaunchRaw(CUrtsp_session hSession, const CUDA_RTSP_RENDITION *pRendition, GString *launch);
+
+// media factory for the session or one of its renditions
+static GstRTSPMediaFactory *cuRTSPSessionFactory(
+    CUrtsp_session hSession,
+    const CUDA_RTSP_SESSION *pCreateSession,
+    GstRTSPAddressPool *address_pool,
+    const CUDA_RTSP_RENDITION *pRendition);
+
+static GstCaps *cuRTSPSessionCaps(const CUDA_RTSP_SESSION *pSessionInfo);
+
+// address pool for a multicast configuration, NULL if the range is invalid
+static GstRTSPAddressPool *cuRTSPAddressPool(const CUDA_RTSP_MULTICAST *pMulticast);
+
+// take a pool for caps from the device arena
+static GstBufferPool *cuRTSPSessionPool(CUrtsp_session hSession, GstCaps *caps, gsize size);
+
+static void cuRTSPSessionPoolRelease(CUrtsp_session hSession, GstBufferPool *pool);
+
+// look up or wrap the resources of a CUDA context
+static CUrtsp_device_st *cuRTSPDeviceAcquire(CUdevice device, CUcontext context);
+
+static void cuRTSPDeviceRelease(CUrtsp_device_st *device);
+
+static void cuRTSPPoolFree(CUrtsp_pool_st *pool);
+
+// media keep their session alive until the last one is finalized
+static void cuRTSPSessionRef(CUrtsp_session hSession);
+
+static void cuRTSPSessionUnref(CUrtsp_session hSession);
+
+static void cuRTSPSessionFree(CUrtsp_session hSession);
+
+static void cuRTSPMountRemove(CUrtsp_mount_st *mount);
+
 static void cuRTSPSessionConfigure(
     GstRTSPMediaFactory *factory,
     GstRTSPMedia *media,
     CUrtsp_session hSession);
 
+static void cuRTSPSessionUnprepared(
+    GstRTSPMedia *media,
+    CUrtsp_session hSession);
+
+// a recording media keeps playing when its last client leaves
+static void cuRTSPMediaNewState(
+    GstRTSPMedia *media,
+    gint state,
+    CUrtsp_session hSession);
+
+static void cuRTSPMediaFree(
+    CUrtsp_media_st *media);
+
+// the slot a timestamp maps to, consecutive frames take consecutive slots
+static CUrtsp_pending_frame *cuRTSPMediaPendingSlot(
+    CUrtsp_media_st *media,
+    GstClockTime pts);
+
+// remember when a frame was captured until its first packet is payloaded
+static void cuRTSPMediaTrackFrame(
+    CUrtsp_media_st *media,
+    GstClockTime pts,
+    GstClockTime capture);
+
+// wait for the producer's stream before a frame leaves the fence queue
+static GstPadProbeReturn cuRTSPMediaFenced(
+    GstPad *pad,
+    GstPadProbeInfo *info,
+    CUrtsp_media_st *media);
+
+// measure time spent between appsrc and encoder output
+static GstPadProbeReturn cuRTSPMediaEncoded(
+    GstPad *pad,
+    GstPadProbeInfo *info,
+    CUrtsp_media_st *media);
+
+// report capture-to-packet latency of each frame
+static GstPadProbeReturn cuRTSPMediaPayloaded(
+    GstPad *pad,
+    GstPadProbeInfo *info,
+    CUrtsp_media_st *media);
+
+// activate transports waiting for a key unit
+static void cuRTSPMediaResume(
+    CUrtsp_media_st *media);
+
+// install the trace probes when a trace starts and remove them when it ends
+static void cuRTSPMediaTraceUpdate(
+    CUrtsp_media_st *media);
+
+static void cuRTSPMediaTraceElements(
+    CUrtsp_media_st *media);
+
+static void cuRTSPMediaTraceRemove(
+    CUrtsp_media_st *media);
+
+// install the trace probes again on a prepared media
+static void cuRTSPMediaTraceUnprepared(
+    GstRTSPMedia *media,
+    CUrtsp_media_st *media_state);
+
+static void cuRTSPMediaTraceProbe(
+    CUrtsp_media_st *media,
+    GstElement *element,
+    const char *pad_name,
+    char phase);
+
+static GstPadProbeReturn cuRTSPMediaTraced(
+    GstPad *pad,
+    GstPadProbeInfo *info,
+    CUrtsp_trace_probe *probe);
+
+static void cuRTSPMediaTraceFrame(
+    CUrtsp_media_st *media,
+    GstClockTime pts,
+    guint64 frame);
+
+static bool cuRTSPMediaTracedFrame(
+    CUrtsp_media_st *media,
+    GstClockTime pts,
+    guint64 *pFrame);
+
+// watch the RTP sessions of a prepared media for receiver reports
+static void cuRTSPMediaPrepared(
+    GstRTSPMedia *media,
+    CUrtsp_media_st *media_state);
+
+// adapt the encoder bitrate to loss and delay seen by a receiver
+static void cuRTSPMediaFeedback(
+    GObject *rtp_session,
+    GObject *source,
+    CUrtsp_media_st *media);
+
+// find the state attached to a media by its session, if any
+static CUrtsp_media_st *cuRTSPMediaState(GstRTSPMedia *media);
+
+// find the session that configured a media, if any
+static CUrtsp_session cuRTSPMediaSession(GstRTSPMedia *media);
+
+static void cuRTSPServerClientConnected(
+    GstRTSPServer *server,
+    GstRTSPClient *client,
+    CUrtsp_server hServer);
+
+// remember when a client asked for the stream description
+static void cuRTSPClientDescribe(
+    GstRTSPClient *client,
+    GstRTSPContext *ctx,
+    gpointer user_data);
+
+// start the join measurement and force a key unit
+static void cuRTSPClientPlay(
+    GstRTSPClient *client,
+    GstRTSPContext *ctx,
+    CUrtsp_server hServer);
+
+static void cuRTSPMediaForceKeyUnit(GstRTSPMedia *media);
+
+// send runs of full packets as UDP GSO datagrams
+static void cuRTSPMediaOffload(
+    GstRTSPMedia *media,
+    CUrtsp_media_st *media_state);
+
+// true when socket is a stream's RTP socket and took the segment size
+static bool cuRTSPMediaOffloadSocket(
+    GstRTSPMedia *media,
+    GSocket *socket,
+    int segment);
+
+// coalesce runs of mtu-sized packets without copying
+static GstPadProbeReturn cuRTSPMediaOffloaded(
+    GstPad *pad,
+    GstPadProbeInfo *info,
+    gpointer user_data);
+
+// count what the interleaved sinks of a media hand to their clients
+static void cuRTSPMediaCountInterleaved(
+    GstRTSPMedia *media,
+    CUrtsp_media_st *media_state);
+
+static GstPadProbeReturn cuRTSPMediaInterleaved(
+    GstPad *pad,
+    GstPadProbeInfo *info,
+    CUrtsp_media_st *media);
+
+// start measuring a client's send queue in its own context
+static void cuRTSPClientBackpressureStart(
+    GstRTSPClient *client,
+    GMainContext *context);
+
+static void cuRTSPClientBackpressureFree(
+    CUrtsp_client_queue_st *queue);
+
+static void cuRTSPClientClosed(
+    GstRTSPClient *client,
+    gpointer user_data);
+
+// measure a client's send queue and apply each transport's policy
+static gboolean cuRTSPClientBackpressure(
+    GstRTSPClient *client);
+
+// call func for each interleaved transport of a session with a send queue limit
+static void cuRTSPClientTransports(
+    GstRTSPClient *client,
+    CUrtspTransportFunc func,
+    CUrtsp_client_queue_st *queue);
+
+// the state of an interleaved transport, created when it starts to play
+static CUrtsp_backpressure_st *cuRTSPTransportTrack(
+    GstRTSPMedia *media,
+    GstRTSPStreamTransport *transport);
+
+static void cuRTSPTransportForget(
+    CUrtsp_backpressure_st *state);
+
+// add what the media handed to an active transport since the last measurement
+static void cuRTSPTransportHanded(
+    CUrtsp_session hSession,
+    GstRTSPMedia *media,
+    GstRTSPStreamTransport *transport,
+    CUrtsp_client_queue_st *queue);
+
+// apply the session's policy, sets disconnect when the client has to be closed
+static void cuRTSPTransportBackpressure(
+    CUrtsp_session hSession,
+    GstRTSPMedia *media,
+    GstRTSPStreamTransport *transport,
+    CUrtsp_client_queue_st *queue);
+
+// first buffer of a buffer or buffer list probe
+static GstBuffer *cuRTSPProbeBuffer(GstPadProbeInfo *info);
+
+// relaxed atomics, safe from the streaming threads
+static void cuRTSPCounterAdd(uint64_t *counter, uint64_t value);
+
+static void cuRTSPHistogramAdd(CUDA_RTSP_HISTOGRAM *histogram, uint64_t value);
+
+static void cuRTSPHistogramCopy(CUDA_RTSP_HISTOGRAM *dst, const CUDA_RTSP_HISTOGRAM *src);
+
+// fill client statistics from the RTP session serving a transport
+static void cuRTSPClientStatsFill(
+    CUDA_RTSP_CLIENT_STATS *pStats,
+    const char *address,
+    GstRTSPMedia *media,
+    GstRTSPStreamTransport *transport);
+
+// what the UDP sink sent to the transport's destination
+static void cuRTSPClientStatsUdp(
+    CUDA_RTSP_CLIENT_STATS *pStats,
+    GstRTSPMedia *media,
+    const GstRTSPTransport *rtsp_transport);
+
+// acquire a pool buffer and fill it through a write, update or stream callback
+static GstBuffer *cuRTSPSessionWriteBuffer(
+    CUrtsp_session hSession,
+    CUrtspWriteCallback writeCallback,
+    CUrtspUpdateCallback updateCallback,
+    CUrtspStreamCallback streamCallback,
+    void *userData,
+    CUrtsp_frame_status *pStatus);
+
+// record an event after the work queued on the session stream
+static void cuRTSPBufferFence(
+    CUrtsp_session hSession,
+    GstBuffer *buffer);
+
+// wait for the event and drop one reference
+static void cuRTSPFenceRelease(
+    gpointer user_data);
+
+// gst_buffer_make_writable drops qdata, fence the copy again
+static GstBuffer *cuRTSPBufferMakeWritable(
+    GstBuffer *buffer);
+
+// another reference to a buffer's fence, NULL when it has none
+static CUrtsp_fence_st *cuRTSPBufferFenceRef(
+    GstBuffer *buffer);
+
+// copy the last frame for another frame period, caller holds the session lock
+static GstBuffer *cuRTSPSessionRepeatFrame(
+    CUrtsp_session hSession);
+
+// how long a frame is held before it is repeated
+static gint64 cuRTSPSessionIdleInterval(
+    CUrtsp_session hSession,
+    gint64 interval);
+
+// call the producer until it has a new frame or the idle interval ran out
+static GstBuffer *cuRTSPSessionPollFrame(
+    CUrtsp_media_st *media,
+    GstElement *appsrc);
+
+// hand a frame to the push ring, applying the queue policy while it is full
+static void cuRTSPSessionEnqueue(
+    CUrtsp_session hSession,
+    GstBuffer *buffer);
+
+// return external memory to the application once the last buffer is gone
+static void cuRTSPFrameRelease(
+    gpointer user_data);
+
+// take the next queued frame, repeating the last one if the producer is late
+static GstBuffer *cuRTSPSessionPopFrame(
+    CUrtsp_media_st *media,
+    GstElement *appsrc);
+
+// check a layout and take references on its sources
+static CUresult cuRTSPMosaicTiles(
+    const char *caller,
+    const CUDA_RTSP_SESSION *pMosaicInfo,
+    const CUDA_RTSP_TILE *pTiles,
+    size_t tileCount,
+    CUrtsp_tile_st **pResult);
+
+static void cuRTSPMosaicTilesFree(
+    CUrtsp_tile_st *tiles,
+    size_t tile_count);
+
+static void cuRTSPMosaicFree(
+    CUrtsp_mosaic_st *mosaic);
+
+// refresh due tiles and draw every tile into the mosaic
+static void CUDA_CB cuRTSPMosaicWrite(
+    CUdeviceptr data,
+    size_t size,
+    void *userData);
+
+// newest frame of a source, without taking it from its clients
+static GstBuffer *cuRTSPMosaicSourceFrame(
+    CUrtsp_session source);
+
+static void cuRTSPMosaicDraw(
+    CUdeviceptr data,
+    const GstVideoInfo *mosaic_info,
+    const CUrtsp_tile_st *tile);
+
+// produce the next frame from the push ring or the producer callbacks
+static GstBuffer *cuRTSPSessionNextFrame(
+    CUrtsp_media_st *media,
+    GstElement *appsrc);
+
+// reuse the frame produced for this frame period, or produce it
+static GstBuffer *cuRTSPSessionShareFrame(
+    CUrtsp_media_st *media,
+    GstElement *appsrc);
+
+// wait a frame period, false once the media stops streaming
+static bool cuRTSPMediaRetry(
+    CUrtsp_media_st *media,
+    GstElement *appsrc);
+
 static void cuRTSPSessionPushBuffer(
     GstElement *appsrc,
     guint unused,
-    CUrtsp_session hSession);
+    CUrtsp_media_st *media);
 
-static void cuRTSPSessionDestroy(
-    CUrtsp_session hSession);
+// cached JPEG of the newest frame, called with the snapshot lock held
+static GstBuffer *cuRTSPSessionSnapshot(
+    CUrtsp_session hSession,
+    size_t width,
+    size_t height);
+
+// newest frame and its caps, pCaps may be NULL
+static GstBuffer *cuRTSPSessionNewestFrame(
+    CUrtsp_session hSession,
+    GstCaps **pCaps);
 
-void cuRTSPInit()
+static GstBuffer *cuRTSPSessionSnapshotEncode(
+    CUrtsp_session hSession,
+    GstBuffer *frame,
+    GstCaps *caps,
+    size_t width,
+    size_t height);
+
+CUresult cuRTSPInit()
 {
-    assert(cuInit(0) == CUDA_SUCCESS);
+    CUresult result;
+
+    result = cuInit(0);
+    if (result != CUDA_SUCCESS)
+    {
+        cuRTSPSetError("cuRTSPInit: cuInit failed");
+        goto done;
+    }
+
     gst_init(NULL, NULL);
-    assert(gst_cuda_load_library() == TRUE);
+    if (CAPTURE_CAPS == NULL)
+    {
+        CAPTURE_CAPS = gst_caps_new_empty_simple("timestamp/x-cu-rtsp-capture");
+    }
+    FENCE_QUARK = g_quark_from_static_string("cu-rtsp-fence");
+    if (DEVICES == NULL)
+    {
+        DEVICES = g_hash_table_new(g_direct_hash, g_direct_equal);
+    }
+#ifndef CU_RTSP_HOST
+    if (gst_cuda_load_library() != TRUE)
+    {
+        result = CUDA_ERROR_NOT_INITIALIZED;
+        cuRTSPSetError("cuRTSPInit: failed to load CUDA library");
+        goto done;
+    }
     gst_cuda_memory_init_once();
+#endif
+done:
+    return result;
 }
 
 void cuRTSPDeinit()
 {
+    gst_caps_replace(&CAPTURE_CAPS, NULL);
+    if (DEVICES != NULL)
+    {
+        g_hash_table_destroy(DEVICES);
+        DEVICES = NULL;
+    }
+    gst_rtsp_thread_pool_cleanup();
     gst_deinit();
 }
 
@@ -90,9 +883,68 @@ const char *cuRTSPGetError()
     return result;
 }
 
+CUresult cuRTSPTraceStart(const char *path, size_t maxEvents)
+{
+    CUresult result;
+    FILE *file;
+
+    result = CUDA_SUCCESS;
+
+    if (path == NULL)
+    {
+        cuRTSPSetError("cuRTSPTraceStart: path cannot be NULL");
+        goto error;
+    }
+
+    file = fopen(path, "w");
+    if (file == NULL)
+    {
+        cuRTSPSetError("cuRTSPTraceStart: failed to open %s", path);
+        goto error;
+    }
+
+    if (!cuRTSPTraceBegin(file, maxEvents))
+    {
+        fclose(file);
+        result = CUDA_ERROR_NOT_READY;
+        cuRTSPSetError("cuRTSPTraceStart: a trace is already recording");
+    }
+    goto done;
+error:
+    result = CUDA_ERROR_INVALID_VALUE;
+done:
+    return result;
+}
+
+CUresult cuRTSPTraceStop()
+{
+    CUresult result;
+    FILE *file;
+
+    result = CUDA_SUCCESS;
+
+    file = cuRTSPTraceEnd();
+    if (file == NULL)
+    {
+        result = CUDA_ERROR_NOT_READY;
+        cuRTSPSetError("cuRTSPTraceStop: no trace is recording");
+        goto done;
+    }
+
+    if (ferror(file) != 0 || fclose(file) != 0)
+    {
+        result = CUDA_ERROR_UNKNOWN;
+        cuRTSPSetError("cuRTSPTraceStop: failed to write trace");
+    }
+done:
+    return result;
+}
+
 CUresult cuRTSPServerCreate(CUrtsp_server *pServer, const CUDA_RTSP_SERVER *pCreateServer)
 {
     CUresult result;
+    GstRTSPThreadPool *thread_pool;
+    CUrtsp_thread_pool_st *pinning_pool;
     char service[7];
 
     result = CUDA_SUCCESS;
@@ -107,6 +959,7 @@ CUresult cuRTSPServerCreate(CUrtsp_server *pServer, const CUDA_RTSP_SERVER *pCre
     (*pServer) = calloc(1, sizeof(struct CUrtsp_server_st));
     (*pServer)->loop = NULL;
     (*pServer)->gst_rtsp_server = gst_rtsp_server_new();
+    g_signal_connect((*pServer)->gst_rtsp_server, "client-connected", (GCallback)cuRTSPServerClientConnected, *pServer);
     if (pCreateServer != NULL && pCreateServer->port != CU_RTSP_DEFAULT_PORT)
     {
         if (pCreateServer->port < 1 || pCreateServer->port > 65535)
@@ -119,6 +972,35 @@ CUresult cuRTSPServerCreate(CUrtsp_server *pServer, const CUDA_RTSP_SERVER *pCre
         gst_rtsp_server_set_service((*pServer)->gst_rtsp_server, service);
     }
 
+    if (pCreateServer != NULL && pCreateServer->cpuCount > 0 && pCreateServer->cpus == NULL)
+    {
+        result = CUDA_ERROR_INVALID_VALUE;
+        cuRTSPSetError("cuRTSPServerCreate: cpus cannot be NULL when cpuCount is non-zero");
+        goto error;
+    }
+
+    if (pCreateServer != NULL && (pCreateServer->clientThreads > 0 || pCreateServer->cpuCount > 0))
+    {
+        if (pCreateServer->cpuCount > 0)
+        {
+            thread_pool = g_object_new(cuRTSPThreadPoolGetType(), NULL);
+            pinning_pool = (CUrtsp_thread_pool_st *)thread_pool;
+            pinning_pool->cpus = g_new(int, pCreateServer->cpuCount);
+            memcpy(pinning_pool->cpus, pCreateServer->cpus, pCreateServer->cpuCount * sizeof(int));
+            pinning_pool->cpu_count = pCreateServer->cpuCount;
+            gst_rtsp_server_set_thread_pool((*pServer)->gst_rtsp_server, thread_pool);
+        }
+        else
+        {
+            thread_pool = gst_rtsp_server_get_thread_pool((*pServer)->gst_rtsp_server);
+        }
+        if (pCreateServer->clientThreads > 0)
+        {
+            gst_rtsp_thread_pool_set_max_threads(thread_pool, (gint)pCreateServer->clientThreads);
+        }
+        g_object_unref(thread_pool);
+    }
+
     goto done;
 error:
     if ((*pServer) != NULL)
@@ -131,12 +1013,31 @@ done:
 
 void cuRTSPServerDestroy(CUrtsp_server hServer)
 {
+    GSource *source;
+
     if (hServer != NULL)
     {
+        if (hServer->external)
+        {
+            if (hServer->prepared)
+            {
+                g_main_context_release(hServer->context);
+            }
+            source = g_main_context_find_source_by_id(hServer->context, hServer->server_id);
+            if (source != NULL)
+            {
+                g_source_destroy(source);
+            }
+        }
         if (hServer->gst_rtsp_server != NULL)
         {
             gst_object_unref(hServer->gst_rtsp_server);
         }
+        if (hServer->external)
+        {
+            g_main_context_unref(hServer->context);
+        }
+        g_free(hServer->poll_fds);
         free(hServer);
     }
 }
@@ -174,20 +1075,229 @@ void cuRTSPServerDispatch(CUrtsp_server hServer)
 
 void cuRTSPServerShutdown(CUrtsp_server hServer)
 {
-    g_main_loop_quit(hServer->loop);
+    if (hServer->loop != NULL)
+    {
+        g_main_loop_quit(hServer->loop);
+    }
 }
 
-CUresult cuRTSPSessionCreate(CUrtsp_session *pSession, const CUDA_RTSP_SESSION *pCreateSession)
+CUresult cuRTSPServerAttachExternal(CUrtsp_server hServer)
 {
-    const char *launch_string_no_convert = "( appsrc name=source ! nvh264enc ! rtph264pay name=pay0 pt=96 )";
-    const char *launch_string_with_convert = "( appsrc name=source ! cudaconvert ! nvh264enc ! rtph264pay name=pay0 pt=96 )";
     CUresult result;
-    GstStructure *s;
-    gint device_id;
-    const char *launch_string;
 
     result = CUDA_SUCCESS;
 
+    if (hServer == NULL)
+    {
+        cuRTSPSetError("cuRTSPServerAttachExternal: hServer cannot be NULL");
+        goto error;
+    }
+
+    if (hServer->server_id != 0)
+    {
+        cuRTSPSetError("cuRTSPServerAttachExternal: server is already attached");
+        goto error;
+    }
+
+    hServer->context = g_main_context_new();
+    hServer->external = true;
+    hServer->server_id = gst_rtsp_server_attach(hServer->gst_rtsp_server, hServer->context);
+    if (hServer->server_id == 0)
+    {
+        result = CUDA_ERROR_NOT_READY;
+        cuRTSPSetError("cuRTSPServerAttachExternal: failed to listen");
+    }
+    goto done;
+error:
+    result = CUDA_ERROR_INVALID_VALUE;
+done:
+    return result;
+}
+
+CUresult cuRTSPServerPrepare(CUrtsp_server hServer, CUDA_RTSP_POLLFD *pFds, size_t *pCount, int *pTimeoutMs)
+{
+    CUresult result;
+    gint timeout;
+    gint index;
+
+    result = CUDA_SUCCESS;
+
+    if (hServer == NULL || !hServer->external)
+    {
+        cuRTSPSetError("cuRTSPServerPrepare: hServer must be attached with cuRTSPServerAttachExternal");
+        goto error;
+    }
+
+    if (pCount == NULL || pTimeoutMs == NULL || (pFds == NULL && *pCount > 0))
+    {
+        cuRTSPSetError("cuRTSPServerPrepare: pCount and pTimeoutMs cannot be NULL");
+        goto error;
+    }
+
+    // a second prepare without an iterate starts the iteration over
+    if (!hServer->prepared)
+    {
+        if (!g_main_context_acquire(hServer->context))
+        {
+            result = CUDA_ERROR_NOT_READY;
+            cuRTSPSetError("cuRTSPServerPrepare: context is owned by another thread");
+            goto done;
+        }
+        hServer->prepared = true;
+    }
+    g_main_context_prepare(hServer->context, &hServer->max_priority);
+    while ((hServer->poll_count = g_main_context_query(hServer->context, hServer->max_priority, &timeout, hServer->poll_fds, hServer->poll_capacity)) > hServer->poll_capacity)
+    {
+        hServer->poll_capacity = hServer->poll_count;
+        hServer->poll_fds = g_renew(GPollFD, hServer->poll_fds, hServer->poll_capacity);
+    }
+
+    if ((size_t)hServer->poll_count > *pCount)
+    {
+        *pCount = hServer->poll_count;
+        result = CUDA_ERROR_INVALID_VALUE;
+        cuRTSPSetError("cuRTSPServerPrepare: %d descriptors do not fit", hServer->poll_count);
+        goto done;
+    }
+
+    for (index = 0; index < hServer->poll_count; index++)
+    {
+        pFds[index].fd = hServer->poll_fds[index].fd;
+        pFds[index].events = hServer->poll_fds[index].events;
+        pFds[index].revents = 0;
+    }
+    *pCount = hServer->poll_count;
+    *pTimeoutMs = timeout;
+    goto done;
+error:
+    result = CUDA_ERROR_INVALID_VALUE;
+done:
+    return result;
+}
+
+CUresult cuRTSPServerIterate(CUrtsp_server hServer, const CUDA_RTSP_POLLFD *pFds, size_t count)
+{
+    CUresult result;
+    gint index;
+
+    result = CUDA_SUCCESS;
+
+    if (hServer == NULL || !hServer->prepared)
+    {
+        cuRTSPSetError("cuRTSPServerIterate: cuRTSPServerPrepare must come first");
+        goto error;
+    }
+
+    if (count != (size_t)hServer->poll_count || (pFds == NULL && count > 0))
+    {
+        cuRTSPSetError("cuRTSPServerIterate: descriptors do not match the last prepare");
+        goto error;
+    }
+
+    for (index = 0; index < hServer->poll_count; index++)
+    {
+        hServer->poll_fds[index].revents = pFds[index].revents;
+    }
+    if (g_main_context_check(hServer->context, hServer->max_priority, hServer->poll_fds, hServer->poll_count))
+    {
+        g_main_context_dispatch(hServer->context);
+    }
+    g_main_context_release(hServer->context);
+    hServer->prepared = false;
+    goto done;
+error:
+    result = CUDA_ERROR_INVALID_VALUE;
+done:
+    return result;
+}
+
+CUresult cuRTSPServerGetStats(CUrtsp_server hServer, CUDA_RTSP_CLIENT_STATS *pStats, size_t *pCount)
+{
+    CUresult result;
+    GList *clients;
+    GList *sessions;
+    GList *medias;
+    GList *client_iter;
+    GList *session_iter;
+    GList *media_iter;
+    GPtrArray *transports;
+    GstRTSPConnection *connection;
+    GstRTSPMedia *media;
+    const char *address;
+    size_t count;
+    guint index;
+
+    result = CUDA_SUCCESS;
+
+    if (hServer == NULL)
+    {
+        cuRTSPSetError("cuRTSPServerGetStats: hServer cannot be NULL");
+        goto error;
+    }
+
+    if (pCount == NULL)
+    {
+        cuRTSPSetError("cuRTSPServerGetStats: pCount cannot be NULL");
+        goto error;
+    }
+
+    count = 0;
+    clients = gst_rtsp_server_client_filter(hServer->gst_rtsp_server, NULL, NULL);
+    for (client_iter = clients; client_iter != NULL; client_iter = client_iter->next)
+    {
+        connection = gst_rtsp_client_get_connection(GST_RTSP_CLIENT(client_iter->data));
+        address = (connection != NULL) ? gst_rtsp_connection_get_ip(connection) : NULL;
+        sessions = gst_rtsp_client_session_filter(GST_RTSP_CLIENT(client_iter->data), NULL, NULL);
+        for (session_iter = sessions; session_iter != NULL; session_iter = session_iter->next)
+        {
+            medias = gst_rtsp_session_filter(GST_RTSP_SESSION(session_iter->data), NULL, NULL);
+            for (media_iter = medias; media_iter != NULL; media_iter = media_iter->next)
+            {
+                media = gst_rtsp_session_media_get_media(GST_RTSP_SESSION_MEDIA(media_iter->data));
+                transports = gst_rtsp_session_media_get_transports(GST_RTSP_SESSION_MEDIA(media_iter->data));
+                for (index = 0; transports != NULL && index < transports->len; index++)
+                {
+                    if (g_ptr_array_index(transports, index) == NULL)
+                    {
+                        continue;
+                    }
+                    if (pStats != NULL && count < *pCount)
+                    {
+                        memset(&pStats[count], 0, sizeof(CUDA_RTSP_CLIENT_STATS));
+                        pStats[count].session = cuRTSPMediaSession(media);
+                        cuRTSPClientStatsFill(&pStats[count], address, media, g_ptr_array_index(transports, index));
+                    }
+                    count++;
+                }
+                if (transports != NULL)
+                {
+                    g_ptr_array_unref(transports);
+                }
+            }
+            g_list_free_full(medias, g_object_unref);
+        }
+        g_list_free_full(sessions, g_object_unref);
+    }
+    g_list_free_full(clients, g_object_unref);
+    *pCount = count;
+    goto done;
+error:
+    result = CUDA_ERROR_INVALID_VALUE;
+done:
+    return result;
+}
+
+CUresult cuRTSPSessionCreate(CUrtsp_session *pSession, const CUDA_RTSP_SESSION *pCreateSession)
+{
+    const CUrtsp_encoder_desc *encoder;
+    CUresult result;
+    GstVideoInfo video_info;
+    GstRTSPAddressPool *address_pool;
+    size_t index;
+
+    result = CUDA_SUCCESS;
+    address_pool = NULL;
+
     if (pSession == NULL)
     {
         cuRTSPSetError("cuRTSPSessionCreate: pSession cannot be NULL");
@@ -200,16 +1310,95 @@ CUresult cuRTSPSessionCreate(CUrtsp_session *pSession, const CUDA_RTSP_SESSION *
         goto error;
     }
 
-    if (cuRTSPSessionNeedsConvert(pCreateSession->format))
+    if (pCreateSession->input == CU_RTSP_INPUT_CALLBACK && pCreateSession->writeCallback == NULL && pCreateSession->updateCallback == NULL && pCreateSession->streamCallback == NULL)
     {
-        launch_string = launch_string_with_convert;
+        cuRTSPSetError("cuRTSPSessionCreate: writeCallback, updateCallback and streamCallback cannot all be NULL");
+        goto error;
     }
-    else
+
+    if (pCreateSession->fpsNum == 0 || pCreateSession->fpsDen == 0)
+    {
+        cuRTSPSetError("cuRTSPSessionCreate: frame rate cannot be zero");
+        goto error;
+    }
+
+    if (pCreateSession->aggregateMode > CU_RTSP_AGGREGATE_MAX)
+    {
+        cuRTSPSetError("cuRTSPSessionCreate: invalid aggregateMode");
+        goto error;
+    }
+
+    if (pCreateSession->backpressure.policy > CU_RTSP_BACKPRESSURE_DISCONNECT)
+    {
+        cuRTSPSetError("cuRTSPSessionCreate: invalid backpressure policy");
+        goto error;
+    }
+
+    if (pCreateSession->poolMax > 0 && pCreateSession->poolMax < pCreateSession->poolMin)
+    {
+        cuRTSPSetError("cuRTSPSessionCreate: poolMax cannot be less than poolMin");
+        goto error;
+    }
+
+    if (pCreateSession->encoder.maxBitrate > 0 && pCreateSession->encoder.maxBitrate < pCreateSession->encoder.minBitrate)
+    {
+        cuRTSPSetError("cuRTSPSessionCreate: maxBitrate cannot be less than minBitrate");
+        goto error;
+    }
+
+    if (pCreateSession->encoder.codec > CU_RTSP_CODEC_AV1 || pCreateSession->encoder.encoder > CU_RTSP_ENCODER_SOFTWARE)
+    {
+        cuRTSPSetError("cuRTSPSessionCreate: invalid encoder settings");
+        goto error;
+    }
+
+    encoder = (pCreateSession->input == CU_RTSP_INPUT_ENCODED) ? NULL : cuRTSPEncoderFind(pCreateSession->encoder.codec, pCreateSession->encoder.encoder);
+    if (encoder == NULL && pCreateSession->input != CU_RTSP_INPUT_ENCODED)
+    {
+        cuRTSPSetError("cuRTSPSessionCreate: no encoder available for codec");
+        goto error;
+    }
+
+    if (encoder != NULL && !cuRTSPEncoderCheck(encoder, &pCreateSession->encoder, pCreateSession->lowLatency))
+    {
+        goto error;
+    }
+
+    if (pCreateSession->recording.location != NULL &&
+        (pCreateSession->recording.container > CU_RTSP_CONTAINER_MPEGTS || (pCreateSession->recording.container == CU_RTSP_CONTAINER_MPEGTS && pCreateSession->encoder.codec == CU_RTSP_CODEC_AV1)))
+    {
+        cuRTSPSetError("cuRTSPSessionCreate: invalid recording container");
+        goto error;
+    }
+
+    if (pCreateSession->renditionCount > 0 && pCreateSession->input == CU_RTSP_INPUT_ENCODED)
+    {
+        cuRTSPSetError("cuRTSPSessionCreate: encoded input cannot be scaled into renditions");
+        goto error;
+    }
+
+    for (index = 0; index < pCreateSession->renditionCount; index++)
+    {
+        if (pCreateSession->renditions[index].name == NULL || pCreateSession->renditions[index].name[0] == '\0' || pCreateSession->renditions[index].width == 0 || pCreateSession->renditions[index].height == 0)
+        {
+            cuRTSPSetError("cuRTSPSessionCreate: rendition %zu needs a name and a size", index);
+            goto error;
+        }
+    }
+
+    if (pCreateSession->multicast.addressMin != NULL)
     {
-        launch_string = launch_string_no_convert;
+        address_pool = cuRTSPAddressPool(&pCreateSession->multicast);
+        if (address_pool == NULL)
+        {
+            cuRTSPSetError("cuRTSPSessionCreate: invalid multicast range");
+            goto error;
+        }
     }
 
     *pSession = calloc(1, sizeof(CUrtsp_session_st));
+    (*pSession)->ref_count = 1;
+    (*pSession)->trace_id = cuRTSPTraceId();
     (*pSession)->session_info.device = pCreateSession->device;
     (*pSession)->session_info.context = pCreateSession->context;
     (*pSession)->session_info.width = pCreateSession->width;
@@ -217,19 +1406,182 @@ CUresult cuRTSPSessionCreate(CUrtsp_session *pSession, const CUDA_RTSP_SESSION *
     (*pSession)->session_info.format = pCreateSession->format;
     (*pSession)->session_info.fpsNum = pCreateSession->fpsNum;
     (*pSession)->session_info.fpsDen = pCreateSession->fpsDen;
+    (*pSession)->session_info.live = pCreateSession->live;
+    (*pSession)->session_info.shared = pCreateSession->shared;
+    (*pSession)->session_info.lowLatency = pCreateSession->lowLatency;
+    (*pSession)->session_info.prewarm = pCreateSession->prewarm || pCreateSession->recording.location != NULL;
+    (*pSession)->session_info.input = pCreateSession->input;
+    (*pSession)->session_info.queueDepth = (pCreateSession->queueDepth > 0) ? pCreateSession->queueDepth : CU_RTSP_DEFAULT_QUEUE_DEPTH;
+    (*pSession)->session_info.queuePolicy = pCreateSession->queuePolicy;
+    (*pSession)->session_info.poolMin = (pCreateSession->poolMin > 0) ? pCreateSession->poolMin : CU_RTSP_DEFAULT_POOL_MIN;
+    (*pSession)->session_info.poolMax = pCreateSession->poolMax;
+    (*pSession)->session_info.mtu = pCreateSession->mtu;
+    (*pSession)->session_info.aggregateMode = pCreateSession->aggregateMode;
+    (*pSession)->session_info.sendBufferSize = pCreateSession->sendBufferSize;
+    (*pSession)->session_info.segmentationOffload = pCreateSession->segmentationOffload;
+    (*pSession)->session_info.backpressure = pCreateSession->backpressure;
+    (*pSession)->session_info.recording = pCreateSession->recording;
+    (*pSession)->session_info.recording.location = g_strdup(pCreateSession->recording.location);
+    (*pSession)->session_info.encoder = pCreateSession->encoder;
+    (*pSession)->session_info.encoder.preset = g_strdup(pCreateSession->encoder.preset);
+    (*pSession)->session_info.encoder.tune = g_strdup(pCreateSession->encoder.tune);
+    (*pSession)->session_info.encoder.options = g_strdup(pCreateSession->encoder.options);
+    (*pSession)->encoder = encoder;
+    (*pSession)->session_info.idleIntervalMs = pCreateSession->idleIntervalMs;
     (*pSession)->session_info.writeCallback = pCreateSession->writeCallback;
+    (*pSession)->session_info.updateCallback = pCreateSession->updateCallback;
+    (*pSession)->session_info.streamCallback = pCreateSession->streamCallback;
+    (*pSession)->session_info.latencyCallback = pCreateSession->latencyCallback;
     (*pSession)->session_info.userData = pCreateSession->userData;
-    (*pSession)->gst_rtsp_media_factory = gst_rtsp_media_factory_new();
-    (*pSession)->gst_cuda_context = gst_cuda_context_new_wrapped((*pSession)->session_info.context, (*pSession)->session_info.device);
-    (*pSession)->gst_context = gst_context_new(GST_CUDA_CONTEXT_TYPE, TRUE);
-    g_object_get(G_OBJECT((*pSession)->gst_cuda_context), "cuda-device-id", &device_id, NULL);
-    s = gst_context_writable_structure((*pSession)->gst_context);
-    gst_structure_set(s, GST_CUDA_CONTEXT_TYPE, GST_TYPE_CUDA_CONTEXT,
-                      (*pSession)->gst_cuda_context, "cuda-device-id", G_TYPE_INT, device_id, NULL);
-    (*pSession)->cu_buffer_pool = gst_cuda_buffer_pool_new((*pSession)->gst_cuda_context);
-    gst_rtsp_media_factory_set_launch((*pSession)->gst_rtsp_media_factory, launch_string);
-    gst_rtsp_media_factory_set_enable_rtcp((*pSession)->gst_rtsp_media_factory, (pCreateSession->live) ? FALSE : TRUE);
-    g_signal_connect((*pSession)->gst_rtsp_media_factory, "media-configure", (GCallback)cuRTSPSessionConfigure, *pSession);
+    (*pSession)->session_info.renditionCount = pCreateSession->renditionCount;
+    if (pCreateSession->renditionCount > 0)
+    {
+        (*pSession)->renditions = g_new0(CUDA_RTSP_RENDITION, pCreateSession->renditionCount);
+        (*pSession)->rendition_factories = g_new0(GstRTSPMediaFactory *, pCreateSession->renditionCount);
+        for (index = 0; index < pCreateSession->renditionCount; index++)
+        {
+            (*pSession)->renditions[index] = pCreateSession->renditions[index];
+            (*pSession)->renditions[index].name = g_strdup(pCreateSession->renditions[index].name);
+        }
+        (*pSession)->session_info.renditions = (*pSession)->renditions;
+    }
+    if (pCreateSession->input != CU_RTSP_INPUT_ENCODED)
+    {
+        (*pSession)->device = cuRTSPDeviceAcquire((*pSession)->session_info.device, (*pSession)->session_info.context);
+#ifndef CU_RTSP_HOST
+        (*pSession)->gst_cuda_context = (*pSession)->device->gst_cuda_context;
+        (*pSession)->gst_context = (*pSession)->device->gst_context;
+#endif
+    }
+    g_mutex_init(&(*pSession)->lock);
+    g_cond_init(&(*pSession)->cond);
+    g_mutex_init(&(*pSession)->snapshot_lock);
+    g_queue_init(&(*pSession)->frames);
+    if ((*pSession)->session_info.streamCallback != NULL && (*pSession)->device != NULL)
+    {
+#ifdef CU_RTSP_HOST
+        cuStreamCreate(&(*pSession)->cu_stream, CU_STREAM_NON_BLOCKING);
+#else
+        (*pSession)->gst_cuda_stream = gst_cuda_stream_new((*pSession)->gst_cuda_context);
+        if ((*pSession)->gst_cuda_stream != NULL)
+        {
+            (*pSession)->cu_stream = gst_cuda_stream_get_handle((*pSession)->gst_cuda_stream);
+        }
+#endif
+    }
+    (*pSession)->caps = cuRTSPSessionCaps(&(*pSession)->session_info);
+    if ((*pSession)->device != NULL)
+    {
+        gst_video_info_from_caps(&video_info, (*pSession)->caps);
+        (*pSession)->video_info = video_info;
+        (*pSession)->frame_size = video_info.size;
+        (*pSession)->cu_buffer_pool = cuRTSPSessionPool(*pSession, (*pSession)->caps, video_info.size);
+#ifdef CU_RTSP_HOST
+        (*pSession)->convert_pool = cuRTSPSessionConvertPool(*pSession, &(*pSession)->session_info, &(*pSession)->caps, &(*pSession)->convert_info);
+#endif
+    }
+    (*pSession)->gst_rtsp_media_factory = cuRTSPSessionFactory(*pSession, pCreateSession, address_pool, NULL);
+    for (index = 0; index < (*pSession)->session_info.renditionCount; index++)
+    {
+        (*pSession)->rendition_factories[index] = cuRTSPSessionFactory(*pSession, pCreateSession, address_pool, &(*pSession)->renditions[index]);
+    }
+    if (address_pool != NULL)
+    {
+        g_object_unref(address_pool);
+    }
+    goto done;
+error:
+    result = CUDA_ERROR_INVALID_VALUE;
+done:
+    return result;
+}
+
+CUresult cuRTSPSessionCreateMosaic(CUrtsp_session *pSession, const CUDA_RTSP_SESSION *pCreateSession, const CUDA_RTSP_TILE *pTiles, size_t tileCount)
+{
+    CUresult result;
+    CUDA_RTSP_SESSION mosaic_info;
+    CUrtsp_mosaic_st *mosaic;
+    CUrtsp_tile_st *tiles;
+
+    result = CUDA_SUCCESS;
+
+    if (pSession == NULL || pCreateSession == NULL)
+    {
+        cuRTSPSetError("cuRTSPSessionCreateMosaic: pSession and pCreateSession cannot be NULL");
+        goto error;
+    }
+
+    if (pCreateSession->input != CU_RTSP_INPUT_CALLBACK)
+    {
+        cuRTSPSetError("cuRTSPSessionCreateMosaic: a mosaic is produced by its compositor");
+        goto error;
+    }
+
+    result = cuRTSPMosaicTiles("cuRTSPSessionCreateMosaic", pCreateSession, pTiles, tileCount, &tiles);
+    if (result != CUDA_SUCCESS)
+    {
+        goto done;
+    }
+
+    mosaic = g_new0(CUrtsp_mosaic_st, 1);
+    g_mutex_init(&mosaic->lock);
+    mosaic->tiles = tiles;
+    mosaic->tile_count = tileCount;
+
+    mosaic_info = *pCreateSession;
+    mosaic_info.writeCallback = cuRTSPMosaicWrite;
+    mosaic_info.updateCallback = NULL;
+    mosaic_info.streamCallback = NULL;
+    mosaic_info.userData = mosaic;
+    result = cuRTSPSessionCreate(pSession, &mosaic_info);
+    if (result != CUDA_SUCCESS)
+    {
+        cuRTSPMosaicFree(mosaic);
+        goto done;
+    }
+    mosaic->session = *pSession;
+    (*pSession)->mosaic = mosaic;
+    goto done;
+error:
+    result = CUDA_ERROR_INVALID_VALUE;
+done:
+    return result;
+}
+
+CUresult cuRTSPSessionSetTiles(CUrtsp_session hSession, const CUDA_RTSP_TILE *pTiles, size_t tileCount)
+{
+    CUresult result;
+    CUrtsp_mosaic_st *mosaic;
+    CUDA_RTSP_SESSION mosaic_info;
+    CUrtsp_tile_st *tiles;
+    CUrtsp_tile_st *old_tiles;
+    size_t old_count;
+
+    result = CUDA_SUCCESS;
+
+    if (hSession == NULL || hSession->mosaic == NULL)
+    {
+        cuRTSPSetError("cuRTSPSessionSetTiles: hSession must be a mosaic");
+        goto error;
+    }
+
+    mosaic = hSession->mosaic;
+    g_mutex_lock(&hSession->lock);
+    mosaic_info = hSession->session_info;
+    g_mutex_unlock(&hSession->lock);
+    result = cuRTSPMosaicTiles("cuRTSPSessionSetTiles", &mosaic_info, pTiles, tileCount, &tiles);
+    if (result != CUDA_SUCCESS)
+    {
+        goto done;
+    }
+
+    g_mutex_lock(&mosaic->lock);
+    old_tiles = mosaic->tiles;
+    old_count = mosaic->tile_count;
+    mosaic->tiles = tiles;
+    mosaic->tile_count = tileCount;
+    g_mutex_unlock(&mosaic->lock);
+    cuRTSPMosaicTilesFree(old_tiles, old_count);
     goto done;
 error:
     result = CUDA_ERROR_INVALID_VALUE;
@@ -241,6 +1593,13 @@ CUresult cuRTSPSessionMount(CUrtsp_session hSession, CUrtsp_server hServer, cons
 {
     CUresult result;
     GstRTSPMountPoints *mount_points;
+    GstRTSPThreadPool *thread_pool;
+    GstRTSPThread *thread;
+    GstRTSPUrl *url;
+    CUrtsp_mount_st *mount;
+    gchar *service;
+    gchar *uri;
+    size_t index;
 
     result = CUDA_SUCCESS;
     mount_points = NULL;
@@ -256,8 +1615,62 @@ CUresult cuRTSPSessionMount(CUrtsp_session hSession, CUrtsp_server hServer, cons
         cuRTSPSetError("cuRTSPSessionMount: hServer cannot be NULL");
         goto error;
     }
+    if (path == NULL)
+    {
+        cuRTSPSetError("cuRTSPSessionMount: path cannot be NULL");
+        goto error;
+    }
     mount_points = gst_rtsp_server_get_mount_points(hServer->gst_rtsp_server);
-    gst_rtsp_mount_points_add_factory(mount_points, path, hSession->gst_rtsp_media_factory);
+    // mount points take over a reference
+    gst_rtsp_mount_points_add_factory(mount_points, path, g_object_ref(hSession->gst_rtsp_media_factory));
+    mount = g_new0(CUrtsp_mount_st, 1);
+    mount->server = g_object_ref(hServer->gst_rtsp_server);
+    mount->path = g_strdup(path);
+    mount->rendition_paths = g_new0(gchar *, hSession->session_info.renditionCount + 1);
+    for (index = 0; index < hSession->session_info.renditionCount; index++)
+    {
+        mount->rendition_paths[index] = g_strdup_printf("%s/%s", path, hSession->renditions[index].name);
+        gst_rtsp_mount_points_add_factory(mount_points, mount->rendition_paths[index], g_object_ref(hSession->rendition_factories[index]));
+    }
+    hSession->mounts = g_list_prepend(hSession->mounts, mount);
+
+    if (hSession->session_info.prewarm && hSession->prewarmed == NULL)
+    {
+        service = gst_rtsp_server_get_service(hServer->gst_rtsp_server);
+        uri = g_strdup_printf("rtsp://127.0.0.1:%s%s", service, path);
+        if (gst_rtsp_url_parse(uri, &url) == GST_RTSP_OK)
+        {
+            hSession->prewarmed = gst_rtsp_media_factory_construct(hSession->gst_rtsp_media_factory, url);
+            gst_rtsp_url_free(url);
+        }
+        g_free(uri);
+        g_free(service);
+        if (hSession->prewarmed == NULL)
+        {
+            result = CUDA_ERROR_NOT_READY;
+            cuRTSPSetError("cuRTSPSessionMount: failed to construct media for %s", path);
+            goto unmount;
+        }
+        thread_pool = gst_rtsp_server_get_thread_pool(hServer->gst_rtsp_server);
+        thread = gst_rtsp_thread_pool_get_thread(thread_pool, GST_RTSP_THREAD_TYPE_MEDIA, NULL);
+        g_object_unref(thread_pool);
+        if (!gst_rtsp_media_prepare(hSession->prewarmed, thread))
+        {
+            g_object_unref(hSession->prewarmed);
+            hSession->prewarmed = NULL;
+            result = CUDA_ERROR_NOT_READY;
+            cuRTSPSetError("cuRTSPSessionMount: failed to prepare media for %s", path);
+            goto unmount;
+        }
+        if (hSession->session_info.recording.location != NULL)
+        {
+            gst_rtsp_media_set_pipeline_state(hSession->prewarmed, GST_STATE_PLAYING);
+        }
+    }
+    goto done;
+unmount:
+    hSession->mounts = g_list_remove(hSession->mounts, mount);
+    cuRTSPMountRemove(mount);
     goto done;
 error:
     result = CUDA_ERROR_INVALID_VALUE;
@@ -269,88 +1682,3780 @@ done:
     return result;
 }
 
-static void cuRTSPSetError(const char *format, ...)
+CUresult cuRTSPSessionUnmount(CUrtsp_session hSession, CUrtsp_server hServer, const char *path)
 {
-    va_list args;
-    va_start(args, format);
-    vsnprintf(current_error, sizeof(current_error) / sizeof(current_error[0]), format, args);
-    va_end(args);
-}
+    CUresult result;
+    CUrtsp_mount_st *mount;
+    GList *item;
 
-static void cuRTSPSessionConfigure(
-    GstRTSPMediaFactory *factory,
-    GstRTSPMedia *media,
-    CUrtsp_session hSession)
-{
-    const char *caps_format = "video/x-raw(memory:CUDAMemory),format=%s,width=%d,height=%d,framerate=%d/%d";
-    char caps_string[256];
-    GstElement *pipeline;
-    GstElement *appsrc;
-    GstCaps *caps;
-    GstVideoInfo video_info;
-    GstStructure *config;
+    result = CUDA_SUCCESS;
 
-    snprintf(
-        &caps_string[0],
-        sizeof(caps_string) / sizeof(caps_string[0]),
-        caps_format,
-        FORMATS[hSession->session_info.format],
-        (int)hSession->session_info.width,
-        (int)hSession->session_info.height,
-        (int)hSession->session_info.fpsNum,
-        (int)hSession->session_info.fpsDen);
+    if (hSession == NULL)
+    {
+        cuRTSPSetError("cuRTSPSessionUnmount: hSession cannot be NULL");
+        goto error;
+    }
 
-    caps = gst_caps_from_string(&caps_string[0]);
-    pipeline = gst_rtsp_media_get_element(media);
-    gst_element_set_context(pipeline, GST_CONTEXT(hSession->gst_context));
-    appsrc = gst_bin_get_by_name_recurse_up(GST_BIN(pipeline), "source");
-    gst_util_set_object_arg(G_OBJECT(appsrc), "format", "time");
-    g_object_set(G_OBJECT(appsrc), "caps",
-                 caps,
-                 NULL);
-    gst_video_info_from_caps(&video_info, caps);
-    config = gst_buffer_pool_get_config(hSession->cu_buffer_pool);
-    gst_buffer_pool_config_set_params(config, caps, video_info.size, 2, 0);
-    gst_buffer_pool_set_config(hSession->cu_buffer_pool, config);
-    gst_buffer_pool_set_active(hSession->cu_buffer_pool, TRUE);
-    g_signal_connect(appsrc, "need-data", (GCallback)cuRTSPSessionPushBuffer, hSession);
+    if (hServer == NULL)
+    {
+        cuRTSPSetError("cuRTSPSessionUnmount: hServer cannot be NULL");
+        goto error;
+    }
+
+    for (item = hSession->mounts; item != NULL; item = item->next)
+    {
+        mount = (CUrtsp_mount_st *)item->data;
+        if (mount->server == hServer->gst_rtsp_server && g_strcmp0(mount->path, path) == 0)
+        {
+            break;
+        }
+    }
+
+    if (item == NULL)
+    {
+        cuRTSPSetError("cuRTSPSessionUnmount: session is not mounted at %s", (path != NULL) ? path : "(null)");
+        goto error;
+    }
+
+    hSession->mounts = g_list_delete_link(hSession->mounts, item);
+    cuRTSPMountRemove(mount);
+    goto done;
+error:
+    result = CUDA_ERROR_INVALID_VALUE;
+done:
+    return result;
+}
+
+CUresult cuRTSPSessionReconfigure(CUrtsp_session hSession, size_t width, size_t height, CUrtsp_format format, size_t fpsNum, size_t fpsDen)
+{
+    CUresult result;
+    CUDA_RTSP_SESSION session_info;
+    GstVideoInfo video_info;
+    GstCaps *caps;
+    GstBufferPool *pool;
+    GstBufferPool *old_pool;
+#ifdef CU_RTSP_HOST
+    GstBufferPool *convert_pool;
+    GstBufferPool *old_convert_pool;
+    GstVideoInfo convert_info;
+#endif
+    GstBuffer *dropped;
+    CUrtsp_media_st *media_state;
+    GList *item;
+
+    result = CUDA_SUCCESS;
+
+    if (hSession == NULL)
+    {
+        cuRTSPSetError("cuRTSPSessionReconfigure: hSession cannot be NULL");
+        goto error;
+    }
+
+    if (width == 0 || height == 0 || fpsNum == 0 || fpsDen == 0 || format > CU_RTSP_FORMAT_RGB)
+    {
+        cuRTSPSetError("cuRTSPSessionReconfigure: invalid video settings");
+        goto error;
+    }
+
+    if (hSession->session_info.input == CU_RTSP_INPUT_ENCODED)
+    {
+        result = CUDA_ERROR_NOT_SUPPORTED;
+        cuRTSPSetError("cuRTSPSessionReconfigure: encoded sessions follow the parameters in their stream");
+        goto done;
+    }
+
+    if (hSession->encoder->type != CU_RTSP_ENCODER_SOFTWARE && cuRTSPSessionNeedsConvert(format) != cuRTSPSessionNeedsConvert(hSession->session_info.format))
+    {
+        result = CUDA_ERROR_NOT_SUPPORTED;
+        cuRTSPSetError("cuRTSPSessionReconfigure: format change needs a new session");
+        goto done;
+    }
+
+    session_info = hSession->session_info;
+    session_info.width = width;
+    session_info.height = height;
+    session_info.format = format;
+    session_info.fpsNum = fpsNum;
+    session_info.fpsDen = fpsDen;
+    caps = cuRTSPSessionCaps(&session_info);
+    if (!gst_video_info_from_caps(&video_info, caps))
+    {
+        gst_caps_unref(caps);
+        cuRTSPSetError("cuRTSPSessionReconfigure: invalid video settings");
+        goto error;
+    }
+    pool = cuRTSPSessionPool(hSession, caps, video_info.size);
+#ifdef CU_RTSP_HOST
+    convert_pool = cuRTSPSessionConvertPool(hSession, &session_info, &caps, &convert_info);
+#endif
+
+    g_mutex_lock(&hSession->lock);
+    hSession->session_info.width = width;
+    hSession->session_info.height = height;
+    hSession->session_info.format = format;
+    hSession->session_info.fpsNum = fpsNum;
+    hSession->session_info.fpsDen = fpsDen;
+    hSession->video_info = video_info;
+    hSession->frame_size = video_info.size;
+    old_pool = hSession->cu_buffer_pool;
+    hSession->cu_buffer_pool = pool;
+#ifdef CU_RTSP_HOST
+    old_convert_pool = hSession->convert_pool;
+    hSession->convert_pool = convert_pool;
+    if (convert_pool != NULL)
+    {
+        hSession->convert_info = convert_info;
+    }
+#endif
+    gst_caps_replace(&hSession->caps, caps);
+    while ((dropped = g_queue_pop_head(&hSession->frames)) != NULL)
+    {
+        gst_buffer_unref(dropped);
+        cuRTSPCounterAdd(&hSession->stats.framesDropped, 1);
+    }
+    gst_buffer_replace(&hSession->last_frame, NULL);
+    gst_buffer_replace(&hSession->shared_frame, NULL);
+    // appsrc sends the new caps ahead of the next frame
+    for (item = hSession->medias; item != NULL; item = item->next)
+    {
+        media_state = (CUrtsp_media_st *)item->data;
+        g_object_set(G_OBJECT(media_state->appsrc), "caps", hSession->caps, NULL);
+        if (hSession->session_info.lowLatency)
+        {
+            g_object_set(G_OBJECT(media_state->appsrc), "max-bytes", (guint64)hSession->frame_size, NULL);
+        }
+    }
+    g_cond_broadcast(&hSession->cond);
+    g_mutex_unlock(&hSession->lock);
+
+    cuRTSPSessionPoolRelease(hSession, old_pool);
+#ifdef CU_RTSP_HOST
+    if (old_convert_pool != NULL)
+    {
+        cuRTSPSessionPoolRelease(hSession, old_convert_pool);
+    }
+#endif
     gst_caps_unref(caps);
-    gst_object_unref(appsrc);
-    gst_object_unref(pipeline);
+    goto done;
+error:
+    result = CUDA_ERROR_INVALID_VALUE;
+done:
+    return result;
 }
 
-static void cuRTSPSessionPushBuffer(
-    GstElement *appsrc,
-    guint unused,
-    CUrtsp_session hSession)
+void cuRTSPSessionDestroy(CUrtsp_session hSession)
 {
-    GstBuffer *buffer;
-    GstMapInfo map_info;
+    CUrtsp_media_st *media_state;
     GstFlowReturn ret;
-    assert(hSession != NULL);
-    assert(cuCtxPushCurrent(hSession->session_info.context) == CUDA_SUCCESS);
-    gst_buffer_pool_acquire_buffer(hSession->cu_buffer_pool, &buffer, NULL);
-    gst_buffer_map(buffer, &map_info, GST_MAP_WRITE);
-    hSession->session_info.writeCallback(
-        (CUdeviceptr)map_info.data,
-        map_info.size,
-        hSession->session_info.userData);
-    gst_buffer_unmap(buffer, &map_info);
-    GST_BUFFER_PTS(buffer) = hSession->timestamp;
-    GST_BUFFER_DURATION(buffer) = gst_util_uint64_scale_int(
-        hSession->session_info.fpsDen,
-        GST_SECOND,
-        hSession->session_info.fpsNum);
-    hSession->timestamp += GST_BUFFER_DURATION(buffer);
-    g_signal_emit_by_name(appsrc, "push-buffer", buffer, &ret);
-    gst_buffer_unref(buffer);
-    assert(cuCtxPopCurrent(&hSession->session_info.context) == CUDA_SUCCESS);
+    GList *item;
+    size_t index;
+
+    if (hSession == NULL)
+    {
+        return;
+    }
+
+    g_signal_handlers_disconnect_by_data(hSession->gst_rtsp_media_factory, hSession);
+    for (index = 0; index < hSession->session_info.renditionCount; index++)
+    {
+        g_signal_handlers_disconnect_by_data(hSession->rendition_factories[index], hSession);
+    }
+    g_list_free_full(hSession->mounts, (GDestroyNotify)cuRTSPMountRemove);
+    hSession->mounts = NULL;
+
+    g_mutex_lock(&hSession->lock);
+    g_atomic_int_set(&hSession->destroyed, TRUE);
+    g_cond_broadcast(&hSession->cond);
+    // no callback may run with the application's user data once this returns
+    while (hSession->callbacks_active > 0)
+    {
+        g_cond_wait(&hSession->cond, &hSession->lock);
+    }
+    for (item = hSession->medias; item != NULL; item = item->next)
+    {
+        media_state = (CUrtsp_media_st *)item->data;
+        g_signal_emit_by_name(media_state->appsrc, "end-of-stream", &ret);
+    }
+    g_mutex_unlock(&hSession->lock);
+
+    if (hSession->prewarmed != NULL)
+    {
+        gst_rtsp_media_unprepare(hSession->prewarmed);
+        g_object_unref(hSession->prewarmed);
+        hSession->prewarmed = NULL;
+    }
+
+    cuRTSPSessionUnref(hSession);
 }
 
-static void cuRTSPSessionDestroy(
-    CUrtsp_session hSession)
+CUresult cuRTSPSessionPushFrame(CUrtsp_session hSession, CUrtspWriteCallback writeCallback, void *userData)
+{
+    CUresult result;
+    GstBuffer *buffer;
+
+    result = CUDA_SUCCESS;
+    buffer = NULL;
+
+    if (hSession == NULL)
+    {
+        cuRTSPSetError("cuRTSPSessionPushFrame: hSession cannot be NULL");
+        goto error;
+    }
+
+    if (hSession->session_info.input != CU_RTSP_INPUT_PUSH)
+    {
+        cuRTSPSetError("cuRTSPSessionPushFrame: session input must be CU_RTSP_INPUT_PUSH");
+        goto error;
+    }
+
+    if (writeCallback == NULL)
+    {
+        cuRTSPSetError("cuRTSPSessionPushFrame: writeCallback cannot be NULL");
+        goto error;
+    }
+
+    buffer = cuRTSPSessionWriteBuffer(hSession, writeCallback, NULL, NULL, userData, NULL);
+    if (buffer == NULL)
+    {
+        cuRTSPCounterAdd(&hSession->stats.framesDropped, 1);
+        result = CUDA_ERROR_NOT_READY;
+        cuRTSPSetError("cuRTSPSessionPushFrame: failed to acquire buffer");
+        goto done;
+    }
+
+    cuRTSPSessionEnqueue(hSession, buffer);
+    goto done;
+error:
+    result = CUDA_ERROR_INVALID_VALUE;
+done:
+    return result;
+}
+
+CUresult cuRTSPSessionPushAccessUnit(CUrtsp_session hSession, const void *data, size_t size, uint64_t pts, bool keyframe)
+{
+    CUresult result;
+    GstBuffer *buffer;
+
+    result = CUDA_SUCCESS;
+
+    if (hSession == NULL)
+    {
+        cuRTSPSetError("cuRTSPSessionPushAccessUnit: hSession cannot be NULL");
+        goto error;
+    }
+
+    if (hSession->session_info.input != CU_RTSP_INPUT_ENCODED)
+    {
+        cuRTSPSetError("cuRTSPSessionPushAccessUnit: session input must be CU_RTSP_INPUT_ENCODED");
+        goto error;
+    }
+
+    if (data == NULL || size == 0)
+    {
+        cuRTSPSetError("cuRTSPSessionPushAccessUnit: data cannot be empty");
+        goto error;
+    }
+
+    buffer = gst_buffer_new_allocate(NULL, size, NULL);
+    if (buffer == NULL)
+    {
+        cuRTSPCounterAdd(&hSession->stats.framesDropped, 1);
+        result = CUDA_ERROR_OUT_OF_MEMORY;
+        cuRTSPSetError("cuRTSPSessionPushAccessUnit: failed to allocate buffer");
+        goto done;
+    }
+    gst_buffer_fill(buffer, 0, data, size);
+    GST_BUFFER_PTS(buffer) = pts;
+    if (!keyframe)
+    {
+        GST_BUFFER_FLAG_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    }
+    gst_buffer_add_reference_timestamp_meta(buffer, CAPTURE_CAPS, g_get_monotonic_time() * GST_USECOND, GST_CLOCK_TIME_NONE);
+    cuRTSPCounterAdd(&hSession->stats.framesProduced, 1);
+
+    cuRTSPSessionEnqueue(hSession, buffer);
+    goto done;
+error:
+    result = CUDA_ERROR_INVALID_VALUE;
+done:
+    return result;
+}
+
+CUresult cuRTSPSessionPushExternalFrame(CUrtsp_session hSession, const CUDA_RTSP_FRAME *pFrame)
+{
+    CUresult result;
+    GstBuffer *buffer;
+    GstMemory *memory;
+    GstVideoInfo video_info;
+    CUrtsp_release_st *release;
+    gint components[GST_VIDEO_MAX_COMPONENTS];
+    gsize size;
+    guint plane;
+
+    result = CUDA_SUCCESS;
+
+    if (hSession == NULL)
+    {
+        cuRTSPSetError("cuRTSPSessionPushExternalFrame: hSession cannot be NULL");
+        goto error;
+    }
+
+    if (hSession->session_info.input != CU_RTSP_INPUT_PUSH)
+    {
+        cuRTSPSetError("cuRTSPSessionPushExternalFrame: session input must be CU_RTSP_INPUT_PUSH");
+        goto error;
+    }
+
+    if (pFrame == NULL || pFrame->planes[0] == 0)
+    {
+        cuRTSPSetError("cuRTSPSessionPushExternalFrame: pFrame must reference device memory");
+        goto error;
+    }
+
+    g_mutex_lock(&hSession->lock);
+    video_info = hSession->video_info;
+    g_mutex_unlock(&hSession->lock);
+    size = 0;
+    for (plane = 0; plane < GST_VIDEO_INFO_N_PLANES(&video_info); plane++)
+    {
+        if (plane > 0 && pFrame->planes[plane] == 0)
+        {
+            video_info.offset[plane] = size;
+        }
+        else if (pFrame->planes[plane] >= pFrame->planes[0])
+        {
+            video_info.offset[plane] = pFrame->planes[plane] - pFrame->planes[0];
+        }
+        else
+        {
+            cuRTSPSetError("cuRTSPSessionPushExternalFrame: plane %u precedes planes[0]", plane);
+            goto error;
+        }
+        if (pFrame->pitches[plane] != 0)
+        {
+            video_info.stride[plane] = pFrame->pitches[plane];
+        }
+        gst_video_format_info_component(video_info.finfo, plane, components);
+        size = MAX(size, video_info.offset[plane] + video_info.stride[plane] * GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT(video_info.finfo, components[0], GST_VIDEO_INFO_HEIGHT(&video_info)));
+    }
+    video_info.size = size;
+
+    release = g_new0(CUrtsp_release_st, 1);
+    release->callback = pFrame->releaseCallback;
+    release->user_data = pFrame->userData;
+#ifdef CU_RTSP_HOST
+    memory = gst_memory_new_wrapped(0, (gpointer)pFrame->planes[0], size, 0, size, release, cuRTSPFrameRelease);
+#else
+    memory = gst_cuda_allocator_alloc_wrapped(NULL, hSession->gst_cuda_context, NULL, &video_info, pFrame->planes[0], release, cuRTSPFrameRelease);
+#endif
+    if (memory == NULL)
+    {
+        // the application keeps ownership when wrapping failed
+        g_free(release);
+        cuRTSPCounterAdd(&hSession->stats.framesDropped, 1);
+        result = CUDA_ERROR_NOT_READY;
+        cuRTSPSetError("cuRTSPSessionPushExternalFrame: failed to wrap memory");
+        goto done;
+    }
+
+    buffer = gst_buffer_new();
+    gst_buffer_append_memory(buffer, memory);
+    gst_buffer_add_video_meta_full(
+        buffer,
+        GST_VIDEO_FRAME_FLAG_NONE,
+        GST_VIDEO_INFO_FORMAT(&video_info),
+        GST_VIDEO_INFO_WIDTH(&video_info),
+        GST_VIDEO_INFO_HEIGHT(&video_info),
+        GST_VIDEO_INFO_N_PLANES(&video_info),
+        video_info.offset,
+        video_info.stride);
+    gst_buffer_add_reference_timestamp_meta(buffer, CAPTURE_CAPS, g_get_monotonic_time() * GST_USECOND, GST_CLOCK_TIME_NONE);
+#ifdef CU_RTSP_HOST
+    buffer = cuRTSPSessionConvertBuffer(hSession, buffer);
+    if (buffer == NULL)
+    {
+        cuRTSPCounterAdd(&hSession->stats.framesDropped, 1);
+        result = CUDA_ERROR_NOT_READY;
+        cuRTSPSetError("cuRTSPSessionPushExternalFrame: failed to convert frame");
+        goto done;
+    }
+#endif
+    cuRTSPCounterAdd(&hSession->stats.framesProduced, 1);
+
+    cuRTSPSessionEnqueue(hSession, buffer);
+    goto done;
+error:
+    result = CUDA_ERROR_INVALID_VALUE;
+done:
+    return result;
+}
+
+CUresult cuRTSPSessionGetSnapshot(CUrtsp_session hSession, size_t width, size_t height, void *pData, size_t *pSize)
+{
+    CUresult result;
+    GstBuffer *snapshot;
+    gsize size;
+
+    result = CUDA_SUCCESS;
+
+    if (hSession == NULL)
+    {
+        cuRTSPSetError("cuRTSPSessionGetSnapshot: hSession cannot be NULL");
+        goto error;
+    }
+
+    if (pSize == NULL || (pData == NULL && *pSize > 0))
+    {
+        cuRTSPSetError("cuRTSPSessionGetSnapshot: pSize cannot be NULL, nor pData with a non-zero capacity");
+        goto error;
+    }
+
+    if (hSession->session_info.input == CU_RTSP_INPUT_ENCODED)
+    {
+        result = CUDA_ERROR_NOT_SUPPORTED;
+        cuRTSPSetError("cuRTSPSessionGetSnapshot: encoded input has no frames to snapshot");
+        goto done;
+    }
+
+    g_mutex_lock(&hSession->snapshot_lock);
+    snapshot = cuRTSPSessionSnapshot(hSession, width, height);
+    g_mutex_unlock(&hSession->snapshot_lock);
+    if (snapshot == NULL)
+    {
+        result = CUDA_ERROR_NOT_READY;
+        goto done;
+    }
+
+    size = gst_buffer_get_size(snapshot);
+    if (pData != NULL && size > *pSize)
+    {
+        result = CUDA_ERROR_INVALID_VALUE;
+        cuRTSPSetError("cuRTSPSessionGetSnapshot: %zu bytes do not fit", (size_t)size);
+    }
+    else if (pData != NULL)
+    {
+        gst_buffer_extract(snapshot, 0, pData, size);
+    }
+    *pSize = size;
+    gst_buffer_unref(snapshot);
+    goto done;
+error:
+    result = CUDA_ERROR_INVALID_VALUE;
+done:
+    return result;
+}
+
+CUresult cuRTSPSessionGetStats(CUrtsp_session hSession, CUDA_RTSP_SESSION_STATS *pStats)
 {
+    CUresult result;
+
+    result = CUDA_SUCCESS;
+
+    if (hSession == NULL)
+    {
+        cuRTSPSetError("cuRTSPSessionGetStats: hSession cannot be NULL");
+        goto error;
+    }
+
+    if (pStats == NULL)
+    {
+        cuRTSPSetError("cuRTSPSessionGetStats: pStats cannot be NULL");
+        goto error;
+    }
+
+    pStats->framesProduced = __atomic_load_n(&hSession->stats.framesProduced, __ATOMIC_RELAXED);
+    pStats->framesSent = __atomic_load_n(&hSession->stats.framesSent, __ATOMIC_RELAXED);
+    pStats->framesEncoded = __atomic_load_n(&hSession->stats.framesEncoded, __ATOMIC_RELAXED);
+    pStats->framesRepeated = __atomic_load_n(&hSession->stats.framesRepeated, __ATOMIC_RELAXED);
+    pStats->framesDropped = __atomic_load_n(&hSession->stats.framesDropped, __ATOMIC_RELAXED);
+    pStats->clientsThrottled = __atomic_load_n(&hSession->stats.clientsThrottled, __ATOMIC_RELAXED);
+    pStats->clientsResynced = __atomic_load_n(&hSession->stats.clientsResynced, __ATOMIC_RELAXED);
+    pStats->clientsDisconnected = __atomic_load_n(&hSession->stats.clientsDisconnected, __ATOMIC_RELAXED);
+    pStats->encoderQueue = (pStats->framesSent > pStats->framesEncoded) ? pStats->framesSent - pStats->framesEncoded : 0;
+    pStats->bitrate = __atomic_load_n(&hSession->stats.bitrate, __ATOMIC_RELAXED);
+    cuRTSPHistogramCopy(&pStats->callbackLatency, &hSession->stats.callbackLatency);
+    cuRTSPHistogramCopy(&pStats->acquireLatency, &hSession->stats.acquireLatency);
+    cuRTSPHistogramCopy(&pStats->encodeLatency, &hSession->stats.encodeLatency);
+    cuRTSPHistogramCopy(&pStats->captureLatency, &hSession->stats.captureLatency);
+    cuRTSPHistogramCopy(&pStats->joinLatency, &hSession->stats.joinLatency);
+    g_mutex_lock(&hSession->lock);
+    pStats->queueDepth = g_queue_get_length(&hSession->frames);
+    pStats->mediaCount = hSession->media_count;
+    g_mutex_unlock(&hSession->lock);
+    goto done;
+error:
+    result = CUDA_ERROR_INVALID_VALUE;
+done:
+    return result;
+}
+
+static void cuRTSPSetError(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vsnprintf(current_error, sizeof(current_error) / sizeof(current_error[0]), format, args);
+    va_end(args);
+}
+
+static GType cuRTSPThreadPoolGetType(void)
+{
+    static gsize type = 0;
+
+    if (g_once_init_enter(&type))
+    {
+        g_once_init_leave(&type, g_type_register_static_simple(
+                                     GST_TYPE_RTSP_THREAD_POOL,
+                                     "CUrtspThreadPool",
+                                     sizeof(CUrtsp_thread_pool_class_st),
+                                     cuRTSPThreadPoolClassInit,
+                                     sizeof(CUrtsp_thread_pool_st),
+                                     NULL,
+                                     0));
+    }
+
+    return type;
+}
+
+static void cuRTSPThreadPoolClassInit(
+    gpointer klass,
+    gpointer class_data)
+{
+    THREAD_POOL_PARENT = g_type_class_peek_parent(klass);
+    G_OBJECT_CLASS(klass)->finalize = cuRTSPThreadPoolFinalize;
+    GST_RTSP_THREAD_POOL_CLASS(klass)->thread_enter = cuRTSPThreadPoolThreadEnter;
+}
+
+static void cuRTSPThreadPoolFinalize(
+    GObject *object)
+{
+    g_free(((CUrtsp_thread_pool_st *)object)->cpus);
+    G_OBJECT_CLASS(THREAD_POOL_PARENT)->finalize(object);
+}
+
+static void cuRTSPThreadPoolThreadEnter(
+    GstRTSPThreadPool *pool,
+    GstRTSPThread *thread)
+{
+    CUrtsp_thread_pool_st *pinning_pool;
+#ifdef __linux__
+    cpu_set_t cpu_set;
+    size_t index;
+#endif
+
+    pinning_pool = (CUrtsp_thread_pool_st *)pool;
+#ifdef __linux__
+    if (pinning_pool->cpu_count > 0)
+    {
+        index = __atomic_fetch_add(&pinning_pool->next_cpu, 1, __ATOMIC_RELAXED) % pinning_pool->cpu_count;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(pinning_pool->cpus[index], &cpu_set);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    }
+#endif
+    if (THREAD_POOL_PARENT->thread_enter != NULL)
+    {
+        THREAD_POOL_PARENT->thread_enter(pool, thread);
+    }
+}
+
+static void cuRTSPSessionConfigure(
+    GstRTSPMediaFactory *factory,
+    GstRTSPMedia *media,
+    CUrtsp_session hSession)
+{
+    GstElement *pipeline;
+    GstElement *appsrc;
+    GstElement *fence;
+    GstElement *encoder;
+    GstElement *pay;
+    GstElement *recorder;
+    GstPad *pad;
+    CUrtsp_media_st *media_state;
+    const CUDA_RTSP_RENDITION *rendition;
+    size_t index;
+
+    media_state = calloc(1, sizeof(CUrtsp_media_st));
+    media_state->session = hSession;
+    cuRTSPSessionRef(hSession);
+    g_mutex_init(&media_state->lock);
+    media_state->receivers = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, free);
+    for (index = 0; index < CU_RTSP_PENDING_FRAMES; index++)
+    {
+        media_state->pending[index].pts = GST_CLOCK_TIME_NONE;
+    }
+    media_state->join_start = GST_CLOCK_TIME_NONE;
+    media_state->join_pts = GST_CLOCK_TIME_NONE;
+    media_state->pts_base = GST_CLOCK_TIME_NONE;
+    media_state->payloaded_pts = GST_CLOCK_TIME_NONE;
+    media_state->trace_id = cuRTSPTraceId();
+    media_state->trace_pads = g_array_new(FALSE, FALSE, sizeof(CUrtsp_trace_pad));
+    for (index = 0; index < CU_RTSP_PENDING_FRAMES; index++)
+    {
+        media_state->traced[index].pts = GST_CLOCK_TIME_NONE;
+    }
+    pipeline = gst_rtsp_media_get_element(media);
+    media_state->bin = pipeline;
+#ifndef CU_RTSP_HOST
+    if (hSession->gst_context != NULL)
+    {
+        gst_element_set_context(pipeline, GST_CONTEXT(hSession->gst_context));
+    }
+#endif
+    appsrc = gst_bin_get_by_name_recurse_up(GST_BIN(pipeline), "source");
+    media_state->appsrc = appsrc;
+    gst_util_set_object_arg(G_OBJECT(appsrc), "format", "time");
+    fence = gst_bin_get_by_name_recurse_up(GST_BIN(pipeline), "fence");
+    if (fence != NULL)
+    {
+        pad = gst_element_get_static_pad(fence, "src");
+        gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, (GstPadProbeCallback)cuRTSPMediaFenced, media_state, NULL);
+        gst_object_unref(pad);
+        gst_object_unref(fence);
+    }
+    encoder = gst_bin_get_by_name_recurse_up(GST_BIN(pipeline), "encoder");
+    rendition = g_object_get_data(G_OBJECT(factory), "cu-rtsp-rendition");
+    if (encoder != NULL)
+    {
+        cuRTSPEncoderConfigure(encoder, hSession->encoder, &hSession->session_info.encoder, hSession->session_info.lowLatency);
+        if (rendition != NULL && rendition->bitrate > 0)
+        {
+            cuRTSPEncoderSetBitrate(encoder, hSession->encoder, rendition->bitrate);
+        }
+        else if (hSession->session_info.encoder.maxBitrate > 0)
+        {
+            media_state->encoder = encoder;
+            media_state->bitrate = (hSession->session_info.encoder.bitrate > 0) ? hSession->session_info.encoder.bitrate : hSession->session_info.encoder.maxBitrate;
+            media_state->bitrate = CLAMP(media_state->bitrate, hSession->session_info.encoder.minBitrate, hSession->session_info.encoder.maxBitrate);
+            cuRTSPEncoderSetBitrate(encoder, hSession->encoder, media_state->bitrate);
+            __atomic_store_n(&hSession->stats.bitrate, media_state->bitrate, __ATOMIC_RELAXED);
+            g_signal_connect(media, "prepared", (GCallback)cuRTSPMediaPrepared, media_state);
+        }
+        pad = gst_element_get_static_pad(encoder, "src");
+        gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, (GstPadProbeCallback)cuRTSPMediaEncoded, media_state, NULL);
+        gst_object_unref(pad);
+        gst_object_unref(encoder);
+    }
+    pay = gst_bin_get_by_name_recurse_up(GST_BIN(pipeline), "pay0");
+    if (hSession->session_info.lowLatency)
+    {
+        g_object_set(G_OBJECT(appsrc),
+                     "is-live", TRUE,
+                     "min-latency", (gint64)0,
+                     NULL);
+        if (hSession->frame_size > 0)
+        {
+            g_object_set(G_OBJECT(appsrc), "max-bytes", (guint64)hSession->frame_size, NULL);
+        }
+        cuRTSPElementSet(pay, "aggregate-mode", "zero-latency");
+    }
+    cuRTSPElementSet(pay, "aggregate-mode", AGGREGATE_MODES[hSession->session_info.aggregateMode]);
+    if (hSession->session_info.mtu > 0)
+    {
+        g_object_set(G_OBJECT(pay), "mtu", (guint)hSession->session_info.mtu, NULL);
+    }
+    g_object_get(G_OBJECT(pay), "mtu", &media_state->mtu, NULL);
+    cuRTSPElementSet(pay, "config-interval", "-1");
+    pad = gst_element_get_static_pad(pay, "src");
+    gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST, (GstPadProbeCallback)cuRTSPMediaPayloaded, media_state, NULL);
+    gst_object_unref(pad);
+    gst_object_unref(pay);
+    g_object_set_data_full(G_OBJECT(appsrc), "cu-rtsp-media", media_state, (GDestroyNotify)cuRTSPMediaFree);
+    g_signal_connect(appsrc, "need-data", (GCallback)cuRTSPSessionPushBuffer, media_state);
+    g_signal_connect(media, "unprepared", (GCallback)cuRTSPSessionUnprepared, hSession);
+    g_signal_connect(media, "unprepared", (GCallback)cuRTSPMediaTraceUnprepared, media_state);
+    recorder = gst_bin_get_by_name_recurse_up(GST_BIN(pipeline), "recorder");
+    if (recorder != NULL)
+    {
+        g_object_set(G_OBJECT(recorder),
+                     "location", hSession->session_info.recording.location,
+                     "max-size-time", (guint64)((hSession->session_info.recording.segmentSeconds > 0) ? hSession->session_info.recording.segmentSeconds : CU_RTSP_DEFAULT_SEGMENT_SECONDS) * GST_SECOND,
+                     "max-files", (guint)hSession->session_info.recording.maxFiles,
+                     NULL);
+        g_signal_connect(media, "new-state", (GCallback)cuRTSPMediaNewState, hSession);
+        gst_object_unref(recorder);
+    }
+    g_mutex_lock(&hSession->lock);
+    // under the lock so a concurrent reconfigure cannot be missed
+    g_object_set(G_OBJECT(appsrc), "caps",
+                 hSession->caps,
+                 NULL);
+    hSession->medias = g_list_prepend(hSession->medias, media_state);
+    hSession->media_count++;
+    g_mutex_unlock(&hSession->lock);
+    gst_object_unref(appsrc);
+    gst_object_unref(pipeline);
+}
+
+static void cuRTSPSessionUnprepared(
+    GstRTSPMedia *media,
+    CUrtsp_session hSession)
+{
+    g_mutex_lock(&hSession->lock);
+    hSession->media_count--;
+    g_cond_broadcast(&hSession->cond);
+    g_mutex_unlock(&hSession->lock);
+}
+
+static void cuRTSPMediaNewState(
+    GstRTSPMedia *media,
+    gint state,
+    CUrtsp_session hSession)
+{
+    // the media pauses once no transport is active, which would stop the recording
+    if (state == GST_STATE_PAUSED && gst_rtsp_media_get_status(media) == GST_RTSP_MEDIA_STATUS_PREPARED && !g_atomic_int_get(&hSession->destroyed))
+    {
+        gst_rtsp_media_set_pipeline_state(media, GST_STATE_PLAYING);
+    }
+}
+
+static void cuRTSPMediaFree(
+    CUrtsp_media_st *media)
+{
+    GList *item;
+
+    g_mutex_lock(&media->session->lock);
+    media->session->medias = g_list_remove(media->session->medias, media);
+    g_mutex_unlock(&media->session->lock);
+    cuRTSPSessionUnref(media->session);
+    cuRTSPMediaTraceRemove(media);
+    for (item = media->resuming; item != NULL; item = item->next)
+    {
+        ((CUrtsp_backpressure_st *)item->data)->media = NULL;
+    }
+    g_list_free(media->resuming);
+    g_array_free(media->trace_pads, TRUE);
+    g_hash_table_destroy(media->receivers);
+    g_mutex_clear(&media->lock);
+    free(media);
+}
+
+static CUrtsp_pending_frame *cuRTSPMediaPendingSlot(
+    CUrtsp_media_st *media,
+    GstClockTime pts)
+{
+    GstClockTime duration;
+
+    // rounded so clock timestamps that jitter around the frame period keep their order
+    duration = __atomic_load_n(&media->duration, __ATOMIC_RELAXED);
+
+    return &media->pending[((duration > 0) ? (pts + duration / 2) / duration : 0) % CU_RTSP_PENDING_FRAMES];
+}
+
+static void cuRTSPMediaTrackFrame(
+    CUrtsp_media_st *media,
+    GstClockTime pts,
+    GstClockTime capture)
+{
+    CUrtsp_pending_frame *slot;
+
+    slot = cuRTSPMediaPendingSlot(media, pts);
+    __atomic_store_n(&slot->pts, GST_CLOCK_TIME_NONE, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&slot->frame, media->frame_count, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->capture, capture, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->pushed, g_get_monotonic_time() * GST_USECOND, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->encoded, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->pts, pts, __ATOMIC_RELEASE);
+}
+
+static GstPadProbeReturn cuRTSPMediaFenced(
+    GstPad *pad,
+    GstPadProbeInfo *info,
+    CUrtsp_media_st *media)
+{
+    GstBuffer *buffer;
+    CUrtsp_fence_st *fence;
+
+    buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    fence = gst_mini_object_steal_qdata(GST_MINI_OBJECT(buffer), FENCE_QUARK);
+    if (fence != NULL)
+    {
+        cuRTSPFenceRelease(fence);
+    }
+
+    return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn cuRTSPMediaEncoded(
+    GstPad *pad,
+    GstPadProbeInfo *info,
+    CUrtsp_media_st *media)
+{
+    GstBuffer *buffer;
+    GstClockTime now;
+    GstClockTime pushed;
+    CUrtsp_pending_frame *slot;
+    gint encoded;
+
+    buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    if (buffer == NULL || !GST_BUFFER_PTS_IS_VALID(buffer))
+    {
+        return GST_PAD_PROBE_OK;
+    }
+
+    cuRTSPCounterAdd(&media->session->stats.framesEncoded, 1);
+    now = g_get_monotonic_time() * GST_USECOND;
+    slot = cuRTSPMediaPendingSlot(media, GST_BUFFER_PTS(buffer));
+    if (__atomic_load_n(&slot->pts, __ATOMIC_ACQUIRE) == GST_BUFFER_PTS(buffer))
+    {
+        pushed = __atomic_load_n(&slot->pushed, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        encoded = 0;
+        if (__atomic_load_n(&slot->pts, __ATOMIC_RELAXED) == GST_BUFFER_PTS(buffer) &&
+            __atomic_compare_exchange_n(&slot->encoded, &encoded, 1, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        {
+            cuRTSPHistogramAdd(&media->session->stats.encodeLatency, (now - pushed) / GST_USECOND);
+        }
+    }
+    if (GST_CLOCK_TIME_IS_VALID(__atomic_load_n(&media->join_start, __ATOMIC_RELAXED)) && !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT))
+    {
+        g_mutex_lock(&media->lock);
+        if (GST_CLOCK_TIME_IS_VALID(media->join_start) && !GST_CLOCK_TIME_IS_VALID(media->join_pts))
+        {
+            __atomic_store_n(&media->join_pts, GST_BUFFER_PTS(buffer), __ATOMIC_RELEASE);
+        }
+        g_mutex_unlock(&media->lock);
+    }
+
+    return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn cuRTSPMediaPayloaded(
+    GstPad *pad,
+    GstPadProbeInfo *info,
+    CUrtsp_media_st *media)
+{
+    GstBuffer *buffer;
+    GstClockTime now;
+    GstClockTime latency;
+    GstClockTime join;
+    GstClockTime pts;
+    CUrtsp_pending_frame *slot;
+    guint64 frame;
+    bool found;
+
+    found = false;
+    frame = 0;
+    latency = GST_CLOCK_TIME_NONE;
+    join = GST_CLOCK_TIME_NONE;
+
+    buffer = cuRTSPProbeBuffer(info);
+    if (buffer == NULL || !GST_BUFFER_PTS_IS_VALID(buffer))
+    {
+        return GST_PAD_PROBE_OK;
+    }
+
+    // every packet carries the frame's timestamp, only the first claims the slot
+    now = g_get_monotonic_time() * GST_USECOND;
+    pts = GST_BUFFER_PTS(buffer);
+    if (pts != media->payloaded_pts)
+    {
+        media->payloaded_pts = pts;
+        cuRTSPCounterAdd(&media->payloaded, 1);
+    }
+    if (!GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT) && __atomic_load_n(&media->resuming, __ATOMIC_ACQUIRE) != NULL)
+    {
+        cuRTSPMediaResume(media);
+    }
+    slot = cuRTSPMediaPendingSlot(media, pts);
+    if (__atomic_load_n(&slot->pts, __ATOMIC_ACQUIRE) == pts)
+    {
+        frame = __atomic_load_n(&slot->frame, __ATOMIC_RELAXED);
+        latency = __atomic_load_n(&slot->capture, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        found = __atomic_compare_exchange_n(&slot->pts, &pts, GST_CLOCK_TIME_NONE, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        latency = GST_CLOCK_TIME_IS_VALID(latency) ? now - latency : GST_CLOCK_TIME_NONE;
+    }
+    if (__atomic_load_n(&media->join_pts, __ATOMIC_ACQUIRE) == GST_BUFFER_PTS(buffer))
+    {
+        g_mutex_lock(&media->lock);
+        if (media->join_pts == GST_BUFFER_PTS(buffer))
+        {
+            join = now - media->join_start;
+            __atomic_store_n(&media->join_start, GST_CLOCK_TIME_NONE, __ATOMIC_RELAXED);
+            __atomic_store_n(&media->join_pts, GST_CLOCK_TIME_NONE, __ATOMIC_RELEASE);
+        }
+        g_mutex_unlock(&media->lock);
+    }
+
+    if (GST_CLOCK_TIME_IS_VALID(join))
+    {
+        cuRTSPHistogramAdd(&media->session->stats.joinLatency, join / GST_USECOND);
+    }
+
+    if (found && GST_CLOCK_TIME_IS_VALID(latency))
+    {
+        cuRTSPHistogramAdd(&media->session->stats.captureLatency, latency / GST_USECOND);
+        if (media->session->session_info.latencyCallback != NULL && !g_atomic_int_get(&media->session->destroyed))
+        {
+            media->session->session_info.latencyCallback(frame, latency, media->session->session_info.userData);
+        }
+    }
+
+    return GST_PAD_PROBE_OK;
+}
+
+static void cuRTSPMediaResume(
+    CUrtsp_media_st *media)
+{
+    CUrtsp_backpressure_st *state;
+    GList *item;
+    uint64_t frame;
+
+    // the key unit itself is not skipped
+    frame = __atomic_load_n(&media->payloaded, __ATOMIC_RELAXED) - 1;
+    g_mutex_lock(&media->lock);
+    for (item = media->resuming; item != NULL; item = item->next)
+    {
+        state = (CUrtsp_backpressure_st *)item->data;
+        gst_rtsp_stream_transport_set_active(state->transport, TRUE);
+        cuRTSPCounterAdd(&state->frames_skipped, frame - state->frame);
+        __atomic_store_n(&state->seen_bytes, __atomic_load_n(&media->interleaved_bytes, __ATOMIC_RELAXED), __ATOMIC_RELEASE);
+        __atomic_store_n(&state->seen_packets, __atomic_load_n(&media->interleaved_packets, __ATOMIC_RELAXED), __ATOMIC_RELEASE);
+        __atomic_store_n(&state->throttled, false, __ATOMIC_RELAXED);
+        state->waiting = false;
+    }
+    g_list_free(media->resuming);
+    __atomic_store_n(&media->resuming, NULL, __ATOMIC_RELEASE);
+    g_mutex_unlock(&media->lock);
+}
+
+static void cuRTSPMediaTraceUpdate(
+    CUrtsp_media_st *media)
+{
+    bool enabled;
+
+    enabled = cuRTSPTraceEnabled();
+    g_mutex_lock(&media->lock);
+    if (enabled && !media->tracing)
+    {
+        cuRTSPMediaTraceElements(media);
+    }
+    else if (!enabled && media->tracing)
+    {
+        cuRTSPMediaTraceRemove(media);
+    }
+    media->tracing = enabled;
+    g_mutex_unlock(&media->lock);
+}
+
+static void cuRTSPMediaTraceElements(
+    CUrtsp_media_st *media)
+{
+    GstObject *pipeline;
+    GstIterator *iterator;
+    GValue item = G_VALUE_INIT;
+    GstElement *element;
+    GstPad *pad;
+
+    iterator = gst_bin_iterate_elements(GST_BIN(media->bin));
+    while (gst_iterator_next(iterator, &item) == GST_ITERATOR_OK)
+    {
+        element = g_value_get_object(&item);
+        // a stage runs from its sink pad to its src pad, the appsrc stage starts at push-buffer
+        pad = gst_element_get_static_pad(element, "src");
+        if (pad != NULL)
+        {
+            cuRTSPMediaTraceProbe(media, element, "sink", 'b');
+            cuRTSPMediaTraceProbe(media, element, "src", 'e');
+            gst_object_unref(pad);
+        }
+        g_value_reset(&item);
+    }
+    g_value_unset(&item);
+    gst_iterator_free(iterator);
+
+    pipeline = gst_object_get_parent(GST_OBJECT(media->bin));
+    if (pipeline != NULL)
+    {
+        iterator = gst_bin_iterate_sinks(GST_BIN(pipeline));
+        while (gst_iterator_next(iterator, &item) == GST_ITERATOR_OK)
+        {
+            element = g_value_get_object(&item);
+            if (element != media->bin)
+            {
+                cuRTSPMediaTraceProbe(media, element, "sink", 'n');
+            }
+            g_value_reset(&item);
+        }
+        g_value_unset(&item);
+        gst_iterator_free(iterator);
+        gst_object_unref(pipeline);
+    }
+}
+
+static void cuRTSPMediaTraceRemove(
+    CUrtsp_media_st *media)
+{
+    CUrtsp_trace_pad *trace_pad;
+    guint index;
+
+    for (index = 0; index < media->trace_pads->len; index++)
+    {
+        trace_pad = &g_array_index(media->trace_pads, CUrtsp_trace_pad, index);
+        gst_pad_remove_probe(trace_pad->pad, trace_pad->id);
+        gst_object_unref(trace_pad->pad);
+    }
+    g_array_set_size(media->trace_pads, 0);
+}
+
+static void cuRTSPMediaTraceUnprepared(
+    GstRTSPMedia *media,
+    CUrtsp_media_st *media_state)
+{
+    g_mutex_lock(&media_state->lock);
+    cuRTSPMediaTraceRemove(media_state);
+    media_state->tracing = false;
+    g_mutex_unlock(&media_state->lock);
+}
+
+static void cuRTSPMediaTraceProbe(
+    CUrtsp_media_st *media,
+    GstElement *element,
+    const char *pad_name,
+    char phase)
+{
+    GstElementFactory *factory;
+    CUrtsp_trace_probe *probe;
+    CUrtsp_trace_pad trace_pad;
+    GstPad *pad;
+
+    factory = gst_element_get_factory(element);
+    pad = gst_element_get_static_pad(element, pad_name);
+    if (factory != NULL && pad != NULL)
+    {
+        probe = g_new0(CUrtsp_trace_probe, 1);
+        probe->media = media;
+        probe->name = g_intern_string(gst_plugin_feature_get_name(GST_PLUGIN_FEATURE(factory)));
+        probe->phase = phase;
+        probe->last_pts = GST_CLOCK_TIME_NONE;
+        trace_pad.pad = pad;
+        trace_pad.id = gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST, (GstPadProbeCallback)cuRTSPMediaTraced, probe, g_free);
+        g_array_append_val(media->trace_pads, trace_pad);
+    }
+    else if (pad != NULL)
+    {
+        gst_object_unref(pad);
+    }
+}
+
+static GstPadProbeReturn cuRTSPMediaTraced(
+    GstPad *pad,
+    GstPadProbeInfo *info,
+    CUrtsp_trace_probe *probe)
+{
+    GstBuffer *buffer;
+    guint64 frame;
+
+    if (!cuRTSPTraceEnabled())
+    {
+        return GST_PAD_PROBE_OK;
+    }
+
+    // payloaders and sinks see every packet of a frame, only the first one counts
+    buffer = cuRTSPProbeBuffer(info);
+    if (buffer == NULL || !GST_BUFFER_PTS_IS_VALID(buffer) || GST_BUFFER_PTS(buffer) == probe->last_pts)
+    {
+        return GST_PAD_PROBE_OK;
+    }
+
+    if (cuRTSPMediaTracedFrame(probe->media, GST_BUFFER_PTS(buffer), &frame))
+    {
+        probe->last_pts = GST_BUFFER_PTS(buffer);
+        cuRTSPTraceFrame(probe->name, probe->phase, probe->media->session->trace_id, probe->media->trace_id, frame, GST_BUFFER_PTS(buffer), g_get_monotonic_time());
+    }
+
+    return GST_PAD_PROBE_OK;
+}
+
+static void cuRTSPMediaTraceFrame(
+    CUrtsp_media_st *media,
+    GstClockTime pts,
+    guint64 frame)
+{
+    g_mutex_lock(&media->lock);
+    media->traced[frame % CU_RTSP_PENDING_FRAMES].pts = pts;
+    media->traced[frame % CU_RTSP_PENDING_FRAMES].frame = frame;
+    g_mutex_unlock(&media->lock);
+    cuRTSPTraceFrame("appsrc", 'b', media->session->trace_id, media->trace_id, frame, pts, g_get_monotonic_time());
+}
+
+static bool cuRTSPMediaTracedFrame(
+    CUrtsp_media_st *media,
+    GstClockTime pts,
+    guint64 *pFrame)
+{
+    bool found;
+    size_t index;
+
+    found = false;
+    g_mutex_lock(&media->lock);
+    for (index = 0; index < CU_RTSP_PENDING_FRAMES && !found; index++)
+    {
+        if (media->traced[index].pts == pts)
+        {
+            *pFrame = media->traced[index].frame;
+            found = true;
+        }
+    }
+    g_mutex_unlock(&media->lock);
+
+    return found;
+}
+
+static void cuRTSPMediaPrepared(
+    GstRTSPMedia *media,
+    CUrtsp_media_st *media_state)
+{
+    GstRTSPStream *stream;
+    GObject *rtp_session;
+    guint index;
+
+    for (index = 0; index < gst_rtsp_media_n_streams(media); index++)
+    {
+        stream = gst_rtsp_media_get_stream(media, index);
+        rtp_session = gst_rtsp_stream_get_rtpsession(stream);
+        if (rtp_session != NULL)
+        {
+            g_signal_connect(rtp_session, "on-ssrc-active", (GCallback)cuRTSPMediaFeedback, media_state);
+            g_object_unref(rtp_session);
+        }
+    }
+}
+
+static void cuRTSPMediaFeedback(
+    GObject *rtp_session,
+    GObject *source,
+    CUrtsp_media_st *media)
+{
+    const CUDA_RTSP_ENCODER *pEncoder;
+    GstStructure *stats;
+    GHashTableIter iter;
+    CUrtsp_receiver *receiver;
+    gboolean internal;
+    gboolean have_rb;
+    guint fraction_lost;
+    guint round_trip;
+    guint worst_loss;
+    guint ssrc;
+    unsigned int bitrate;
+    bool congested;
+    gint64 now;
+
+    g_object_get(source, "stats", &stats, "ssrc", &ssrc, NULL);
+    internal = FALSE;
+    have_rb = FALSE;
+    round_trip = 0;
+    gst_structure_get_boolean(stats, "internal", &internal);
+    gst_structure_get_boolean(stats, "have-rb", &have_rb);
+    if (internal || !have_rb || !gst_structure_get_uint(stats, "rb-fractionlost", &fraction_lost))
+    {
+        gst_structure_free(stats);
+        return;
+    }
+    gst_structure_get_uint(stats, "rb-round-trip", &round_trip);
+    gst_structure_free(stats);
+
+    pEncoder = &media->session->session_info.encoder;
+    now = g_get_monotonic_time();
+    g_mutex_lock(&media->lock);
+    receiver = g_hash_table_lookup(media->receivers, GUINT_TO_POINTER(ssrc));
+    if (receiver == NULL)
+    {
+        receiver = calloc(1, sizeof(CUrtsp_receiver));
+        g_hash_table_insert(media->receivers, GUINT_TO_POINTER(ssrc), receiver);
+    }
+    receiver->fraction_lost = fraction_lost;
+    receiver->round_trip = round_trip;
+    receiver->updated = now;
+    if (round_trip > 0 && (receiver->min_round_trip == 0 || round_trip < receiver->min_round_trip))
+    {
+        receiver->min_round_trip = round_trip;
+    }
+
+    // a shared media follows its worst receiver, each judged against its own minimum round trip
+    congested = false;
+    worst_loss = 0;
+    g_hash_table_iter_init(&iter, media->receivers);
+    while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&receiver))
+    {
+        if (now - receiver->updated > CU_RTSP_ABR_RECEIVER_TIMEOUT)
+        {
+            g_hash_table_iter_remove(&iter);
+            continue;
+        }
+        worst_loss = MAX(worst_loss, receiver->fraction_lost);
+        congested = congested || receiver->fraction_lost > CU_RTSP_ABR_LOSS_HIGH ||
+                    (receiver->round_trip > 2 * receiver->min_round_trip && receiver->round_trip - receiver->min_round_trip > CU_RTSP_ABR_QUEUE_DELAY);
+    }
+    bitrate = media->bitrate;
+    if (congested && now - media->bitrate_changed >= CU_RTSP_ABR_DECREASE_INTERVAL)
+    {
+        bitrate = MAX(bitrate - bitrate / 8, pEncoder->minBitrate);
+    }
+    else if (!congested && worst_loss < CU_RTSP_ABR_LOSS_LOW && now - media->bitrate_changed >= CU_RTSP_ABR_INCREASE_INTERVAL)
+    {
+        bitrate = MIN(bitrate + MAX(pEncoder->maxBitrate / 20, 1), pEncoder->maxBitrate);
+    }
+    if (bitrate == media->bitrate)
+    {
+        g_mutex_unlock(&media->lock);
+        return;
+    }
+    media->bitrate = bitrate;
+    media->bitrate_changed = now;
+    g_mutex_unlock(&media->lock);
+
+    cuRTSPEncoderSetBitrate(media->encoder, media->session->encoder, bitrate);
+    __atomic_store_n(&media->session->stats.bitrate, bitrate, __ATOMIC_RELAXED);
+}
+
+static CUrtsp_media_st *cuRTSPMediaState(GstRTSPMedia *media)
+{
+    GstElement *pipeline;
+    GstElement *appsrc;
+    CUrtsp_media_st *result;
+
+    result = NULL;
+    pipeline = gst_rtsp_media_get_element(media);
+    appsrc = gst_bin_get_by_name_recurse_up(GST_BIN(pipeline), "source");
+    if (appsrc != NULL)
+    {
+        result = g_object_get_data(G_OBJECT(appsrc), "cu-rtsp-media");
+        gst_object_unref(appsrc);
+    }
+    gst_object_unref(pipeline);
+
+    return result;
+}
+
+static CUrtsp_session cuRTSPMediaSession(GstRTSPMedia *media)
+{
+    CUrtsp_media_st *media_state;
+
+    media_state = cuRTSPMediaState(media);
+
+    return (media_state != NULL) ? media_state->session : NULL;
+}
+
+static void cuRTSPServerClientConnected(
+    GstRTSPServer *server,
+    GstRTSPClient *client,
+    CUrtsp_server hServer)
+{
+    g_signal_connect(client, "describe-request", (GCallback)cuRTSPClientDescribe, NULL);
+    g_signal_connect(client, "play-request", (GCallback)cuRTSPClientPlay, hServer);
+}
+
+static void cuRTSPClientDescribe(
+    GstRTSPClient *client,
+    GstRTSPContext *ctx,
+    gpointer user_data)
+{
+    GstClockTime *describe;
+
+    describe = g_new(GstClockTime, 1);
+    *describe = g_get_monotonic_time() * GST_USECOND;
+    g_object_set_data_full(G_OBJECT(client), "cu-rtsp-describe", describe, g_free);
+}
+
+static void cuRTSPClientPlay(
+    GstRTSPClient *client,
+    GstRTSPContext *ctx,
+    CUrtsp_server hServer)
+{
+    CUrtsp_media_st *media_state;
+    GstClockTime *describe;
+    GstClockTime start;
+    GSource *source;
+    GPtrArray *transports;
+    GstRTSPStreamTransport *transport;
+    guint index;
+
+    if (ctx->media == NULL)
+    {
+        return;
+    }
+
+    media_state = cuRTSPMediaState(ctx->media);
+    if (media_state == NULL)
+    {
+        return;
+    }
+
+    describe = g_object_get_data(G_OBJECT(client), "cu-rtsp-describe");
+    start = (describe != NULL) ? *describe : g_get_monotonic_time() * GST_USECOND;
+    g_object_set_data(G_OBJECT(client), "cu-rtsp-describe", NULL);
+    g_mutex_lock(&media_state->lock);
+    if (!GST_CLOCK_TIME_IS_VALID(media_state->join_start))
+    {
+        __atomic_store_n(&media_state->join_pts, GST_CLOCK_TIME_NONE, __ATOMIC_RELEASE);
+        __atomic_store_n(&media_state->join_start, start, __ATOMIC_RELAXED);
+    }
+    g_mutex_unlock(&media_state->lock);
+
+    cuRTSPMediaForceKeyUnit(ctx->media);
+
+    if (media_state->session->session_info.segmentationOffload)
+    {
+        cuRTSPMediaOffload(ctx->media, media_state);
+    }
+
+    transports = (ctx->sessmedia != NULL) ? gst_rtsp_session_media_get_transports(ctx->sessmedia) : NULL;
+    for (index = 0; transports != NULL && index < transports->len; index++)
+    {
+        transport = g_ptr_array_index(transports, index);
+        if (transport != NULL && gst_rtsp_stream_transport_get_transport(transport)->lower_transport == GST_RTSP_LOWER_TRANS_TCP)
+        {
+            cuRTSPMediaCountInterleaved(ctx->media, media_state);
+            cuRTSPTransportTrack(ctx->media, transport);
+        }
+    }
+    if (transports != NULL)
+    {
+        g_ptr_array_unref(transports);
+    }
+
+    if (media_state->session->session_info.backpressure.maxQueueBytes > 0)
+    {
+        cuRTSPMediaCountInterleaved(ctx->media, media_state);
+        source = g_main_current_source();
+        cuRTSPClientBackpressureStart(client, (source != NULL) ? g_source_get_context(source) : hServer->context);
+    }
+}
+
+static void cuRTSPMediaForceKeyUnit(GstRTSPMedia *media)
+{
+    GstElement *pipeline;
+    GstElement *encoder;
+    GstPad *pad;
+
+    pipeline = gst_rtsp_media_get_element(media);
+    encoder = gst_bin_get_by_name_recurse_up(GST_BIN(pipeline), "encoder");
+    if (encoder != NULL)
+    {
+        pad = gst_element_get_static_pad(encoder, "src");
+        gst_pad_send_event(pad, gst_video_event_new_upstream_force_key_unit(GST_CLOCK_TIME_NONE, TRUE, 0));
+        gst_object_unref(pad);
+        gst_object_unref(encoder);
+    }
+    gst_object_unref(pipeline);
+}
+
+static void cuRTSPMediaOffload(
+    GstRTSPMedia *media,
+    CUrtsp_media_st *media_state)
+{
+    GstElement *bin;
+    GstObject *pipeline;
+    GstIterator *iterator;
+    GValue item = G_VALUE_INIT;
+    GstElement *element;
+    GstElementFactory *factory;
+    GSocket *socket;
+    GSocket *socket_v6;
+    GstPad *pad;
+    bool offload;
+
+    bin = gst_rtsp_media_get_element(media);
+    pipeline = gst_object_get_parent(GST_OBJECT(bin));
+    if (pipeline == NULL)
+    {
+        gst_object_unref(bin);
+        return;
+    }
+    g_mutex_lock(&media_state->lock);
+    iterator = gst_bin_iterate_sinks(GST_BIN(pipeline));
+    while (gst_iterator_next(iterator, &item) == GST_ITERATOR_OK)
+    {
+        element = g_value_get_object(&item);
+        factory = gst_element_get_factory(element);
+        if (factory != NULL && strcmp(gst_plugin_feature_get_name(GST_PLUGIN_FEATURE(factory)), "multiudpsink") == 0 &&
+            g_object_get_data(G_OBJECT(element), "cu-rtsp-offload") == NULL)
+        {
+            g_object_get(G_OBJECT(element), "socket", &socket, "socket-v6", &socket_v6, NULL);
+            offload = (socket != NULL || socket_v6 != NULL) &&
+                      (socket == NULL || cuRTSPMediaOffloadSocket(media, socket, (int)media_state->mtu)) &&
+                      (socket_v6 == NULL || cuRTSPMediaOffloadSocket(media, socket_v6, (int)media_state->mtu));
+            if (offload)
+            {
+                g_object_set_data(G_OBJECT(element), "cu-rtsp-offload", GINT_TO_POINTER(1));
+                pad = gst_element_get_static_pad(element, "sink");
+                gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER_LIST, cuRTSPMediaOffloaded, GUINT_TO_POINTER(media_state->mtu), NULL);
+                gst_object_unref(pad);
+            }
+            g_clear_object(&socket);
+            g_clear_object(&socket_v6);
+        }
+        g_value_reset(&item);
+    }
+    g_value_unset(&item);
+    gst_iterator_free(iterator);
+    g_mutex_unlock(&media_state->lock);
+    gst_object_unref(pipeline);
+    gst_object_unref(bin);
+}
+
+static bool cuRTSPMediaOffloadSocket(
+    GstRTSPMedia *media,
+    GSocket *socket,
+    int segment)
+{
+    GstRTSPStream *stream;
+    GSocket *rtp_socket;
+    bool found;
+    guint index;
+
+    found = false;
+    for (index = 0; index < gst_rtsp_media_n_streams(media) && !found; index++)
+    {
+        stream = gst_rtsp_media_get_stream(media, index);
+        rtp_socket = gst_rtsp_stream_get_rtp_socket(stream, g_socket_get_family(socket));
+        found = rtp_socket == socket;
+        g_clear_object(&rtp_socket);
+    }
+#ifdef UDP_SEGMENT
+    // kernels before 4.18 refuse the option
+    return found && setsockopt(g_socket_get_fd(socket), IPPROTO_UDP, UDP_SEGMENT, &segment, sizeof(segment)) == 0;
+#else
+    return false;
+#endif
+}
+
+static GstPadProbeReturn cuRTSPMediaOffloaded(
+    GstPad *pad,
+    GstPadProbeInfo *info,
+    gpointer user_data)
+{
+    const gsize segment = GPOINTER_TO_UINT(user_data);
+    GstBufferList *list;
+    GstBufferList *offloaded;
+    GstBuffer *buffer;
+    GstBuffer *datagram;
+    gsize size;
+    gsize next;
+    guint memories;
+    guint length;
+    guint start;
+    guint end;
+    guint index;
+    guint memory;
+
+    list = GST_PAD_PROBE_INFO_BUFFER_LIST(info);
+    length = gst_buffer_list_length(list);
+    offloaded = gst_buffer_list_new_sized(length);
+    for (start = 0; start < length; start = end)
+    {
+        // a run holds full segments only and fits in one buffer's memories
+        buffer = gst_buffer_list_get(list, start);
+        size = gst_buffer_get_size(buffer);
+        memories = gst_buffer_n_memory(buffer);
+        for (end = start + 1; end < length && size == (end - start) * segment && end - start < CU_RTSP_GSO_SEGMENTS; end++)
+        {
+            buffer = gst_buffer_list_get(list, end);
+            next = gst_buffer_get_size(buffer);
+            if (next > segment || size + next > CU_RTSP_GSO_BYTES || memories + gst_buffer_n_memory(buffer) > gst_buffer_get_max_memory())
+            {
+                break;
+            }
+            size += next;
+            memories += gst_buffer_n_memory(buffer);
+        }
+        if (end - start == 1)
+        {
+            gst_buffer_list_add(offloaded, gst_buffer_ref(gst_buffer_list_get(list, start)));
+            continue;
+        }
+        datagram = gst_buffer_new();
+        gst_buffer_copy_into(datagram, gst_buffer_list_get(list, start), GST_BUFFER_COPY_METADATA, 0, -1);
+        for (index = start; index < end; index++)
+        {
+            buffer = gst_buffer_list_get(list, index);
+            for (memory = 0; memory < gst_buffer_n_memory(buffer); memory++)
+            {
+                gst_buffer_append_memory(datagram, gst_buffer_get_memory(buffer, memory));
+            }
+        }
+        gst_buffer_list_add(offloaded, datagram);
+    }
+    gst_buffer_list_unref(list);
+    GST_PAD_PROBE_INFO_DATA(info) = offloaded;
+
+    return GST_PAD_PROBE_OK;
+}
+
+static void cuRTSPMediaCountInterleaved(
+    GstRTSPMedia *media,
+    CUrtsp_media_st *media_state)
+{
+    GstElement *bin;
+    GstObject *pipeline;
+    GstIterator *iterator;
+    GValue item = G_VALUE_INIT;
+    GstElement *element;
+    GstElementFactory *factory;
+    GstPad *pad;
+
+    bin = gst_rtsp_media_get_element(media);
+    pipeline = gst_object_get_parent(GST_OBJECT(bin));
+    if (pipeline == NULL)
+    {
+        gst_object_unref(bin);
+        return;
+    }
+    g_mutex_lock(&media_state->lock);
+    iterator = gst_bin_iterate_sinks(GST_BIN(pipeline));
+    while (gst_iterator_next(iterator, &item) == GST_ITERATOR_OK)
+    {
+        element = g_value_get_object(&item);
+        factory = gst_element_get_factory(element);
+        if (factory != NULL && strcmp(gst_plugin_feature_get_name(GST_PLUGIN_FEATURE(factory)), "appsink") == 0 &&
+            g_object_get_data(G_OBJECT(element), "cu-rtsp-interleaved") == NULL)
+        {
+            g_object_set_data(G_OBJECT(element), "cu-rtsp-interleaved", GINT_TO_POINTER(1));
+            pad = gst_element_get_static_pad(element, "sink");
+            gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST, (GstPadProbeCallback)cuRTSPMediaInterleaved, media_state, NULL);
+            gst_object_unref(pad);
+        }
+        g_value_reset(&item);
+    }
+    g_value_unset(&item);
+    gst_iterator_free(iterator);
+    g_mutex_unlock(&media_state->lock);
+    gst_object_unref(pipeline);
+    gst_object_unref(bin);
+}
+
+static GstPadProbeReturn cuRTSPMediaInterleaved(
+    GstPad *pad,
+    GstPadProbeInfo *info,
+    CUrtsp_media_st *media)
+{
+    GstBufferList *list;
+    uint64_t bytes;
+    uint64_t packets;
+    guint index;
+
+    if (GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_BUFFER_LIST)
+    {
+        list = GST_PAD_PROBE_INFO_BUFFER_LIST(info);
+        bytes = 0;
+        packets = gst_buffer_list_length(list);
+        for (index = 0; index < packets; index++)
+        {
+            bytes += gst_buffer_get_size(gst_buffer_list_get(list, index));
+        }
+    }
+    else
+    {
+        bytes = gst_buffer_get_size(GST_PAD_PROBE_INFO_BUFFER(info));
+        packets = 1;
+    }
+    cuRTSPCounterAdd(&media->interleaved_bytes, bytes);
+    cuRTSPCounterAdd(&media->interleaved_packets, packets);
+
+    return GST_PAD_PROBE_OK;
+}
+
+static void cuRTSPClientBackpressureStart(
+    GstRTSPClient *client,
+    GMainContext *context)
+{
+    CUrtsp_client_queue_st *queue;
+
+    if (g_object_get_data(G_OBJECT(client), "cu-rtsp-client-queue") != NULL)
+    {
+        return;
+    }
+
+    queue = g_new0(CUrtsp_client_queue_st, 1);
+    queue->source = g_timeout_source_new(CU_RTSP_BACKPRESSURE_INTERVAL_MS);
+    g_source_set_callback(queue->source, (GSourceFunc)cuRTSPClientBackpressure, g_object_ref(client), g_object_unref);
+    g_source_attach(queue->source, context);
+    // the source holds the client, so it is destroyed on close
+    g_object_set_data_full(G_OBJECT(client), "cu-rtsp-client-queue", queue, (GDestroyNotify)cuRTSPClientBackpressureFree);
+    g_signal_connect(client, "closed", (GCallback)cuRTSPClientClosed, NULL);
+}
+
+static void cuRTSPClientBackpressureFree(
+    CUrtsp_client_queue_st *queue)
+{
+    g_source_destroy(queue->source);
+    g_source_unref(queue->source);
+    g_free(queue);
+}
+
+static void cuRTSPClientClosed(
+    GstRTSPClient *client,
+    gpointer user_data)
+{
+    g_object_set_data(G_OBJECT(client), "cu-rtsp-client-queue", NULL);
+}
+
+static gboolean cuRTSPClientBackpressure(
+    GstRTSPClient *client)
+{
+    CUrtsp_client_queue_st *queue;
+    GstRTSPConnection *connection;
+    GSocket *socket;
+    uint64_t pending;
+    uint64_t acked;
+#ifdef __linux__
+    struct tcp_info info;
+    socklen_t length;
+    int queued;
+#endif
+
+    queue = g_object_get_data(G_OBJECT(client), "cu-rtsp-client-queue");
+    connection = gst_rtsp_client_get_connection(client);
+    socket = (connection != NULL) ? gst_rtsp_connection_get_write_socket(connection) : NULL;
+    if (queue == NULL || socket == NULL)
+    {
+        return G_SOURCE_CONTINUE;
+    }
+
+    pending = 0;
+    acked = 0;
+#ifdef __linux__
+    if (ioctl(g_socket_get_fd(socket), SIOCOUTQ, &queued) == 0 && queued > 0)
+    {
+        pending = (uint64_t)queued;
+    }
+    length = sizeof(info);
+    if (getsockopt(g_socket_get_fd(socket), IPPROTO_TCP, TCP_INFO, &info, &length) == 0)
+    {
+        acked = info.tcpi_bytes_acked;
+    }
+#endif
+    if (!queue->started)
+    {
+        queue->acked = acked;
+        queue->started = true;
+    }
+
+    // anything handed over and not acknowledged is queued in the kernel or the client's watch
+    queue->now = g_get_monotonic_time();
+    cuRTSPClientTransports(client, cuRTSPTransportHanded, queue);
+    // an empty kernel queue holds nothing back, counting starts over
+    if (pending == 0)
+    {
+        queue->handed = acked - queue->acked;
+    }
+    queue->queued = (queue->handed > acked - queue->acked) ? queue->handed - (acked - queue->acked) : 0;
+    queue->queued = MAX(queue->queued, pending);
+    queue->disconnect = false;
+    cuRTSPClientTransports(client, cuRTSPTransportBackpressure, queue);
+    if (queue->disconnect)
+    {
+        gst_rtsp_client_close(client);
+        return G_SOURCE_REMOVE;
+    }
+
+    return G_SOURCE_CONTINUE;
+}
+
+static void cuRTSPClientTransports(
+    GstRTSPClient *client,
+    CUrtspTransportFunc func,
+    CUrtsp_client_queue_st *queue)
+{
+    GList *sessions;
+    GList *medias;
+    GList *session_iter;
+    GList *media_iter;
+    GPtrArray *transports;
+    GstRTSPStreamTransport *transport;
+    GstRTSPMedia *media;
+    CUrtsp_session hSession;
+    guint index;
+
+    sessions = gst_rtsp_client_session_filter(client, NULL, NULL);
+    for (session_iter = sessions; session_iter != NULL; session_iter = session_iter->next)
+    {
+        medias = gst_rtsp_session_filter(GST_RTSP_SESSION(session_iter->data), NULL, NULL);
+        for (media_iter = medias; media_iter != NULL; media_iter = media_iter->next)
+        {
+            media = gst_rtsp_session_media_get_media(GST_RTSP_SESSION_MEDIA(media_iter->data));
+            hSession = cuRTSPMediaSession(media);
+            if (hSession == NULL || hSession->session_info.backpressure.maxQueueBytes == 0)
+            {
+                continue;
+            }
+            transports = gst_rtsp_session_media_get_transports(GST_RTSP_SESSION_MEDIA(media_iter->data));
+            for (index = 0; transports != NULL && index < transports->len; index++)
+            {
+                transport = g_ptr_array_index(transports, index);
+                if (transport != NULL && gst_rtsp_stream_transport_get_transport(transport)->lower_transport == GST_RTSP_LOWER_TRANS_TCP)
+                {
+                    func(hSession, media, transport, queue);
+                }
+            }
+            if (transports != NULL)
+            {
+                g_ptr_array_unref(transports);
+            }
+        }
+        g_list_free_full(medias, g_object_unref);
+    }
+    g_list_free_full(sessions, g_object_unref);
+}
+
+static void cuRTSPTransportHanded(
+    CUrtsp_session hSession,
+    GstRTSPMedia *media,
+    GstRTSPStreamTransport *transport,
+    CUrtsp_client_queue_st *queue)
+{
+    CUrtsp_backpressure_st *state;
+    CUrtsp_media_st *media_state;
+    uint64_t bytes;
+    uint64_t packets;
+
+    media_state = cuRTSPMediaState(media);
+    state = cuRTSPTransportTrack(media, transport);
+    if (media_state == NULL || state == NULL)
+    {
+        return;
+    }
+    g_mutex_lock(&media_state->lock);
+    bytes = __atomic_load_n(&media_state->interleaved_bytes, __ATOMIC_RELAXED) - state->seen_bytes;
+    packets = __atomic_load_n(&media_state->interleaved_packets, __ATOMIC_RELAXED) - state->seen_packets;
+    // every packet goes out behind a four byte interleaved header
+    if (!state->throttled)
+    {
+        queue->handed += bytes + 4 * packets;
+        cuRTSPCounterAdd(&state->bytes_sent, bytes);
+        cuRTSPCounterAdd(&state->packets_sent, packets);
+    }
+    __atomic_store_n(&state->seen_bytes, state->seen_bytes + bytes, __ATOMIC_RELEASE);
+    __atomic_store_n(&state->seen_packets, state->seen_packets + packets, __ATOMIC_RELEASE);
+    g_mutex_unlock(&media_state->lock);
+}
+
+static CUrtsp_backpressure_st *cuRTSPTransportTrack(
+    GstRTSPMedia *media,
+    GstRTSPStreamTransport *transport)
+{
+    CUrtsp_backpressure_st *state;
+    CUrtsp_media_st *media_state;
+
+    media_state = cuRTSPMediaState(media);
+    state = g_object_get_data(G_OBJECT(transport), "cu-rtsp-backpressure");
+    if (state == NULL && media_state != NULL)
+    {
+        state = g_new0(CUrtsp_backpressure_st, 1);
+        state->transport = transport;
+        state->media = media_state;
+        state->seen_bytes = __atomic_load_n(&media_state->interleaved_bytes, __ATOMIC_RELAXED);
+        state->seen_packets = __atomic_load_n(&media_state->interleaved_packets, __ATOMIC_RELAXED);
+        g_object_set_data_full(G_OBJECT(transport), "cu-rtsp-backpressure", state, (GDestroyNotify)cuRTSPTransportForget);
+    }
+
+    return state;
+}
+
+static void cuRTSPTransportForget(
+    CUrtsp_backpressure_st *state)
+{
+    CUrtsp_media_st *media;
+
+    media = state->media;
+    if (media != NULL)
+    {
+        g_mutex_lock(&media->lock);
+        __atomic_store_n(&media->resuming, g_list_remove(media->resuming, state), __ATOMIC_RELEASE);
+        g_mutex_unlock(&media->lock);
+    }
+    g_free(state);
+}
+
+static void cuRTSPTransportBackpressure(
+    CUrtsp_session hSession,
+    GstRTSPMedia *media,
+    GstRTSPStreamTransport *transport,
+    CUrtsp_client_queue_st *queue)
+{
+    const CUDA_RTSP_BACKPRESSURE *backpressure;
+    CUrtsp_backpressure_st *state;
+    CUrtsp_media_st *media_state;
+    bool resync;
+
+    backpressure = &hSession->session_info.backpressure;
+    state = g_object_get_data(G_OBJECT(transport), "cu-rtsp-backpressure");
+    media_state = cuRTSPMediaState(media);
+    if (state == NULL || media_state == NULL)
+    {
+        return;
+    }
+    __atomic_store_n(&state->queued, queue->queued, __ATOMIC_RELAXED);
+
+    resync = false;
+    g_mutex_lock(&media_state->lock);
+    if (!state->throttled && queue->queued > backpressure->maxQueueBytes)
+    {
+        gst_rtsp_stream_transport_set_active(transport, FALSE);
+        __atomic_store_n(&state->throttled, true, __ATOMIC_RELAXED);
+        state->since = queue->now;
+        state->frame = __atomic_load_n(&media_state->payloaded, __ATOMIC_RELAXED);
+        cuRTSPCounterAdd(&state->events, 1);
+        cuRTSPCounterAdd(&hSession->stats.clientsThrottled, 1);
+    }
+    else if (state->throttled && !state->waiting && queue->queued <= backpressure->maxQueueBytes / 2)
+    {
+        // the payloader activates it again at the next key unit
+        state->waiting = true;
+        __atomic_store_n(&media_state->resuming, g_list_prepend(media_state->resuming, state), __ATOMIC_RELEASE);
+        resync = (backpressure->policy == CU_RTSP_BACKPRESSURE_KEYFRAME);
+    }
+
+    if (state->throttled && !state->waiting && backpressure->policy == CU_RTSP_BACKPRESSURE_DISCONNECT &&
+        queue->now - state->since >= (gint64)backpressure->disconnectSeconds * G_TIME_SPAN_SECOND)
+    {
+        queue->disconnect = true;
+        __atomic_store_n(&state->throttled, false, __ATOMIC_RELAXED);
+        cuRTSPCounterAdd(&hSession->stats.clientsDisconnected, 1);
+    }
+    g_mutex_unlock(&media_state->lock);
+
+    if (resync)
+    {
+        cuRTSPMediaForceKeyUnit(media);
+        cuRTSPCounterAdd(&hSession->stats.clientsResynced, 1);
+    }
+}
+
+static GstBuffer *cuRTSPProbeBuffer(GstPadProbeInfo *info)
+{
+    GstBuffer *buffer;
+
+    buffer = NULL;
+
+    if (GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_BUFFER_LIST)
+    {
+        if (gst_buffer_list_length(GST_PAD_PROBE_INFO_BUFFER_LIST(info)) > 0)
+        {
+            buffer = gst_buffer_list_get(GST_PAD_PROBE_INFO_BUFFER_LIST(info), 0);
+        }
+    }
+    else
+    {
+        buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    }
+
+    return buffer;
+}
+
+static void cuRTSPCounterAdd(uint64_t *counter, uint64_t value)
+{
+    __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+static void cuRTSPHistogramAdd(CUDA_RTSP_HISTOGRAM *histogram, uint64_t value)
+{
+    uint64_t max;
+    guint bucket;
+
+    bucket = MIN(g_bit_storage(value), CU_RTSP_HISTOGRAM_BUCKETS - 1);
+    __atomic_fetch_add(&histogram->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histogram->sum, value, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histogram->buckets[bucket], 1, __ATOMIC_RELAXED);
+    max = __atomic_load_n(&histogram->max, __ATOMIC_RELAXED);
+    while (value > max && !__atomic_compare_exchange_n(&histogram->max, &max, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+}
+
+static void cuRTSPHistogramCopy(CUDA_RTSP_HISTOGRAM *dst, const CUDA_RTSP_HISTOGRAM *src)
+{
+    size_t index;
+
+    dst->count = __atomic_load_n(&src->count, __ATOMIC_RELAXED);
+    dst->sum = __atomic_load_n(&src->sum, __ATOMIC_RELAXED);
+    dst->max = __atomic_load_n(&src->max, __ATOMIC_RELAXED);
+    for (index = 0; index < CU_RTSP_HISTOGRAM_BUCKETS; index++)
+    {
+        dst->buckets[index] = __atomic_load_n(&src->buckets[index], __ATOMIC_RELAXED);
+    }
+}
+
+static void cuRTSPClientStatsFill(
+    CUDA_RTSP_CLIENT_STATS *pStats,
+    const char *address,
+    GstRTSPMedia *media,
+    GstRTSPStreamTransport *transport)
+{
+    const GstRTSPTransport *rtsp_transport;
+    const CUrtsp_backpressure_st *backpressure;
+    CUrtsp_media_st *media_state;
+    GstRTSPStream *stream;
+    GObject *rtp_session;
+    GstStructure *stats;
+    const GstStructure *source;
+    const GValue *value;
+    GValueArray *sources;
+    const gchar *from;
+    gboolean internal;
+    gboolean have_rb;
+    uint64_t seen_bytes;
+    uint64_t seen_packets;
+    guint fraction_lost;
+    gint packets_lost;
+    guint jitter;
+    guint round_trip;
+    gint clock_rate;
+    guint index;
+
+    if (address != NULL)
+    {
+        g_strlcpy(&pStats->address[0], address, sizeof(pStats->address));
+    }
+    rtsp_transport = gst_rtsp_stream_transport_get_transport(transport);
+    pStats->interleaved = (rtsp_transport->lower_transport == GST_RTSP_LOWER_TRANS_TCP);
+    backpressure = g_object_get_data(G_OBJECT(transport), "cu-rtsp-backpressure");
+    if (backpressure != NULL)
+    {
+        pStats->sendQueueBytes = __atomic_load_n(&backpressure->queued, __ATOMIC_RELAXED);
+        pStats->throttled = __atomic_load_n(&backpressure->throttled, __ATOMIC_RELAXED);
+        pStats->throttleEvents = __atomic_load_n(&backpressure->events, __ATOMIC_RELAXED);
+        pStats->framesSkipped = __atomic_load_n(&backpressure->frames_skipped, __ATOMIC_RELAXED);
+    }
+
+    media_state = cuRTSPMediaState(media);
+    if (pStats->interleaved && backpressure != NULL && media_state != NULL)
+    {
+        // totals before marks, so a measurement in between is not counted twice
+        pStats->bytesSent = __atomic_load_n(&backpressure->bytes_sent, __ATOMIC_ACQUIRE);
+        pStats->packetsSent = __atomic_load_n(&backpressure->packets_sent, __ATOMIC_ACQUIRE);
+        seen_bytes = __atomic_load_n(&backpressure->seen_bytes, __ATOMIC_ACQUIRE);
+        seen_packets = __atomic_load_n(&backpressure->seen_packets, __ATOMIC_ACQUIRE);
+        if (!pStats->throttled)
+        {
+            pStats->bytesSent += __atomic_load_n(&media_state->interleaved_bytes, __ATOMIC_RELAXED) - seen_bytes;
+            pStats->packetsSent += __atomic_load_n(&media_state->interleaved_packets, __ATOMIC_RELAXED) - seen_packets;
+        }
+    }
+    else if (!pStats->interleaved)
+    {
+        cuRTSPClientStatsUdp(pStats, media, rtsp_transport);
+    }
+
+    stream = gst_rtsp_stream_transport_get_stream(transport);
+    rtp_session = gst_rtsp_stream_get_rtpsession(stream);
+    if (rtp_session == NULL)
+    {
+        return;
+    }
+
+    g_object_get(rtp_session, "stats", &stats, NULL);
+    value = gst_structure_get_value(stats, "source-stats");
+    sources = (value != NULL) ? g_value_get_boxed(value) : NULL;
+    for (index = 0; sources != NULL && index < sources->n_values; index++)
+    {
+        source = g_value_get_boxed(&sources->values[index]);
+        internal = FALSE;
+        gst_structure_get_boolean(source, "internal", &internal);
+        if (internal)
+        {
+            continue;
+        }
+
+        from = gst_structure_get_string(source, "rtcp-from");
+        if (!pStats->interleaved && (address == NULL || from == NULL || !g_str_has_prefix(from, address)))
+        {
+            continue;
+        }
+        have_rb = FALSE;
+        gst_structure_get_boolean(source, "have-rb", &have_rb);
+        if (have_rb &&
+            gst_structure_get_uint(source, "rb-fractionlost", &fraction_lost) &&
+            gst_structure_get_int(source, "rb-packetslost", &packets_lost) &&
+            gst_structure_get_uint(source, "rb-jitter", &jitter) &&
+            gst_structure_get_uint(source, "rb-round-trip", &round_trip))
+        {
+            if (!gst_structure_get_int(source, "clock-rate", &clock_rate) || clock_rate <= 0)
+            {
+                clock_rate = 90000;
+            }
+            pStats->fractionLost = (double)fraction_lost / 256.0;
+            pStats->packetsLost = packets_lost;
+            pStats->jitter = gst_util_uint64_scale_int(jitter, G_USEC_PER_SEC, clock_rate);
+            // 16.16 fixed point seconds
+            pStats->roundTrip = gst_util_uint64_scale_int(round_trip, G_USEC_PER_SEC, 65536);
+        }
+    }
+    gst_structure_free(stats);
+    g_object_unref(rtp_session);
+}
+
+static void cuRTSPClientStatsUdp(
+    CUDA_RTSP_CLIENT_STATS *pStats,
+    GstRTSPMedia *media,
+    const GstRTSPTransport *rtsp_transport)
+{
+    GstElement *bin;
+    GstObject *pipeline;
+    GstIterator *iterator;
+    GValue item = G_VALUE_INIT;
+    GstElement *element;
+    GstElementFactory *factory;
+    GstStructure *sink_stats;
+    gchar *clients;
+    gchar **destinations;
+    gchar *destination;
+    gint port;
+    guint64 bytes;
+    guint64 packets;
+    bool found;
+    guint index;
+
+    if (rtsp_transport->destination == NULL)
+    {
+        return;
+    }
+    port = (rtsp_transport->lower_transport == GST_RTSP_LOWER_TRANS_UDP_MCAST) ? rtsp_transport->port.min : rtsp_transport->client_port.min;
+    destination = g_strdup_printf("%s:%d", rtsp_transport->destination, port);
+
+    bin = gst_rtsp_media_get_element(media);
+    pipeline = gst_object_get_parent(GST_OBJECT(bin));
+    iterator = (pipeline != NULL) ? gst_bin_iterate_sinks(GST_BIN(pipeline)) : NULL;
+    found = false;
+    while (!found && iterator != NULL && gst_iterator_next(iterator, &item) == GST_ITERATOR_OK)
+    {
+        element = g_value_get_object(&item);
+        factory = gst_element_get_factory(element);
+        if (factory == NULL || strcmp(gst_plugin_feature_get_name(GST_PLUGIN_FEATURE(factory)), "multiudpsink") != 0)
+        {
+            g_value_reset(&item);
+            continue;
+        }
+
+        // the RTCP sink knows the client by another port
+        clients = NULL;
+        g_object_get(element, "clients", &clients, NULL);
+        destinations = g_strsplit((clients != NULL) ? clients : "", ",", -1);
+        for (index = 0; destinations[index] != NULL && !found; index++)
+        {
+            found = (strcmp(destinations[index], destination) == 0);
+        }
+        g_strfreev(destinations);
+        g_free(clients);
+        if (found)
+        {
+            sink_stats = NULL;
+            g_signal_emit_by_name(element, "get-stats", rtsp_transport->destination, port, &sink_stats);
+            if (sink_stats != NULL)
+            {
+                if (gst_structure_get_uint64(sink_stats, "bytes-sent", &bytes) && gst_structure_get_uint64(sink_stats, "packets-sent", &packets))
+                {
+                    pStats->bytesSent = bytes;
+                    pStats->packetsSent = packets;
+                }
+                gst_structure_free(sink_stats);
+            }
+        }
+        g_value_reset(&item);
+    }
+    g_value_unset(&item);
+    if (iterator != NULL)
+    {
+        gst_iterator_free(iterator);
+    }
+    if (pipeline != NULL)
+    {
+        gst_object_unref(pipeline);
+    }
+    gst_object_unref(bin);
+    g_free(destination);
+}
+
+static GstBuffer *cuRTSPSessionWriteBuffer(
+    CUrtsp_session hSession,
+    CUrtspWriteCallback writeCallback,
+    CUrtspUpdateCallback updateCallback,
+    CUrtspStreamCallback streamCallback,
+    void *userData,
+    CUrtsp_frame_status *pStatus)
+{
+    GstBuffer *buffer;
+    GstMapInfo map_info;
+    CUcontext context;
+    GstClockTime capture;
+    GstBufferPool *pool;
+    GstFlowReturn flow;
+    CUrtsp_frame_status status;
+    CUrtsp_rect dirty;
+    gint64 start;
+    gint64 end;
+
+    buffer = NULL;
+    status = CU_RTSP_FRAME_NEW;
+    capture = g_get_monotonic_time() * GST_USECOND;
+    if (cuCtxPushCurrent(hSession->session_info.context) != CUDA_SUCCESS)
+    {
+        goto done;
+    }
+    g_mutex_lock(&hSession->lock);
+    pool = gst_object_ref(hSession->cu_buffer_pool);
+    g_mutex_unlock(&hSession->lock);
+    start = g_get_monotonic_time();
+    flow = gst_buffer_pool_acquire_buffer(pool, &buffer, NULL);
+    gst_object_unref(pool);
+    end = g_get_monotonic_time();
+    cuRTSPHistogramAdd(&hSession->stats.acquireLatency, end - start);
+    if (cuRTSPTraceEnabled())
+    {
+        cuRTSPTraceSpan("acquire", hSession->trace_id, start, end);
+    }
+    if (flow == GST_FLOW_OK)
+    {
+        gst_buffer_add_reference_timestamp_meta(buffer, CAPTURE_CAPS, capture, GST_CLOCK_TIME_NONE);
+        if (gst_buffer_map(buffer, &map_info, CU_RTSP_MAP_WRITE))
+        {
+            start = g_get_monotonic_time();
+            if (updateCallback != NULL)
+            {
+                memset(&dirty, 0, sizeof(dirty));
+                status = updateCallback(
+                    (CUdeviceptr)map_info.data,
+                    map_info.size,
+                    &dirty,
+                    userData);
+            }
+            else if (streamCallback != NULL)
+            {
+                streamCallback(
+                    (CUdeviceptr)map_info.data,
+                    map_info.size,
+                    hSession->cu_stream,
+                    userData);
+                cuRTSPBufferFence(hSession, buffer);
+            }
+            else
+            {
+                writeCallback(
+                    (CUdeviceptr)map_info.data,
+                    map_info.size,
+                    userData);
+            }
+            end = g_get_monotonic_time();
+            cuRTSPHistogramAdd(&hSession->stats.callbackLatency, end - start);
+            if (cuRTSPTraceEnabled())
+            {
+                cuRTSPTraceSpan((updateCallback != NULL) ? "updateCallback" : (streamCallback != NULL) ? "streamCallback" : "writeCallback", hSession->trace_id, start, end);
+            }
+            gst_buffer_unmap(buffer, &map_info);
+#ifdef CU_RTSP_HOST
+            if (status == CU_RTSP_FRAME_NEW)
+            {
+                buffer = cuRTSPSessionConvertBuffer(hSession, buffer);
+            }
+#endif
+            if (status == CU_RTSP_FRAME_NEW && buffer != NULL)
+            {
+                cuRTSPCounterAdd(&hSession->stats.framesProduced, 1);
+            }
+            if (status == CU_RTSP_FRAME_NEW && buffer != NULL && dirty.width > 0 && dirty.height > 0 && updateCallback != NULL)
+            {
+                gst_buffer_add_video_region_of_interest_meta(buffer, "dirty", dirty.x, dirty.y, dirty.width, dirty.height);
+            }
+        }
+        else
+        {
+            gst_buffer_replace(&buffer, NULL);
+        }
+    }
+    cuCtxPopCurrent(&context);
+done:
+    if (pStatus != NULL)
+    {
+        *pStatus = status;
+    }
+    return buffer;
+}
+
+static void cuRTSPSessionEnqueue(
+    CUrtsp_session hSession,
+    GstBuffer *buffer)
+{
+    const bool encoded = hSession->session_info.input == CU_RTSP_INPUT_ENCODED;
+    GstBuffer *dropped;
+
+    g_mutex_lock(&hSession->lock);
+    if (encoded && GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT) && hSession->resync)
+    {
+        gst_buffer_replace(&buffer, NULL);
+        cuRTSPCounterAdd(&hSession->stats.framesDropped, 1);
+    }
+    else if (encoded && !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT))
+    {
+        hSession->resync = false;
+    }
+    while (buffer != NULL && g_queue_get_length(&hSession->frames) >= hSession->session_info.queueDepth)
+    {
+        if (hSession->session_info.queuePolicy == CU_RTSP_QUEUE_BLOCK && hSession->media_count > 0 && !hSession->destroyed)
+        {
+            g_cond_wait(&hSession->cond, &hSession->lock);
+        }
+        else if (hSession->session_info.queuePolicy == CU_RTSP_QUEUE_DROP_NEWEST)
+        {
+            gst_buffer_replace(&buffer, NULL);
+            cuRTSPCounterAdd(&hSession->stats.framesDropped, 1);
+            hSession->resync = encoded;
+        }
+        else
+        {
+            dropped = g_queue_pop_head(&hSession->frames);
+            gst_buffer_unref(dropped);
+            cuRTSPCounterAdd(&hSession->stats.framesDropped, 1);
+            while (encoded && (dropped = g_queue_peek_head(&hSession->frames)) != NULL && GST_BUFFER_FLAG_IS_SET(dropped, GST_BUFFER_FLAG_DELTA_UNIT))
+            {
+                gst_buffer_unref(g_queue_pop_head(&hSession->frames));
+                cuRTSPCounterAdd(&hSession->stats.framesDropped, 1);
+            }
+            if (encoded && g_queue_is_empty(&hSession->frames) && GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT))
+            {
+                gst_buffer_replace(&buffer, NULL);
+                cuRTSPCounterAdd(&hSession->stats.framesDropped, 1);
+                hSession->resync = true;
+            }
+        }
+    }
+    if (buffer != NULL)
+    {
+        g_queue_push_tail(&hSession->frames, buffer);
+        g_cond_broadcast(&hSession->cond);
+    }
+    g_mutex_unlock(&hSession->lock);
+}
+
+static void cuRTSPFrameRelease(
+    gpointer user_data)
+{
+    CUrtsp_release_st *const release = (CUrtsp_release_st *)user_data;
+
+    if (release->callback != NULL)
+    {
+        release->callback(release->user_data);
+    }
+    g_free(release);
+}
+
+static void cuRTSPBufferFence(
+    CUrtsp_session hSession,
+    GstBuffer *buffer)
+{
+    CUrtsp_fence_st *fence;
+
+    fence = g_new0(CUrtsp_fence_st, 1);
+    fence->context = hSession->session_info.context;
+    fence->ref_count = 1;
+    if (cuEventCreate(&fence->event, CU_EVENT_DISABLE_TIMING) != CUDA_SUCCESS)
+    {
+        // without an event the frame is only safe once the stream drained
+        cuStreamSynchronize(hSession->cu_stream);
+        g_free(fence);
+        return;
+    }
+    if (cuEventRecord(fence->event, hSession->cu_stream) != CUDA_SUCCESS)
+    {
+        cuStreamSynchronize(hSession->cu_stream);
+    }
+    gst_mini_object_set_qdata(GST_MINI_OBJECT(buffer), FENCE_QUARK, fence, cuRTSPFenceRelease);
+}
+
+static void cuRTSPFenceRelease(
+    gpointer user_data)
+{
+    CUrtsp_fence_st *const fence = (CUrtsp_fence_st *)user_data;
+    CUcontext context;
+    bool pushed;
+
+    pushed = cuCtxPushCurrent(fence->context) == CUDA_SUCCESS;
+    if (pushed)
+    {
+        cuEventSynchronize(fence->event);
+    }
+    if (g_atomic_int_dec_and_test(&fence->ref_count))
+    {
+        if (pushed)
+        {
+            cuEventDestroy(fence->event);
+        }
+        g_free(fence);
+    }
+    if (pushed)
+    {
+        cuCtxPopCurrent(&context);
+    }
+}
+
+static GstBuffer *cuRTSPBufferMakeWritable(
+    GstBuffer *buffer)
+{
+    CUrtsp_fence_st *fence;
+
+    if (gst_buffer_is_writable(buffer))
+    {
+        return buffer;
+    }
+    fence = cuRTSPBufferFenceRef(buffer);
+    buffer = gst_buffer_make_writable(buffer);
+    if (fence != NULL)
+    {
+        gst_mini_object_set_qdata(GST_MINI_OBJECT(buffer), FENCE_QUARK, fence, cuRTSPFenceRelease);
+    }
+
+    return buffer;
+}
+
+static CUrtsp_fence_st *cuRTSPBufferFenceRef(
+    GstBuffer *buffer)
+{
+    CUrtsp_fence_st *fence;
+
+    fence = gst_mini_object_get_qdata(GST_MINI_OBJECT(buffer), FENCE_QUARK);
+    if (fence != NULL)
+    {
+        g_atomic_int_inc(&fence->ref_count);
+    }
+
+    return fence;
+}
+
+static gint64 cuRTSPSessionIdleInterval(
+    CUrtsp_session hSession,
+    gint64 interval)
+{
+    if (hSession->session_info.idleIntervalMs > 0)
+    {
+        return (gint64)hSession->session_info.idleIntervalMs * G_TIME_SPAN_MILLISECOND;
+    }
+    if (hSession->session_info.encoder.gopLength > 0)
+    {
+        return (gint64)hSession->session_info.encoder.gopLength * interval;
+    }
+
+    return CU_RTSP_DEFAULT_IDLE_INTERVAL;
+}
+
+static GstBuffer *cuRTSPSessionRepeatFrame(
+    CUrtsp_session hSession)
+{
+    GstBuffer *buffer;
+    GstReferenceTimestampMeta *meta;
+
+    buffer = NULL;
+
+    if (hSession->last_frame != NULL)
+    {
+        buffer = cuRTSPBufferMakeWritable(gst_buffer_ref(hSession->last_frame));
+        cuRTSPCounterAdd(&hSession->stats.framesRepeated, 1);
+        // a repeat was not captured now, keep it out of latency reports
+        meta = gst_buffer_get_reference_timestamp_meta(buffer, CAPTURE_CAPS);
+        if (meta != NULL)
+        {
+            gst_buffer_remove_meta(buffer, (GstMeta *)meta);
+        }
+    }
+
+    return buffer;
+}
+
+static GstBuffer *cuRTSPSessionPollFrame(
+    CUrtsp_media_st *media,
+    GstElement *appsrc)
+{
+    CUrtsp_session hSession;
+    GstBuffer *buffer;
+    GstPad *pad;
+    CUrtsp_frame_status status;
+    gint64 interval;
+    gint64 idle;
+    gint64 start;
+    gint64 end_time;
+    bool destroyed;
+
+    hSession = media->session;
+    if (hSession->session_info.updateCallback == NULL)
+    {
+        return cuRTSPSessionWriteBuffer(
+            hSession,
+            hSession->session_info.writeCallback,
+            NULL,
+            hSession->session_info.streamCallback,
+            hSession->session_info.userData,
+            NULL);
+    }
+
+    pad = gst_element_get_static_pad(appsrc, "src");
+    interval = gst_util_uint64_scale_int(
+        hSession->session_info.fpsDen,
+        G_TIME_SPAN_SECOND,
+        hSession->session_info.fpsNum);
+    idle = cuRTSPSessionIdleInterval(hSession, interval);
+    start = g_get_monotonic_time();
+
+    while (true)
+    {
+        buffer = cuRTSPSessionWriteBuffer(
+            hSession,
+            NULL,
+            hSession->session_info.updateCallback,
+            NULL,
+            hSession->session_info.userData,
+            &status);
+        if (buffer == NULL || status == CU_RTSP_FRAME_NEW)
+        {
+            break;
+        }
+        gst_buffer_replace(&buffer, NULL);
+
+        g_mutex_lock(&hSession->lock);
+        if (g_get_monotonic_time() - start >= idle)
+        {
+            buffer = cuRTSPSessionRepeatFrame(hSession);
+        }
+        end_time = g_get_monotonic_time() + interval;
+        while (buffer == NULL && !hSession->destroyed && !GST_PAD_IS_FLUSHING(pad) &&
+               g_cond_wait_until(&hSession->cond, &hSession->lock, end_time))
+        {
+        }
+        destroyed = hSession->destroyed;
+        g_mutex_unlock(&hSession->lock);
+
+        if (buffer != NULL || GST_PAD_IS_FLUSHING(pad) || destroyed)
+        {
+            break;
+        }
+        media->timestamp += interval * GST_USECOND;
+    }
+
+    gst_object_unref(pad);
+    return buffer;
+}
+
+static GstBuffer *cuRTSPSessionPopFrame(
+    CUrtsp_media_st *media,
+    GstElement *appsrc)
+{
+    CUrtsp_session hSession;
+    GstBuffer *buffer;
+    GstPad *pad;
+    gint64 interval;
+    gint64 idle;
+    gint64 start;
+    gint64 end_time;
+
+    hSession = media->session;
+    pad = gst_element_get_static_pad(appsrc, "src");
+    interval = gst_util_uint64_scale_int(
+        hSession->session_info.fpsDen,
+        G_TIME_SPAN_SECOND,
+        hSession->session_info.fpsNum);
+    idle = cuRTSPSessionIdleInterval(hSession, interval);
+
+    g_mutex_lock(&hSession->lock);
+    start = g_get_monotonic_time();
+    end_time = start + interval;
+    while (g_queue_is_empty(&hSession->frames) && !hSession->destroyed)
+    {
+        if (!g_cond_wait_until(&hSession->cond, &hSession->lock, end_time))
+        {
+            if (GST_PAD_IS_FLUSHING(pad) || (hSession->last_frame != NULL && end_time - start >= idle))
+            {
+                break;
+            }
+            // keep timestamps on the wall clock while frame periods are skipped
+            media->timestamp += interval * GST_USECOND;
+            end_time += interval;
+        }
+    }
+    buffer = g_queue_pop_head(&hSession->frames);
+    if (buffer == NULL && !hSession->destroyed)
+    {
+        buffer = cuRTSPSessionRepeatFrame(hSession);
+    }
+    g_cond_broadcast(&hSession->cond);
+    g_mutex_unlock(&hSession->lock);
+
+    gst_object_unref(pad);
+    return buffer;
+}
+
+static GstBuffer *cuRTSPSessionNextFrame(
+    CUrtsp_media_st *media,
+    GstElement *appsrc)
+{
+    CUrtsp_session hSession;
+    GstBuffer *buffer;
+
+    hSession = media->session;
+    if (hSession->session_info.input != CU_RTSP_INPUT_CALLBACK)
+    {
+        return cuRTSPSessionPopFrame(media, appsrc);
+    }
+
+    g_mutex_lock(&hSession->lock);
+    if (hSession->destroyed)
+    {
+        g_mutex_unlock(&hSession->lock);
+        return NULL;
+    }
+    hSession->callbacks_active++;
+    g_mutex_unlock(&hSession->lock);
+    buffer = cuRTSPSessionPollFrame(media, appsrc);
+    g_mutex_lock(&hSession->lock);
+    hSession->callbacks_active--;
+    g_cond_broadcast(&hSession->cond);
+    g_mutex_unlock(&hSession->lock);
+
+    return buffer;
+}
+
+static GstBuffer *cuRTSPSessionShareFrame(
+    CUrtsp_media_st *media,
+    GstElement *appsrc)
+{
+    CUrtsp_session hSession;
+    GstBuffer *buffer;
+    GstClockTime duration;
+    gint64 slot;
+
+    hSession = media->session;
+    duration = gst_util_uint64_scale_int(
+        hSession->session_info.fpsDen,
+        GST_SECOND,
+        hSession->session_info.fpsNum);
+
+    g_mutex_lock(&hSession->lock);
+    while (hSession->producing && !hSession->destroyed)
+    {
+        g_cond_wait(&hSession->cond, &hSession->lock);
+    }
+    // frame period index on the session's timeline
+    slot = (gint64)(media->timestamp / duration);
+    if (!media->slot_aligned)
+    {
+        media->slot_offset = hSession->shared_slot - slot;
+        media->slot_aligned = true;
+    }
+    slot += media->slot_offset;
+    // a media that fell behind catches up
+    if (hSession->shared_frame != NULL && slot <= hSession->shared_slot)
+    {
+        media->slot_offset += hSession->shared_slot - slot;
+        buffer = gst_buffer_ref(hSession->shared_frame);
+        g_mutex_unlock(&hSession->lock);
+        return buffer;
+    }
+    hSession->producing = true;
+    g_mutex_unlock(&hSession->lock);
+
+    buffer = cuRTSPSessionNextFrame(media, appsrc);
+
+    g_mutex_lock(&hSession->lock);
+    hSession->producing = false;
+    if (buffer != NULL)
+    {
+        gst_buffer_replace(&hSession->shared_frame, buffer);
+        // the producer may have skipped periods
+        hSession->shared_slot = (gint64)(media->timestamp / duration) + media->slot_offset;
+    }
+    g_cond_broadcast(&hSession->cond);
+    g_mutex_unlock(&hSession->lock);
+
+    return buffer;
+}
+
+static bool cuRTSPMediaRetry(
+    CUrtsp_media_st *media,
+    GstElement *appsrc)
+{
+    CUrtsp_session hSession;
+    GstPad *pad;
+    gint64 interval;
+    gint64 end_time;
+    bool result;
+
+    hSession = media->session;
+    pad = gst_element_get_static_pad(appsrc, "src");
+    interval = gst_util_uint64_scale_int(
+        hSession->session_info.fpsDen,
+        G_TIME_SPAN_SECOND,
+        hSession->session_info.fpsNum);
+
+    g_mutex_lock(&hSession->lock);
+    end_time = g_get_monotonic_time() + interval;
+    while (!hSession->destroyed && !GST_PAD_IS_FLUSHING(pad) &&
+           g_cond_wait_until(&hSession->cond, &hSession->lock, end_time))
+    {
+    }
+    result = !hSession->destroyed && !GST_PAD_IS_FLUSHING(pad);
+    g_mutex_unlock(&hSession->lock);
+    gst_object_unref(pad);
+
+    if (result)
+    {
+        media->timestamp += interval * GST_USECOND;
+    }
+
+    return result;
+}
+
+static void cuRTSPSessionPushBuffer(
+    GstElement *appsrc,
+    guint unused,
+    CUrtsp_media_st *media)
+{
+    CUrtsp_session hSession;
+    GstBuffer *buffer;
+    GstFlowReturn ret;
+    GstClock *clock;
+    GstClockTime now;
+    GstClockTime base_time;
+    GstReferenceTimestampMeta *meta;
+    assert(media != NULL);
+    hSession = media->session;
+    // appsrc asks again only after a push, so return with a buffer unless flushing or destroyed
+    while (true)
+    {
+        buffer = (hSession->session_info.renditionCount > 0) ? cuRTSPSessionShareFrame(media, appsrc) : cuRTSPSessionNextFrame(media, appsrc);
+        if (buffer == NULL)
+        {
+            if (!cuRTSPMediaRetry(media, appsrc))
+            {
+                return;
+            }
+            continue;
+        }
+        if (hSession->session_info.input == CU_RTSP_INPUT_ENCODED && !media->synced && GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT))
+        {
+            cuRTSPCounterAdd(&hSession->stats.framesDropped, 1);
+            gst_buffer_unref(buffer);
+            continue;
+        }
+        break;
+    }
+    if (hSession->session_info.input == CU_RTSP_INPUT_ENCODED)
+    {
+        media->synced = true;
+        buffer = cuRTSPBufferMakeWritable(buffer);
+        if (media->pts_base == GST_CLOCK_TIME_NONE)
+        {
+            media->pts_base = GST_BUFFER_PTS(buffer);
+        }
+        GST_BUFFER_PTS(buffer) = (GST_BUFFER_PTS(buffer) > media->pts_base) ? GST_BUFFER_PTS(buffer) - media->pts_base : 0;
+    }
+    else
+    {
+        buffer = cuRTSPBufferMakeWritable(buffer);
+        clock = (hSession->session_info.lowLatency) ? gst_element_get_clock(appsrc) : NULL;
+        if (clock != NULL)
+        {
+            now = gst_clock_get_time(clock);
+            base_time = gst_element_get_base_time(appsrc);
+            GST_BUFFER_PTS(buffer) = (now > base_time) ? now - base_time : 0;
+            gst_object_unref(clock);
+        }
+        else
+        {
+            GST_BUFFER_PTS(buffer) = media->timestamp;
+        }
+    }
+    GST_BUFFER_DURATION(buffer) = gst_util_uint64_scale_int(
+        hSession->session_info.fpsDen,
+        GST_SECOND,
+        hSession->session_info.fpsNum);
+    media->timestamp += GST_BUFFER_DURATION(buffer);
+    __atomic_store_n(&media->duration, GST_BUFFER_DURATION(buffer), __ATOMIC_RELAXED);
+    meta = gst_buffer_get_reference_timestamp_meta(buffer, CAPTURE_CAPS);
+    cuRTSPMediaTrackFrame(media, GST_BUFFER_PTS(buffer), (meta != NULL) ? meta->timestamp : GST_CLOCK_TIME_NONE);
+    cuRTSPMediaTraceUpdate(media);
+    if (media->tracing)
+    {
+        cuRTSPMediaTraceFrame(media, GST_BUFFER_PTS(buffer), media->frame_count);
+    }
+    media->frame_count++;
+    cuRTSPCounterAdd(&hSession->stats.framesSent, 1);
+    g_signal_emit_by_name(appsrc, "push-buffer", buffer, &ret);
+    // access units depend on each other, never repeat one
+    if (hSession->session_info.input != CU_RTSP_INPUT_ENCODED)
+    {
+        g_mutex_lock(&hSession->lock);
+        gst_buffer_replace(&hSession->last_frame, buffer);
+        g_mutex_unlock(&hSession->lock);
+    }
+    gst_buffer_unref(buffer);
+}
+
+static GstBuffer *cuRTSPSessionSnapshot(
+    CUrtsp_session hSession,
+    size_t width,
+    size_t height)
+{
+    GstBuffer *frame;
+    GstBuffer *result;
+    GstCaps *caps;
+    GstReferenceTimestampMeta *meta;
+    GstClockTime capture;
+    bool cached;
+
+    result = NULL;
+    frame = cuRTSPSessionNewestFrame(hSession, &caps);
+    meta = (frame != NULL) ? gst_buffer_get_reference_timestamp_meta(frame, CAPTURE_CAPS) : NULL;
+    capture = (meta != NULL) ? meta->timestamp : GST_CLOCK_TIME_NONE;
+    // a repeated frame has no capture time and shows the same picture
+    cached = hSession->snapshot != NULL &&
+             hSession->snapshot_width == width &&
+             hSession->snapshot_height == height &&
+             (frame == NULL ||
+              (gst_caps_is_equal(caps, hSession->snapshot_caps) &&
+               (!GST_CLOCK_TIME_IS_VALID(capture) || capture == hSession->snapshot_capture)));
+    if (cached)
+    {
+        result = gst_buffer_ref(hSession->snapshot);
+    }
+    else if (frame != NULL)
+    {
+        result = cuRTSPSessionSnapshotEncode(hSession, frame, caps, width, height);
+        if (result != NULL)
+        {
+            gst_buffer_replace(&hSession->snapshot, result);
+            gst_caps_replace(&hSession->snapshot_caps, caps);
+            hSession->snapshot_capture = capture;
+            hSession->snapshot_width = width;
+            hSession->snapshot_height = height;
+        }
+    }
+    else
+    {
+        cuRTSPSetError("cuRTSPSessionGetSnapshot: no frame available");
+    }
+    if (frame != NULL)
+    {
+        gst_buffer_unref(frame);
+    }
+    gst_caps_unref(caps);
+
+    return result;
+}
+
+static GstBuffer *cuRTSPSessionNewestFrame(
+    CUrtsp_session hSession,
+    GstCaps **pCaps)
+{
+    GstBuffer *buffer;
+    CUrtsp_fence_st *fence;
+    CUrtsp_frame_status status;
+
+    g_mutex_lock(&hSession->lock);
+    while (hSession->producing && !hSession->destroyed)
+    {
+        g_cond_wait(&hSession->cond, &hSession->lock);
+    }
+    if (hSession->session_info.input == CU_RTSP_INPUT_CALLBACK && hSession->media_count == 0 && !hSession->destroyed)
+    {
+        hSession->producing = true;
+        hSession->callbacks_active++;
+        g_mutex_unlock(&hSession->lock);
+        buffer = cuRTSPSessionWriteBuffer(
+            hSession,
+            hSession->session_info.writeCallback,
+            hSession->session_info.updateCallback,
+            hSession->session_info.streamCallback,
+            hSession->session_info.userData,
+            &status);
+        if (status == CU_RTSP_FRAME_UNCHANGED)
+        {
+            gst_buffer_replace(&buffer, NULL);
+        }
+        if (buffer != NULL)
+        {
+            fence = gst_mini_object_steal_qdata(GST_MINI_OBJECT(buffer), FENCE_QUARK);
+            if (fence != NULL)
+            {
+                cuRTSPFenceRelease(fence);
+            }
+        }
+        g_mutex_lock(&hSession->lock);
+        if (buffer != NULL)
+        {
+            gst_buffer_replace(&hSession->last_frame, buffer);
+            gst_buffer_unref(buffer);
+        }
+        hSession->producing = false;
+        hSession->callbacks_active--;
+        g_cond_broadcast(&hSession->cond);
+    }
+    buffer = g_queue_peek_tail(&hSession->frames);
+    if (buffer == NULL)
+    {
+        buffer = hSession->last_frame;
+    }
+    fence = NULL;
+    if (buffer != NULL)
+    {
+        gst_buffer_ref(buffer);
+        fence = cuRTSPBufferFenceRef(buffer);
+    }
+    if (pCaps != NULL)
+    {
+        *pCaps = gst_caps_ref(hSession->caps);
+    }
+    g_mutex_unlock(&hSession->lock);
+    // a queued frame may still be written by the producer's stream
+    if (fence != NULL)
+    {
+        cuRTSPFenceRelease(fence);
+    }
+
+    return buffer;
+}
+
+static GstBuffer *cuRTSPSessionSnapshotEncode(
+    CUrtsp_session hSession,
+    GstBuffer *frame,
+    GstCaps *caps,
+    size_t width,
+    size_t height)
+{
+    GstBuffer *result;
+    GstBuffer *host;
+    GstCaps *host_caps;
+    GstCaps *jpeg_caps;
+    GstSample *sample;
+    GstSample *jpeg;
+    GError *error;
+    CUcontext context;
+#ifndef CU_RTSP_HOST
+    GstMapInfo src_map;
+    GstMapInfo dst_map;
+    bool copied;
+#endif
+
+    result = NULL;
+    error = NULL;
+    if (cuCtxPushCurrent(hSession->session_info.context) != CUDA_SUCCESS)
+    {
+        cuRTSPSetError("cuRTSPSessionGetSnapshot: failed to make context current");
+        return NULL;
+    }
+    if (hSession->session_info.streamCallback != NULL)
+    {
+        cuStreamSynchronize(hSession->cu_stream);
+    }
+#ifdef CU_RTSP_HOST
+    host = gst_buffer_ref(frame);
+#else
+    host = NULL;
+    if (gst_buffer_map(frame, &src_map, CU_RTSP_MAP_READ))
+    {
+        host = gst_buffer_new_allocate(NULL, src_map.size, NULL);
+        gst_buffer_copy_into(host, frame, GST_BUFFER_COPY_METADATA, 0, -1);
+        copied = false;
+        if (gst_buffer_map(host, &dst_map, GST_MAP_WRITE))
+        {
+            copied = cuMemcpyDtoH(dst_map.data, (CUdeviceptr)src_map.data, src_map.size) == CUDA_SUCCESS;
+            gst_buffer_unmap(host, &dst_map);
+        }
+        gst_buffer_unmap(frame, &src_map);
+        if (!copied)
+        {
+            gst_buffer_replace(&host, NULL);
+        }
+    }
+#endif
+    cuCtxPopCurrent(&context);
+    if (host == NULL)
+    {
+        cuRTSPSetError("cuRTSPSessionGetSnapshot: failed to read frame");
+        return NULL;
+    }
+
+    host_caps = gst_caps_copy(caps);
+    gst_caps_set_features(host_caps, 0, NULL);
+    sample = gst_sample_new(host, host_caps, NULL, NULL);
+    jpeg_caps = gst_caps_new_empty_simple("image/jpeg");
+    if (width > 0)
+    {
+        gst_caps_set_simple(jpeg_caps, "width", G_TYPE_INT, (gint)width, NULL);
+    }
+    if (height > 0)
+    {
+        gst_caps_set_simple(jpeg_caps, "height", G_TYPE_INT, (gint)height, NULL);
+    }
+    jpeg = gst_video_convert_sample(sample, jpeg_caps, CU_RTSP_SNAPSHOT_TIMEOUT, &error);
+    if (jpeg != NULL)
+    {
+        result = gst_buffer_ref(gst_sample_get_buffer(jpeg));
+        gst_sample_unref(jpeg);
+    }
+    else
+    {
+        cuRTSPSetError("cuRTSPSessionGetSnapshot: %s", (error != NULL) ? error->message : "conversion failed");
+        g_clear_error(&error);
+    }
+    gst_caps_unref(jpeg_caps);
+    gst_sample_unref(sample);
+    gst_caps_unref(host_caps);
+    gst_buffer_unref(host);
+
+    return result;
+}
+
+static GstCaps *cuRTSPSessionCaps(const CUDA_RTSP_SESSION *pSessionInfo)
+{
+    const char *caps_format = "video/x-raw" CU_RTSP_CAPS_FEATURE ",format=%s,width=%d,height=%d,framerate=%d/%d";
+    char caps_string[256];
+
+    if (pSessionInfo->input == CU_RTSP_INPUT_ENCODED)
+    {
+        snprintf(
+            &caps_string[0],
+            sizeof(caps_string) / sizeof(caps_string[0]),
+            "%s,framerate=%d/%d",
+            ENCODED_CAPS[pSessionInfo->encoder.codec],
+            (int)pSessionInfo->fpsNum,
+            (int)pSessionInfo->fpsDen);
+        return gst_caps_from_string(&caps_string[0]);
+    }
+
+    snprintf(
+        &caps_string[0],
+        sizeof(caps_string) / sizeof(caps_string[0]),
+        caps_format,
+        FORMATS[pSessionInfo->format],
+        (int)pSessionInfo->width,
+        (int)pSessionInfo->height,
+        (int)pSessionInfo->fpsNum,
+        (int)pSessionInfo->fpsDen);
+
+    return gst_caps_from_string(&caps_string[0]);
+}
+
+static GstRTSPAddressPool *cuRTSPAddressPool(const CUDA_RTSP_MULTICAST *pMulticast)
+{
+    GstRTSPAddressPool *result;
+    guint16 port_min;
+    guint16 port_max;
+
+    result = gst_rtsp_address_pool_new();
+    port_min = (pMulticast->portMin > 0) ? pMulticast->portMin : CU_RTSP_DEFAULT_MCAST_PORT_MIN;
+    port_max = (pMulticast->portMax > 0) ? pMulticast->portMax : CU_RTSP_DEFAULT_MCAST_PORT_MAX;
+    if (port_min > port_max || !gst_rtsp_address_pool_add_range(
+                                   result,
+                                   pMulticast->addressMin,
+                                   (pMulticast->addressMax != NULL) ? pMulticast->addressMax : pMulticast->addressMin,
+                                   port_min,
+                                   port_max,
+                                   (pMulticast->ttl > 0) ? pMulticast->ttl : CU_RTSP_DEFAULT_MCAST_TTL))
+    {
+        g_object_unref(result);
+        result = NULL;
+    }
+
+    return result;
+}
+
+static GstBufferPool *cuRTSPSessionPool(CUrtsp_session hSession, GstCaps *caps, gsize size)
+{
+    CUrtsp_pool_st *entry;
+    GstStructure *config;
+    GstVideoInfo video_info;
+    gpointer stream;
+    gchar *key;
+
+    stream = NULL;
+#ifndef CU_RTSP_HOST
+    stream = hSession->gst_cuda_stream;
+#endif
+    gst_video_info_from_caps(&video_info, caps);
+    key = g_strdup_printf(
+        "%s:%dx%d:%" G_GSIZE_FORMAT ":%" G_GSIZE_FORMAT ":%p",
+        GST_VIDEO_INFO_NAME(&video_info),
+        GST_VIDEO_INFO_WIDTH(&video_info),
+        GST_VIDEO_INFO_HEIGHT(&video_info),
+        hSession->session_info.poolMin,
+        hSession->session_info.poolMax,
+        stream);
+
+    g_mutex_lock(&DEVICES_LOCK);
+    entry = g_hash_table_lookup(hSession->device->pools, key);
+    if (entry == NULL)
+    {
+        entry = g_new0(CUrtsp_pool_st, 1);
+#ifdef CU_RTSP_HOST
+        entry->pool = gst_video_buffer_pool_new();
+#else
+        entry->pool = gst_cuda_buffer_pool_new(hSession->device->gst_cuda_context);
+#endif
+        config = gst_buffer_pool_get_config(entry->pool);
+        gst_buffer_pool_config_set_params(config, caps, size, hSession->session_info.poolMin, hSession->session_info.poolMax);
+#ifndef CU_RTSP_HOST
+        if (hSession->gst_cuda_stream != NULL)
+        {
+            gst_buffer_pool_config_set_cuda_stream(config, hSession->gst_cuda_stream);
+        }
+#endif
+        gst_buffer_pool_set_config(entry->pool, config);
+        gst_buffer_pool_set_active(entry->pool, TRUE);
+        g_hash_table_insert(hSession->device->pools, key, entry);
+    }
+    else
+    {
+        g_free(key);
+    }
+    entry->users++;
+    g_mutex_unlock(&DEVICES_LOCK);
+
+    return gst_object_ref(entry->pool);
+}
+
+static void cuRTSPSessionPoolRelease(CUrtsp_session hSession, GstBufferPool *pool)
+{
+    GHashTableIter iter;
+    CUrtsp_pool_st *entry;
+
+    g_mutex_lock(&DEVICES_LOCK);
+    g_hash_table_iter_init(&iter, hSession->device->pools);
+    while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&entry))
+    {
+        if (entry->pool == pool)
+        {
+            entry->users--;
+            if (entry->users == 0)
+            {
+                g_hash_table_iter_remove(&iter);
+            }
+            break;
+        }
+    }
+    g_mutex_unlock(&DEVICES_LOCK);
+    gst_object_unref(pool);
+}
+
+static CUrtsp_device_st *cuRTSPDeviceAcquire(CUdevice device, CUcontext context)
+{
+    CUrtsp_device_st *result;
+#ifndef CU_RTSP_HOST
+    GstStructure *s;
+    gint device_id;
+#endif
+
+    g_mutex_lock(&DEVICES_LOCK);
+    result = g_hash_table_lookup(DEVICES, context);
+    if (result == NULL)
+    {
+        result = g_new0(CUrtsp_device_st, 1);
+        result->context = context;
+#ifndef CU_RTSP_HOST
+        result->gst_cuda_context = gst_cuda_context_new_wrapped(context, device);
+        result->gst_context = gst_context_new(GST_CUDA_CONTEXT_TYPE, TRUE);
+        g_object_get(G_OBJECT(result->gst_cuda_context), "cuda-device-id", &device_id, NULL);
+        s = gst_context_writable_structure(result->gst_context);
+        gst_structure_set(s, GST_CUDA_CONTEXT_TYPE, GST_TYPE_CUDA_CONTEXT,
+                          result->gst_cuda_context, "cuda-device-id", G_TYPE_INT, device_id, NULL);
+#endif
+        result->pools = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)cuRTSPPoolFree);
+        g_hash_table_insert(DEVICES, context, result);
+    }
+    result->ref_count++;
+    g_mutex_unlock(&DEVICES_LOCK);
+
+    return result;
+}
+
+static void cuRTSPDeviceRelease(CUrtsp_device_st *device)
+{
+    g_mutex_lock(&DEVICES_LOCK);
+    device->ref_count--;
+    if (device->ref_count == 0)
+    {
+        g_hash_table_remove(DEVICES, device->context);
+        g_hash_table_destroy(device->pools);
+#ifndef CU_RTSP_HOST
+        gst_context_unref(device->gst_context);
+        gst_object_unref(device->gst_cuda_context);
+#endif
+        g_free(device);
+    }
+    g_mutex_unlock(&DEVICES_LOCK);
+}
+
+static void cuRTSPPoolFree(CUrtsp_pool_st *pool)
+{
+    gst_buffer_pool_set_active(pool->pool, FALSE);
+    gst_object_unref(pool->pool);
+    g_free(pool);
+}
+
+static void cuRTSPSessionRef(CUrtsp_session hSession)
+{
+    g_atomic_int_inc(&hSession->ref_count);
+}
+
+static void cuRTSPSessionUnref(CUrtsp_session hSession)
+{
+    if (g_atomic_int_dec_and_test(&hSession->ref_count))
+    {
+        cuRTSPSessionFree(hSession);
+    }
+}
+
+static void cuRTSPSessionFree(CUrtsp_session hSession)
+{
+    size_t index;
+
+    g_queue_clear_full(&hSession->frames, (GDestroyNotify)gst_buffer_unref);
+    gst_buffer_replace(&hSession->last_frame, NULL);
+    if (hSession->cu_buffer_pool != NULL)
+    {
+        cuRTSPSessionPoolRelease(hSession, hSession->cu_buffer_pool);
+    }
+#ifdef CU_RTSP_HOST
+    if (hSession->convert_pool != NULL)
+    {
+        cuRTSPSessionPoolRelease(hSession, hSession->convert_pool);
+    }
+#endif
+    gst_caps_unref(hSession->caps);
+#ifdef CU_RTSP_HOST
+    if (hSession->cu_stream != NULL)
+    {
+        cuStreamDestroy(hSession->cu_stream);
+    }
+#else
+    if (hSession->gst_cuda_stream != NULL)
+    {
+        gst_cuda_stream_unref(hSession->gst_cuda_stream);
+    }
+#endif
+    if (hSession->device != NULL)
+    {
+        cuRTSPDeviceRelease(hSession->device);
+    }
+    g_object_unref(hSession->gst_rtsp_media_factory);
+    for (index = 0; index < hSession->session_info.renditionCount; index++)
+    {
+        g_object_unref(hSession->rendition_factories[index]);
+        g_free((gchar *)hSession->renditions[index].name);
+    }
+    g_free(hSession->rendition_factories);
+    g_free(hSession->renditions);
+    gst_buffer_replace(&hSession->shared_frame, NULL);
+    if (hSession->mosaic != NULL)
+    {
+        cuRTSPMosaicFree(hSession->mosaic);
+    }
+    g_free((gchar *)hSession->session_info.recording.location);
+    g_free((gchar *)hSession->session_info.encoder.preset);
+    g_free((gchar *)hSession->session_info.encoder.tune);
+    g_free((gchar *)hSession->session_info.encoder.options);
+    gst_buffer_replace(&hSession->snapshot, NULL);
+    gst_caps_replace(&hSession->snapshot_caps, NULL);
+    g_mutex_clear(&hSession->snapshot_lock);
+    g_mutex_clear(&hSession->lock);
+    g_cond_clear(&hSession->cond);
+    free(hSession);
+}
+
+static void cuRTSPMountRemove(CUrtsp_mount_st *mount)
+{
+    GstRTSPMountPoints *mount_points;
+    size_t index;
+
+    mount_points = gst_rtsp_server_get_mount_points(mount->server);
+    gst_rtsp_mount_points_remove_factory(mount_points, mount->path);
+    for (index = 0; mount->rendition_paths[index] != NULL; index++)
+    {
+        gst_rtsp_mount_points_remove_factory(mount_points, mount->rendition_paths[index]);
+    }
+    g_object_unref(mount_points);
+    g_object_unref(mount->server);
+    g_strfreev(mount->rendition_paths);
+    g_free(mount->path);
+    g_free(mount);
+}
+
+const CUrtsp_encoder_desc *cuRTSPEncoderFind(CUrtsp_codec codec, CUrtsp_encoder type)
+{
+    GstElementFactory *factory;
+    const CUrtsp_encoder_desc *result;
+    size_t index;
+
+    result = NULL;
+
+    for (index = 0; index < sizeof(ENCODERS) / sizeof(ENCODERS[0]) && result == NULL; index++)
+    {
+        if (ENCODERS[index].codec != codec)
+        {
+            continue;
+        }
+#ifdef CU_RTSP_HOST
+        // NVENC needs CUDA memory
+        if (ENCODERS[index].type == CU_RTSP_ENCODER_NVENC)
+        {
+            continue;
+        }
+#endif
+        if (type != CU_RTSP_ENCODER_AUTO && ENCODERS[index].type != type)
+        {
+            continue;
+        }
+        factory = gst_element_factory_find(ENCODERS[index].element);
+        if (factory != NULL)
+        {
+            result = &ENCODERS[index];
+            gst_object_unref(factory);
+        }
+    }
+
+    return result;
+}
+
+bool cuRTSPEncoderCheck(const CUrtsp_encoder_desc *encoder, const CUDA_RTSP_ENCODER *pEncoder, bool lowLatency)
+{
+    GstElement *element;
+    bool valid;
+
+    element = gst_element_factory_make(encoder->element, NULL);
+    if (element == NULL)
+    {
+        cuRTSPSetError("cuRTSPSessionCreate: failed to create %s", encoder->element);
+        return false;
+    }
+
+    valid = true;
+    if (pEncoder->rateControl > CU_RTSP_RATE_CONTROL_DEFAULT)
+    {
+        valid = cuRTSPEncoderCheckProperty(element, encoder, "rate control", encoder->rate_control,
+                                           (pEncoder->rateControl <= CU_RTSP_RATE_CONTROL_CQP) ? encoder->rate_control_values[pEncoder->rateControl] : NULL, true);
+    }
+    if (valid && lowLatency)
+    {
+        valid = cuRTSPEncoderCheckProperty(element, encoder, "preset", encoder->preset, encoder->low_latency_preset, false) &&
+                cuRTSPEncoderCheckProperty(element, encoder, "tune", encoder->tune, encoder->low_latency_tune, false);
+    }
+    if (valid && pEncoder->preset != NULL)
+    {
+        valid = cuRTSPEncoderCheckProperty(element, encoder, "preset", encoder->preset, pEncoder->preset, true);
+    }
+    if (valid && pEncoder->tune != NULL)
+    {
+        valid = cuRTSPEncoderCheckProperty(element, encoder, "tune", encoder->tune, pEncoder->tune, true);
+    }
+    gst_object_unref(element);
+
+    return valid;
+}
+
+bool cuRTSPEncoderCheckProperty(GstElement *element, const CUrtsp_encoder_desc *encoder, const char *what, const char *name, const char *value, bool required)
+{
+    GParamSpec *spec;
+    GValue parsed = G_VALUE_INIT;
+    bool valid;
+
+    spec = (name != NULL) ? g_object_class_find_property(G_OBJECT_GET_CLASS(element), name) : NULL;
+    if (spec == NULL || value == NULL)
+    {
+        if (required)
+        {
+            cuRTSPSetError("cuRTSPSessionCreate: %s does not support the requested %s", encoder->element, what);
+        }
+        return !required;
+    }
+
+    g_value_init(&parsed, G_PARAM_SPEC_VALUE_TYPE(spec));
+    valid = gst_value_deserialize(&parsed, value);
+    g_value_unset(&parsed);
+    if (!valid)
+    {
+        cuRTSPSetError("cuRTSPSessionCreate: %s has no %s %s", encoder->element, name, value);
+    }
+
+    return valid;
+}
+
+void cuRTSPEncoderConfigure(GstElement *element, const CUrtsp_encoder_desc *encoder, const CUDA_RTSP_ENCODER *pEncoder, bool lowLatency)
+{
+    char value[32];
+
+    if (lowLatency)
+    {
+        cuRTSPElementSet(element, encoder->bframes, "0");
+        cuRTSPElementSet(element, "zerolatency", "true");
+        cuRTSPElementSet(element, "low-latency", "true");
+        cuRTSPElementSet(element, "rc-lookahead", "0");
+        cuRTSPElementSet(element, encoder->preset, encoder->low_latency_preset);
+        cuRTSPElementSet(element, encoder->tune, encoder->low_latency_tune);
+    }
+
+    if (pEncoder->bitrate > 0)
+    {
+        cuRTSPEncoderSetBitrate(element, encoder, pEncoder->bitrate);
+    }
+
+    if (pEncoder->gopLength > 0)
+    {
+        snprintf(&value[0], sizeof(value) / sizeof(value[0]), "%u", pEncoder->gopLength);
+        cuRTSPElementSet(element, encoder->gop, &value[0]);
+    }
+
+    if (pEncoder->bFrames > 0)
+    {
+        snprintf(&value[0], sizeof(value) / sizeof(value[0]), "%u", pEncoder->bFrames);
+        cuRTSPElementSet(element, encoder->bframes, &value[0]);
+    }
+
+    if (pEncoder->rateControl > CU_RTSP_RATE_CONTROL_DEFAULT && pEncoder->rateControl <= CU_RTSP_RATE_CONTROL_CQP)
+    {
+        cuRTSPElementSet(element, encoder->rate_control, encoder->rate_control_values[pEncoder->rateControl]);
+    }
+
+    cuRTSPElementSet(element, encoder->preset, pEncoder->preset);
+    cuRTSPElementSet(element, encoder->tune, pEncoder->tune);
+}
+
+void cuRTSPEncoderSetBitrate(GstElement *element, const CUrtsp_encoder_desc *encoder, unsigned int bitrate)
+{
+    char value[32];
+
+    snprintf(&value[0], sizeof(value) / sizeof(value[0]), "%u", bitrate * encoder->bitrate_scale);
+    cuRTSPElementSet(element, encoder->bitrate, &value[0]);
+}
+
+void cuRTSPElementSet(GstElement *element, const char *name, const char *value)
+{
+    if (element != NULL && name != NULL && value != NULL && g_object_class_find_property(G_OBJECT_GET_CLASS(element), name) != NULL)
+    {
+        gst_util_set_object_arg(G_OBJECT(element), name, value);
+    }
+}
+
+CUresult cuRTSPMosaicTiles(
+    const char *caller,
+    const CUDA_RTSP_SESSION *pMosaicInfo,
+    const CUDA_RTSP_TILE *pTiles,
+    size_t tileCount,
+    CUrtsp_tile_st **pResult)
+{
+    CUresult result;
+    CUrtsp_session source;
+    size_t index;
+
+    result = CUDA_SUCCESS;
+    *pResult = NULL;
+
+    if (pTiles == NULL && tileCount > 0)
+    {
+        cuRTSPSetError("%s: pTiles cannot be NULL", caller);
+        goto error;
+    }
+
+    for (index = 0; index < tileCount; index++)
+    {
+        source = pTiles[index].source;
+        if (source == NULL || source->mosaic != NULL || source->session_info.input == CU_RTSP_INPUT_ENCODED)
+        {
+            cuRTSPSetError("%s: tile %zu needs a raw video session as its source", caller, index);
+            goto error;
+        }
+        if (source->session_info.format != pMosaicInfo->format)
+        {
+            cuRTSPSetError("%s: tile %zu does not match the mosaic format", caller, index);
+            goto error;
+        }
+#ifdef CU_RTSP_HOST
+        if (source->convert_pool != NULL)
+        {
+            cuRTSPSetError("%s: tile %zu is converted on ingest, use the encoder's format", caller, index);
+            goto error;
+        }
+#endif
+        if (pTiles[index].x >= pMosaicInfo->width || pTiles[index].y >= pMosaicInfo->height)
+        {
+            cuRTSPSetError("%s: tile %zu lies outside the mosaic", caller, index);
+            goto error;
+        }
+    }
+
+    *pResult = g_new0(CUrtsp_tile_st, MAX(tileCount, 1));
+    for (index = 0; index < tileCount; index++)
+    {
+        cuRTSPSessionRef(pTiles[index].source);
+        (*pResult)[index].source = pTiles[index].source;
+        (*pResult)[index].x = pTiles[index].x;
+        (*pResult)[index].y = pTiles[index].y;
+    }
+    goto done;
+error:
+    result = CUDA_ERROR_INVALID_VALUE;
+done:
+    return result;
+}
+
+void cuRTSPMosaicTilesFree(
+    CUrtsp_tile_st *tiles,
+    size_t tile_count)
+{
+    size_t index;
+
+    for (index = 0; index < tile_count; index++)
+    {
+        gst_buffer_replace(&tiles[index].frame, NULL);
+        cuRTSPSessionUnref(tiles[index].source);
+    }
+    g_free(tiles);
+}
+
+void cuRTSPMosaicFree(
+    CUrtsp_mosaic_st *mosaic)
+{
+    cuRTSPMosaicTilesFree(mosaic->tiles, mosaic->tile_count);
+    g_mutex_clear(&mosaic->lock);
+    g_free(mosaic);
+}
+
+void CUDA_CB cuRTSPMosaicWrite(
+    CUdeviceptr data,
+    size_t size,
+    void *userData)
+{
+    CUrtsp_mosaic_st *mosaic;
+    CUrtsp_tile_st *tile;
+    GstVideoInfo mosaic_info;
+    GstBuffer *frame;
+    gint64 now;
+    gint64 interval;
+    guint plane;
+    size_t index;
+
+    mosaic = (CUrtsp_mosaic_st *)userData;
+    g_mutex_lock(&mosaic->session->lock);
+    mosaic_info = mosaic->session->video_info;
+    g_mutex_unlock(&mosaic->session->lock);
+
+    // pool buffers come back with old content, clear uncovered areas
+    if (GST_VIDEO_INFO_FORMAT(&mosaic_info) == GST_VIDEO_FORMAT_VUYA)
+    {
+        // packed V U Y A, read as one little-endian word
+        cuMemsetD32(data, 0xFF108080u, size / 4);
+    }
+    else
+    {
+        for (plane = 0; plane < GST_VIDEO_INFO_N_PLANES(&mosaic_info); plane++)
+        {
+            cuMemsetD8(
+                data + GST_VIDEO_INFO_PLANE_OFFSET(&mosaic_info, plane),
+                (GST_VIDEO_INFO_IS_YUV(&mosaic_info) && GST_VIDEO_INFO_N_PLANES(&mosaic_info) > 1) ? ((plane == 0) ? 16 : 128) : 0,
+                ((plane + 1 < GST_VIDEO_INFO_N_PLANES(&mosaic_info)) ? GST_VIDEO_INFO_PLANE_OFFSET(&mosaic_info, plane + 1) : size) - GST_VIDEO_INFO_PLANE_OFFSET(&mosaic_info, plane));
+        }
+    }
+
+    g_mutex_lock(&mosaic->lock);
+    now = g_get_monotonic_time();
+    for (index = 0; index < mosaic->tile_count; index++)
+    {
+        tile = &mosaic->tiles[index];
+        interval = gst_util_uint64_scale_int(
+            tile->source->session_info.fpsDen,
+            G_TIME_SPAN_SECOND,
+            tile->source->session_info.fpsNum);
+        if (tile->frame == NULL || now - tile->updated >= interval)
+        {
+            frame = cuRTSPMosaicSourceFrame(tile->source);
+            if (frame != NULL)
+            {
+                gst_buffer_replace(&tile->frame, frame);
+                gst_buffer_unref(frame);
+                tile->updated = now;
+            }
+        }
+        if (tile->frame != NULL)
+        {
+            cuRTSPMosaicDraw(data, &mosaic_info, tile);
+        }
+    }
+    g_mutex_unlock(&mosaic->lock);
+}
+
+GstBuffer *cuRTSPMosaicSourceFrame(
+    CUrtsp_session source)
+{
+    return !g_atomic_int_get(&source->destroyed) ? cuRTSPSessionNewestFrame(source, NULL) : NULL;
+}
+
+void cuRTSPMosaicDraw(
+    CUdeviceptr data,
+    const GstVideoInfo *mosaic_info,
+    const CUrtsp_tile_st *tile)
+{
+    GstVideoInfo video_info;
+    GstVideoFrame frame;
+    CUDA_MEMCPY2D copy;
+    gint components[GST_VIDEO_MAX_COMPONENTS];
+    guint width;
+    guint height;
+    guint plane;
+
+    if (tile->x >= (size_t)GST_VIDEO_INFO_WIDTH(mosaic_info) || tile->y >= (size_t)GST_VIDEO_INFO_HEIGHT(mosaic_info))
+    {
+        return;
+    }
+    g_mutex_lock(&tile->source->lock);
+    video_info = tile->source->video_info;
+    g_mutex_unlock(&tile->source->lock);
+    if (GST_VIDEO_INFO_FORMAT(&video_info) != GST_VIDEO_INFO_FORMAT(mosaic_info) || !gst_video_frame_map(&frame, &video_info, tile->frame, CU_RTSP_MAP_READ))
+    {
+        return;
+    }
+
+    width = MIN((guint)GST_VIDEO_INFO_WIDTH(&video_info), (guint)(GST_VIDEO_INFO_WIDTH(mosaic_info) - tile->x));
+    height = MIN((guint)GST_VIDEO_INFO_HEIGHT(&video_info), (guint)(GST_VIDEO_INFO_HEIGHT(mosaic_info) - tile->y));
+    for (plane = 0; plane < GST_VIDEO_FRAME_N_PLANES(&frame); plane++)
+    {
+        gst_video_format_info_component(video_info.finfo, plane, components);
+        memset(&copy, 0, sizeof(copy));
+        copy.srcMemoryType = CU_MEMORYTYPE_DEVICE;
+        copy.srcDevice = (CUdeviceptr)GST_VIDEO_FRAME_PLANE_DATA(&frame, plane);
+        copy.srcPitch = GST_VIDEO_FRAME_PLANE_STRIDE(&frame, plane);
+        copy.dstMemoryType = CU_MEMORYTYPE_DEVICE;
+        copy.dstDevice = data + GST_VIDEO_INFO_PLANE_OFFSET(mosaic_info, plane);
+        copy.dstPitch = GST_VIDEO_INFO_PLANE_STRIDE(mosaic_info, plane);
+        copy.dstXInBytes = GST_VIDEO_FORMAT_INFO_SCALE_WIDTH(video_info.finfo, components[0], tile->x) * GST_VIDEO_FORMAT_INFO_PSTRIDE(video_info.finfo, components[0]);
+        copy.dstY = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT(video_info.finfo, components[0], tile->y);
+        copy.WidthInBytes = GST_VIDEO_FORMAT_INFO_SCALE_WIDTH(video_info.finfo, components[0], width) * GST_VIDEO_FORMAT_INFO_PSTRIDE(video_info.finfo, components[0]);
+        copy.Height = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT(video_info.finfo, components[0], height);
+        cuMemcpy2D(&copy);
+    }
+    gst_video_frame_unmap(&frame);
+}
+
+GstRTSPMediaFactory *cuRTSPSessionFactory(
+    CUrtsp_session hSession,
+    const CUDA_RTSP_SESSION *pCreateSession,
+    GstRTSPAddressPool *address_pool,
+    const CUDA_RTSP_RENDITION *pRendition)
+{
+    GstRTSPMediaFactory *factory;
+    GstRTSPLowerTrans protocols;
+    gchar *launch_string;
+
+    factory = gst_rtsp_media_factory_new();
+    launch_string = cuRTSPSessionLaunch(hSession, pRendition);
+    gst_rtsp_media_factory_set_launch(factory, launch_string);
+    g_free(launch_string);
+    gst_rtsp_media_factory_set_enable_rtcp(factory, (!pCreateSession->live || pCreateSession->encoder.maxBitrate > 0) ? TRUE : FALSE);
+    // pushed input has one queue, a second media would steal its frames
+    gst_rtsp_media_factory_set_shared(factory, (pCreateSession->shared || pCreateSession->input != CU_RTSP_INPUT_CALLBACK || hSession->session_info.prewarm || address_pool != NULL) ? TRUE : FALSE);
+    if (address_pool != NULL)
+    {
+        protocols = GST_RTSP_LOWER_TRANS_UDP_MCAST;
+        if (pCreateSession->multicast.unicast)
+        {
+            protocols |= GST_RTSP_LOWER_TRANS_UDP | GST_RTSP_LOWER_TRANS_TCP;
+        }
+        gst_rtsp_media_factory_set_address_pool(factory, address_pool);
+        gst_rtsp_media_factory_set_protocols(factory, protocols);
+        gst_rtsp_media_factory_set_max_mcast_ttl(factory, (pCreateSession->multicast.ttl > 0) ? pCreateSession->multicast.ttl : CU_RTSP_DEFAULT_MCAST_TTL);
+        gst_rtsp_media_factory_set_multicast_iface(factory, pCreateSession->multicast.iface);
+    }
+    if (pCreateSession->lowLatency)
+    {
+        gst_rtsp_media_factory_set_latency(factory, 0);
+    }
+    if (pCreateSession->sendBufferSize > 0)
+    {
+        gst_rtsp_media_factory_set_buffer_size(factory, (guint)pCreateSession->sendBufferSize);
+    }
+    if (hSession->session_info.prewarm && pRendition == NULL)
+    {
+        gst_rtsp_media_factory_set_stop_on_disconnect(factory, FALSE);
+        gst_rtsp_media_factory_set_suspend_mode(factory, GST_RTSP_SUSPEND_MODE_NONE);
+    }
+    if (pCreateSession->recording.location != NULL && pRendition == NULL)
+    {
+        gst_rtsp_media_factory_set_eos_shutdown(factory, TRUE);
+    }
+    if (pRendition != NULL)
+    {
+        g_object_set_data(G_OBJECT(factory), "cu-rtsp-rendition", (gpointer)pRendition);
+    }
+    g_signal_connect(factory, "media-configure", (GCallback)cuRTSPSessionConfigure, hSession);
+
+    return factory;
+}
+
+gchar *cuRTSPSessionLaunch(CUrtsp_session hSession, const CUDA_RTSP_RENDITION *pRendition)
+{
+    GString *launch;
+    bool recording;
+
+    launch = g_string_new("( appsrc name=source ");
+    if (hSession->session_info.input == CU_RTSP_INPUT_ENCODED)
+    {
+        g_string_append_printf(launch, "! %s name=parse ", PARSERS[hSession->session_info.encoder.codec]);
+    }
+    else
+    {
+        cuRTSPSessionLaunchRaw(hSession, pRendition, launch);
+    }
+    recording = hSession->session_info.recording.location != NULL && pRendition == NULL;
+    if (recording)
+    {
+        g_string_append(launch, "! tee name=record ");
+    }
+    g_string_append_printf(launch, "! %s name=pay0 pt=96 ", PAYLOADERS[hSession->session_info.encoder.codec]);
+    if (recording)
+    {
+        g_string_append_printf(
+            launch,
+            "record. ! queue name=recordqueue leaky=downstream max-size-buffers=0 max-size-bytes=0 max-size-time=%" G_GUINT64_FORMAT " ! %s ! splitmuxsink name=recorder muxer-factory=%s send-keyframe-requests=true ",
+            (guint64)CU_RTSP_RECORD_QUEUE_TIME,
+            PARSERS[hSession->session_info.encoder.codec],
+            MUXERS[hSession->session_info.recording.container]);
+    }
+    g_string_append(launch, ")");
+
+    return g_string_free(launch, FALSE);
+}
+
+void cuRTSPSessionLaunchRaw(CUrtsp_session hSession, const CUDA_RTSP_RENDITION *pRendition, GString *launch)
+{
+    if (hSession->session_info.input == CU_RTSP_INPUT_CALLBACK && hSession->session_info.streamCallback != NULL)
+    {
+        g_string_append(launch, "! queue name=fence max-size-buffers=2 max-size-bytes=0 max-size-time=0 ");
+    }
+    if (pRendition != NULL)
+    {
+#ifdef CU_RTSP_HOST
+        g_string_append_printf(launch, "! videoscale ! video/x-raw,width=%zu,height=%zu ", pRendition->width, pRendition->height);
+#else
+        g_string_append_printf(launch, "! cudascale ! video/x-raw(memory:CUDAMemory),width=%zu,height=%zu ", pRendition->width, pRendition->height);
+#endif
+    }
+    if (hSession->encoder->type == CU_RTSP_ENCODER_SOFTWARE)
+    {
+#ifndef CU_RTSP_HOST
+        g_string_append(launch, "! cudadownload ");
+#endif
+        g_string_append(launch, "! videoconvert ");
+    }
+#ifndef CU_RTSP_HOST
+    else if (cuRTSPSessionNeedsConvert(hSession->session_info.format))
+    {
+        g_string_append(launch, "! cudaconvert ");
+    }
+#endif
+    g_string_append_printf(launch, "! %s name=encoder ", hSession->encoder->element);
+    if (hSession->session_info.encoder.options != NULL)
+    {
+        g_string_append_printf(launch, "%s ", hSession->session_info.encoder.options);
+    }
+}
+
+#ifdef CU_RTSP_HOST
+GstBufferPool *cuRTSPSessionConvertPool(
+    CUrtsp_session hSession,
+    const CUDA_RTSP_SESSION *pSessionInfo,
+    GstCaps **pCaps,
+    GstVideoInfo *pConvertInfo)
+{
+    CUDA_RTSP_SESSION convert_info;
+    GstBufferPool *result;
+    GstCaps *caps;
+
+    result = NULL;
+    convert_info = *pSessionInfo;
+    convert_info.format = (hSession->encoder->type == CU_RTSP_ENCODER_SOFTWARE) ? CU_RTSP_FORMAT_I420 : CU_RTSP_FORMAT_NV12;
+    if (convert_info.format != pSessionInfo->format && cuRTSPConvertSupported(pSessionInfo->format, convert_info.format))
+    {
+        caps = cuRTSPSessionCaps(&convert_info);
+        gst_video_info_from_caps(pConvertInfo, caps);
+        result = cuRTSPSessionPool(hSession, caps, pConvertInfo->size);
+        gst_caps_take(pCaps, caps);
+    }
+
+    return result;
+}
+
+GstBuffer *cuRTSPSessionConvertBuffer(
+    CUrtsp_session hSession,
+    GstBuffer *buffer)
+{
+    GstBufferPool *pool;
+    GstBuffer *result;
+    GstVideoInfo video_info;
+    GstVideoInfo convert_info;
+    GstVideoFrame src_frame;
+    GstVideoFrame dst_frame;
+    GstReferenceTimestampMeta *capture;
+    CUrtsp_image src;
+    CUrtsp_image dst;
+    guint plane;
+
+    g_mutex_lock(&hSession->lock);
+    pool = (hSession->convert_pool != NULL) ? gst_object_ref(hSession->convert_pool) : NULL;
+    video_info = hSession->video_info;
+    convert_info = hSession->convert_info;
+    g_mutex_unlock(&hSession->lock);
+    if (pool == NULL)
+    {
+        return buffer;
+    }
+
+    result = NULL;
+    if (gst_buffer_pool_acquire_buffer(pool, &result, NULL) == GST_FLOW_OK)
+    {
+        if (gst_video_frame_map(&src_frame, &video_info, buffer, GST_MAP_READ))
+        {
+            if (gst_video_frame_map(&dst_frame, &convert_info, result, GST_MAP_WRITE))
+            {
+                memset(&src, 0, sizeof(src));
+                memset(&dst, 0, sizeof(dst));
+                src.format = hSession->session_info.format;
+                dst.format = (GST_VIDEO_INFO_FORMAT(&convert_info) == GST_VIDEO_FORMAT_NV12) ? CU_RTSP_FORMAT_NV12 : CU_RTSP_FORMAT_I420;
+                src.width = dst.width = GST_VIDEO_INFO_WIDTH(&video_info);
+                src.height = dst.height = GST_VIDEO_INFO_HEIGHT(&video_info);
+                for (plane = 0; plane < GST_VIDEO_FRAME_N_PLANES(&src_frame); plane++)
+                {
+                    src.planes[plane] = GST_VIDEO_FRAME_PLANE_DATA(&src_frame, plane);
+                    src.pitches[plane] = GST_VIDEO_FRAME_PLANE_STRIDE(&src_frame, plane);
+                }
+                for (plane = 0; plane < GST_VIDEO_FRAME_N_PLANES(&dst_frame); plane++)
+                {
+                    dst.planes[plane] = GST_VIDEO_FRAME_PLANE_DATA(&dst_frame, plane);
+                    dst.pitches[plane] = GST_VIDEO_FRAME_PLANE_STRIDE(&dst_frame, plane);
+                }
+                cuRTSPConvertFrame(&src, &dst);
+                gst_video_frame_unmap(&dst_frame);
+            }
+            else
+            {
+                gst_buffer_replace(&result, NULL);
+            }
+            gst_video_frame_unmap(&src_frame);
+        }
+        else
+        {
+            gst_buffer_replace(&result, NULL);
+        }
+    }
+
+    if (result != NULL)
+    {
+        capture = gst_buffer_get_reference_timestamp_meta(buffer, CAPTURE_CAPS);
+        if (capture != NULL)
+        {
+            gst_buffer_add_reference_timestamp_meta(result, CAPTURE_CAPS, capture->timestamp, capture->duration);
+        }
+    }
+    gst_buffer_unref(buffer);
+    gst_object_unref(pool);
+
+    return result;
 }
+#endif
 
 bool cuRTSPSessionNeedsConvert(CUrtsp_format format)
 {
@@ -18,6 +18,10 @@ extern "C"
     typedef struct CUrtsp_session_st *CUrtsp_session;
 
 #define CU_RTSP_DEFAULT_PORT 8554
+#define CU_RTSP_DEFAULT_QUEUE_DEPTH 4
+#define CU_RTSP_HISTOGRAM_BUCKETS 24
+
+#define CU_RTSP_MAX_PLANES 4
 
     typedef enum CUrtsp_format_enum
     {
@@ -34,14 +38,170 @@ extern "C"
         CU_RTSP_FORMAT_RGB,
     } CUrtsp_format;
 
+    typedef enum CUrtsp_codec_enum
+    {
+        CU_RTSP_CODEC_H264,
+        CU_RTSP_CODEC_H265,
+        CU_RTSP_CODEC_AV1,
+    } CUrtsp_codec;
+
+    typedef enum CUrtsp_encoder_enum
+    {
+        CU_RTSP_ENCODER_AUTO,
+        CU_RTSP_ENCODER_NVENC,
+        CU_RTSP_ENCODER_SOFTWARE,
+    } CUrtsp_encoder;
+
+    typedef enum CUrtsp_rate_control_enum
+    {
+        CU_RTSP_RATE_CONTROL_DEFAULT,
+        CU_RTSP_RATE_CONTROL_CBR,
+        CU_RTSP_RATE_CONTROL_VBR,
+        CU_RTSP_RATE_CONTROL_CQP,
+    } CUrtsp_rate_control;
+
+    // pushed and encoded input always share their media
+    typedef enum CUrtsp_input_enum
+    {
+        CU_RTSP_INPUT_CALLBACK,
+        CU_RTSP_INPUT_PUSH,
+        CU_RTSP_INPUT_ENCODED,
+    } CUrtsp_input;
+
+    // a full queue of access units drops until the next key unit
+    typedef enum CUrtsp_queue_policy_enum
+    {
+        CU_RTSP_QUEUE_DROP_OLDEST,
+        CU_RTSP_QUEUE_DROP_NEWEST,
+        CU_RTSP_QUEUE_BLOCK,
+    } CUrtsp_queue_policy;
+
+    typedef enum CUrtsp_backpressure_enum
+    {
+        CU_RTSP_BACKPRESSURE_DROP,
+        CU_RTSP_BACKPRESSURE_KEYFRAME,
+        CU_RTSP_BACKPRESSURE_DISCONNECT,
+    } CUrtsp_backpressure;
+
+    typedef enum CUrtsp_aggregate_enum
+    {
+        CU_RTSP_AGGREGATE_DEFAULT,
+        CU_RTSP_AGGREGATE_NONE,
+        CU_RTSP_AGGREGATE_ZERO_LATENCY,
+        CU_RTSP_AGGREGATE_MAX,
+    } CUrtsp_aggregate;
+
+    typedef enum CUrtsp_frame_status_enum
+    {
+        CU_RTSP_FRAME_NEW,
+        CU_RTSP_FRAME_UNCHANGED,
+    } CUrtsp_frame_status;
+
+    typedef struct CUrtsp_rect_st
+    {
+        size_t x;
+        size_t y;
+        size_t width;
+        size_t height;
+    } CUrtsp_rect;
+
     typedef void(CUDA_CB *CUrtspWriteCallback)(CUdeviceptr, size_t, void *);
 
+    typedef CUrtsp_frame_status(CUDA_CB *CUrtspUpdateCallback)(CUdeviceptr, size_t, CUrtsp_rect *, void *);
+
+    // the callback must not wait for the work it queues on the stream
+    typedef void(CUDA_CB *CUrtspStreamCallback)(CUdeviceptr, size_t, CUstream, void *);
+
+    typedef void(CUDA_CB *CUrtspLatencyCallback)(uint64_t, uint64_t, void *);
+
+    typedef void(CUDA_CB *CUrtspReleaseCallback)(void *);
+
+    // clients are served by clientThreads main loops, pinned round-robin to cpus
     typedef struct CUDA_RTSP_SERVER_st
     {
         const char *host;
         uint16_t port;
+        size_t clientThreads;
+        const int *cpus;
+        size_t cpuCount;
     } CUDA_RTSP_SERVER;
 
+    // a descriptor the server waits on, events and revents use the poll(2) bits
+    typedef struct CUDA_RTSP_POLLFD_st
+    {
+        int fd;
+        unsigned short events;
+        unsigned short revents;
+    } CUDA_RTSP_POLLFD;
+
+    // zero values keep the encoder defaults, bitrates are in kbit/s, a non-zero maxBitrate adapts to receiver reports
+    typedef struct CUDA_RTSP_ENCODER_st
+    {
+        CUrtsp_codec codec;
+        CUrtsp_encoder encoder;
+        CUrtsp_rate_control rateControl;
+        unsigned int bitrate;
+        unsigned int minBitrate;
+        unsigned int maxBitrate;
+        unsigned int gopLength;
+        unsigned int bFrames;
+        const char *preset;
+        const char *tune;
+        const char *options;
+    } CUDA_RTSP_ENCODER;
+
+    // multicast is offered when addressMin is set, zero values keep the defaults
+    typedef struct CUDA_RTSP_MULTICAST_st
+    {
+        const char *addressMin;
+        const char *addressMax;
+        uint16_t portMin;
+        uint16_t portMax;
+        uint8_t ttl;
+        const char *iface;
+        bool unicast;
+    } CUDA_RTSP_MULTICAST;
+
+    // caps each interleaved client's send queue, a client over it resumes at a key unit once drained to half
+    typedef struct CUDA_RTSP_BACKPRESSURE_st
+    {
+        size_t maxQueueBytes;
+        CUrtsp_backpressure policy;
+        unsigned int disconnectSeconds;
+    } CUDA_RTSP_BACKPRESSURE;
+
+    typedef enum CUrtsp_container_enum
+    {
+        CU_RTSP_CONTAINER_MP4,
+        CU_RTSP_CONTAINER_MPEGTS,
+    } CUrtsp_container;
+
+    // recording is on when location is set, a printf pattern such as "/archive/cam-%05d.mp4"
+    typedef struct CUDA_RTSP_RECORDING_st
+    {
+        const char *location;
+        CUrtsp_container container;
+        unsigned int segmentSeconds;
+        unsigned int maxFiles;
+    } CUDA_RTSP_RECORDING;
+
+    // one rung of a simulcast ladder, mounted at <path>/<name>
+    typedef struct CUDA_RTSP_RENDITION_st
+    {
+        const char *name;
+        size_t width;
+        size_t height;
+        unsigned int bitrate;
+    } CUDA_RTSP_RENDITION;
+
+    // a source session drawn at x, y of a mosaic, clipped to it
+    typedef struct CUDA_RTSP_TILE_st
+    {
+        CUrtsp_session source;
+        size_t x;
+        size_t y;
+    } CUDA_RTSP_TILE;
+
     typedef struct CUDA_RTSP_SESSION_st
     {
         CUdevice device;
@@ -52,16 +212,103 @@ extern "C"
         size_t fpsNum;
         size_t fpsDen;
         bool live;
+        bool shared;
+        bool lowLatency;
+        bool prewarm;
+        CUrtsp_input input;
+        size_t queueDepth;
+        CUrtsp_queue_policy queuePolicy;
+        size_t poolMin;
+        size_t poolMax;
+        CUDA_RTSP_ENCODER encoder;
+        const CUDA_RTSP_RENDITION *renditions;
+        size_t renditionCount;
+        CUDA_RTSP_MULTICAST multicast;
+        CUDA_RTSP_RECORDING recording;
+        unsigned int mtu;
+        CUrtsp_aggregate aggregateMode;
+        size_t sendBufferSize;
+        // Linux UDP GSO, the egress interface must offload UDP checksums
+        bool segmentationOffload;
+        CUDA_RTSP_BACKPRESSURE backpressure;
+        // repeat an unchanged frame after this long, zero uses encoder.gopLength frames or 5 s
+        unsigned int idleIntervalMs;
         CUrtspWriteCallback writeCallback;
+        CUrtspUpdateCallback updateCallback;
+        CUrtspStreamCallback streamCallback;
+        CUrtspLatencyCallback latencyCallback;
         void *userData;
     } CUDA_RTSP_SESSION;
 
-    void cuRTSPInit();
+    // microseconds, bucket i counts samples below 2^i
+    typedef struct CUDA_RTSP_HISTOGRAM_st
+    {
+        uint64_t count;
+        uint64_t sum;
+        uint64_t max;
+        uint64_t buckets[CU_RTSP_HISTOGRAM_BUCKETS];
+    } CUDA_RTSP_HISTOGRAM;
+
+    // encodeLatency and captureLatency are sampled estimates, encoderQueue counts frames inside encoders
+    typedef struct CUDA_RTSP_SESSION_STATS_st
+    {
+        uint64_t framesProduced;
+        uint64_t framesSent;
+        uint64_t framesEncoded;
+        uint64_t framesRepeated;
+        uint64_t framesDropped;
+        uint64_t encoderQueue;
+        uint64_t clientsThrottled;
+        uint64_t clientsResynced;
+        uint64_t clientsDisconnected;
+        uint64_t bitrate;
+        size_t queueDepth;
+        size_t mediaCount;
+        CUDA_RTSP_HISTOGRAM callbackLatency;
+        CUDA_RTSP_HISTOGRAM acquireLatency;
+        CUDA_RTSP_HISTOGRAM encodeLatency;
+        CUDA_RTSP_HISTOGRAM captureLatency;
+        CUDA_RTSP_HISTOGRAM joinLatency;
+    } CUDA_RTSP_SESSION_STATS;
+
+    typedef struct CUDA_RTSP_CLIENT_STATS_st
+    {
+        CUrtsp_session session;
+        char address[64];
+        bool interleaved;
+        // RTP sent to this client alone
+        uint64_t bytesSent;
+        uint64_t packetsSent;
+        int64_t packetsLost;
+        double fractionLost;
+        uint64_t jitter;
+        uint64_t roundTrip;
+        uint64_t sendQueueBytes;
+        bool throttled;
+        uint64_t throttleEvents;
+        uint64_t framesSkipped;
+    } CUDA_RTSP_CLIENT_STATS;
+
+    // planes lie in one allocation starting at planes[0], zero pitches follow the packed layout
+    typedef struct CUDA_RTSP_FRAME_st
+    {
+        CUdeviceptr planes[CU_RTSP_MAX_PLANES];
+        size_t pitches[CU_RTSP_MAX_PLANES];
+        CUrtspReleaseCallback releaseCallback;
+        void *userData;
+    } CUDA_RTSP_FRAME;
+
+    CUresult cuRTSPInit();
 
     void cuRTSPDeinit();
 
     const char *cuRTSPGetError();
 
+    // trace every frame through every stage until cuRTSPTraceStop writes Chrome trace JSON to path
+    CUresult cuRTSPTraceStart(const char *path, size_t maxEvents);
+
+    CUresult cuRTSPTraceStop();
+
     CUresult cuRTSPServerCreate(CUrtsp_server *pServer, const CUDA_RTSP_SERVER *pCreateServer);
 
     void cuRTSPServerDestroy(CUrtsp_server hServer);
@@ -72,14 +319,48 @@ extern "C"
 
     void cuRTSPServerShutdown(CUrtsp_server hServer);
 
+    // serve from the caller's event loop instead of cuRTSPServerDispatch
+    CUresult cuRTSPServerAttachExternal(CUrtsp_server hServer);
+
+    // descriptors and timeout for the caller's poll, pCount holds the capacity and receives the count
+    CUresult cuRTSPServerPrepare(CUrtsp_server hServer, CUDA_RTSP_POLLFD *pFds, size_t *pCount, int *pTimeoutMs);
+
+    // dispatch what became ready after the poll
+    CUresult cuRTSPServerIterate(CUrtsp_server hServer, const CUDA_RTSP_POLLFD *pFds, size_t count);
+
+    CUresult cuRTSPServerGetStats(CUrtsp_server hServer, CUDA_RTSP_CLIENT_STATS *pStats, size_t *pCount);
+
 #ifdef CU_RTSP_EXPOSE_GMAIN
     CUresult cuRTSPServerAttachGMain(CUrtsp_server hServer, GMainContext *context);
 #endif
 
     CUresult cuRTSPSessionCreate(CUrtsp_session *pSession, const CUDA_RTSP_SESSION *pCreateSession);
 
+    // the mosaic is encoded once, its callbacks are replaced by the compositor
+    CUresult cuRTSPSessionCreateMosaic(CUrtsp_session *pSession, const CUDA_RTSP_SESSION *pCreateSession, const CUDA_RTSP_TILE *pTiles, size_t tileCount);
+
+    CUresult cuRTSPSessionSetTiles(CUrtsp_session hSession, const CUDA_RTSP_TILE *pTiles, size_t tileCount);
+
     CUresult cuRTSPSessionMount(CUrtsp_session hSession, CUrtsp_server hServer, const char *path);
 
+    CUresult cuRTSPSessionUnmount(CUrtsp_session hSession, CUrtsp_server hServer, const char *path);
+
+    CUresult cuRTSPSessionReconfigure(CUrtsp_session hSession, size_t width, size_t height, CUrtsp_format format, size_t fpsNum, size_t fpsDen);
+
+    void cuRTSPSessionDestroy(CUrtsp_session hSession);
+
+    CUresult cuRTSPSessionPushFrame(CUrtsp_session hSession, CUrtspWriteCallback writeCallback, void *userData);
+
+    // data is one Annex-B (H.264/H.265) or OBU (AV1) access unit, pts is in nanoseconds
+    CUresult cuRTSPSessionPushAccessUnit(CUrtsp_session hSession, const void *data, size_t size, uint64_t pts, bool keyframe);
+
+    CUresult cuRTSPSessionPushExternalFrame(CUrtsp_session hSession, const CUDA_RTSP_FRAME *pFrame);
+
+    CUresult cuRTSPSessionGetStats(CUrtsp_session hSession, CUDA_RTSP_SESSION_STATS *pStats);
+
+    // newest frame as a JPEG, zero width and height keep the session size, pSize receives the size needed
+    CUresult cuRTSPSessionGetSnapshot(CUrtsp_session hSession, size_t width, size_t height, void *pData, size_t *pSize);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,1132 @@
+#include "cuda_rtsp_convert.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CU_RTSP_CONVERT_X86 1
+#include <immintrin.h>
+#endif
+
+// byte offsets of the colour channels in one packed RGB pixel
+typedef struct CUrtsp_rgb_layout_st
+{
+    CUrtsp_format format;
+    uint8_t bpp;
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+} CUrtsp_rgb_layout;
+
+// converts a pair of rows from column x on, returns the first column left
+typedef uint32_t (*CUrtsp_convert_rows)(
+    const CUrtsp_rgb_layout *layout,
+    const uint8_t *src0,
+    const uint8_t *src1,
+    uint8_t *y0,
+    uint8_t *y1,
+    uint8_t *u,
+    uint8_t *v,
+    uint8_t *uv,
+    uint32_t x,
+    uint32_t width);
+
+// component (x, y) of a YUV source is at plane[(y >> shift_y) * pitch + (x >> shift_x) * step]
+typedef struct CUrtsp_yuv_component_st
+{
+    const uint8_t *plane;
+    size_t pitch;
+    uint8_t step;
+    uint8_t shift_x;
+    uint8_t shift_y;
+} CUrtsp_yuv_component;
+
+// YUV relayout kernels start at x and return the first sample left
+typedef struct CUrtsp_relayout_st
+{
+    uint32_t (*interleave)(const uint8_t *u, const uint8_t *v, uint8_t *uv, uint32_t x, uint32_t count);
+    uint32_t (*deinterleave)(const uint8_t *uv, uint8_t *u, uint8_t *v, uint32_t x, uint32_t count);
+    uint32_t (*average)(const uint8_t *u0, const uint8_t *u1, const uint8_t *v0, const uint8_t *v1, uint8_t *u, uint8_t *v, uint8_t *uv, uint32_t x, uint32_t width);
+    uint32_t (*vuya_luma)(const uint8_t *src, uint8_t *y, uint32_t x, uint32_t width);
+    uint32_t (*vuya_chroma)(const uint8_t *src0, const uint8_t *src1, uint8_t *u, uint8_t *v, uint8_t *uv, uint32_t x, uint32_t width);
+} CUrtsp_relayout;
+
+typedef struct CUrtsp_convert_isa_st
+{
+    const char *name;
+    CUrtsp_convert_rows rows;
+    const CUrtsp_relayout *relayout;
+} CUrtsp_convert_isa;
+
+static const CUrtsp_rgb_layout RGB_LAYOUTS[] = {
+    {CU_RTSP_FORMAT_BGRA, 4, 2, 1, 0},
+    {CU_RTSP_FORMAT_RGBA, 4, 0, 1, 2},
+    {CU_RTSP_FORMAT_ARGB, 4, 1, 2, 3},
+    {CU_RTSP_FORMAT_ABGR, 4, 3, 2, 1},
+    {CU_RTSP_FORMAT_BGR, 3, 2, 1, 0},
+    {CU_RTSP_FORMAT_RGB, 3, 0, 1, 2},
+};
+
+static const CUrtsp_convert_isa *CONVERT_ISA = NULL;
+
+static uint32_t cuRTSPInterleaveScalar(const uint8_t *u, const uint8_t *v, uint8_t *uv, uint32_t x, uint32_t count);
+
+static uint32_t cuRTSPDeinterleaveScalar(const uint8_t *uv, uint8_t *u, uint8_t *v, uint32_t x, uint32_t count);
+
+static uint32_t cuRTSPAverageScalar(const uint8_t *u0, const uint8_t *u1, const uint8_t *v0, const uint8_t *v1, uint8_t *u, uint8_t *v, uint8_t *uv, uint32_t x, uint32_t width);
+
+static uint32_t cuRTSPVuyaLumaScalar(const uint8_t *src, uint8_t *y, uint32_t x, uint32_t width);
+
+static uint32_t cuRTSPVuyaChromaScalar(const uint8_t *src0, const uint8_t *src1, uint8_t *u, uint8_t *v, uint8_t *uv, uint32_t x, uint32_t width);
+
+static const CUrtsp_relayout RELAYOUT_SCALAR = {
+    cuRTSPInterleaveScalar,
+    cuRTSPDeinterleaveScalar,
+    cuRTSPAverageScalar,
+    cuRTSPVuyaLumaScalar,
+    cuRTSPVuyaChromaScalar,
+};
+
+#ifdef CU_RTSP_CONVERT_X86
+static uint32_t cuRTSPInterleaveSse41(const uint8_t *u, const uint8_t *v, uint8_t *uv, uint32_t x, uint32_t count);
+
+static uint32_t cuRTSPDeinterleaveSse41(const uint8_t *uv, uint8_t *u, uint8_t *v, uint32_t x, uint32_t count);
+
+static uint32_t cuRTSPAverageSse41(const uint8_t *u0, const uint8_t *u1, const uint8_t *v0, const uint8_t *v1, uint8_t *u, uint8_t *v, uint8_t *uv, uint32_t x, uint32_t width);
+
+static uint32_t cuRTSPVuyaLumaSse41(const uint8_t *src, uint8_t *y, uint32_t x, uint32_t width);
+
+static uint32_t cuRTSPVuyaChromaSse41(const uint8_t *src0, const uint8_t *src1, uint8_t *u, uint8_t *v, uint8_t *uv, uint32_t x, uint32_t width);
+
+// relayout is bound by memory bandwidth, wider units share the 128 bit kernels
+static const CUrtsp_relayout RELAYOUT_SSE41 = {
+    cuRTSPInterleaveSse41,
+    cuRTSPDeinterleaveSse41,
+    cuRTSPAverageSse41,
+    cuRTSPVuyaLumaSse41,
+    cuRTSPVuyaChromaSse41,
+};
+#endif
+
+static const CUrtsp_rgb_layout *cuRTSPConvertRgbLayout(CUrtsp_format format);
+
+static uint32_t cuRTSPConvertRowsScalar(
+    const CUrtsp_rgb_layout *layout,
+    const uint8_t *src0,
+    const uint8_t *src1,
+    uint8_t *y0,
+    uint8_t *y1,
+    uint8_t *u,
+    uint8_t *v,
+    uint8_t *uv,
+    uint32_t x,
+    uint32_t width);
+
+#ifdef CU_RTSP_CONVERT_X86
+static uint32_t cuRTSPConvertRowsSse41(
+    const CUrtsp_rgb_layout *layout,
+    const uint8_t *src0,
+    const uint8_t *src1,
+    uint8_t *y0,
+    uint8_t *y1,
+    uint8_t *u,
+    uint8_t *v,
+    uint8_t *uv,
+    uint32_t x,
+    uint32_t width);
+
+static uint32_t cuRTSPConvertRowsAvx2(
+    const CUrtsp_rgb_layout *layout,
+    const uint8_t *src0,
+    const uint8_t *src1,
+    uint8_t *y0,
+    uint8_t *y1,
+    uint8_t *u,
+    uint8_t *v,
+    uint8_t *uv,
+    uint32_t x,
+    uint32_t width);
+
+static uint32_t cuRTSPConvertRowsAvx512(
+    const CUrtsp_rgb_layout *layout,
+    const uint8_t *src0,
+    const uint8_t *src1,
+    uint8_t *y0,
+    uint8_t *y1,
+    uint8_t *u,
+    uint8_t *v,
+    uint8_t *uv,
+    uint32_t x,
+    uint32_t width);
+#endif
+
+static const CUrtsp_convert_isa CONVERT_ISAS[] = {
+#ifdef CU_RTSP_CONVERT_X86
+    {"avx512bw", cuRTSPConvertRowsAvx512, &RELAYOUT_SSE41},
+    {"avx2", cuRTSPConvertRowsAvx2, &RELAYOUT_SSE41},
+    {"sse4.1", cuRTSPConvertRowsSse41, &RELAYOUT_SSE41},
+#endif
+    {"scalar", cuRTSPConvertRowsScalar, &RELAYOUT_SCALAR},
+};
+
+// picked once, racing callers pick the same entry
+static const CUrtsp_convert_isa *cuRTSPConvertSelect(void);
+
+static void cuRTSPConvertRgb(const CUrtsp_rgb_layout *layout, const CUrtsp_image *pSrc, const CUrtsp_image *pDst);
+
+// YUV sources only change layout
+static void cuRTSPConvertYuv(const CUrtsp_image *pSrc, const CUrtsp_image *pDst);
+
+// 4:2:0 chroma only changes between planar and interleaved
+static void cuRTSPConvertYuv420(const CUrtsp_relayout *relayout, const CUrtsp_image *pSrc, const CUrtsp_image *pDst);
+
+// any other source, one sample at a time
+static void cuRTSPConvertYuvGeneric(const CUrtsp_image *pSrc, const CUrtsp_image *pDst);
+
+// layout of a YUV source's components
+static void cuRTSPConvertComponents(const CUrtsp_image *pSrc, CUrtsp_yuv_component *pY, CUrtsp_yuv_component *pU, CUrtsp_yuv_component *pV);
+
+static void cuRTSPConvertComponent(CUrtsp_yuv_component *pComponent, const uint8_t *plane, size_t pitch, uint8_t step, uint8_t shift);
+
+static inline uint8_t cuRTSPConvertLuma(int r, int g, int b)
+{
+    return (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+static inline uint8_t cuRTSPConvertCb(int r, int g, int b)
+{
+    return (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+static inline uint8_t cuRTSPConvertCr(int r, int g, int b)
+{
+    return (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+bool cuRTSPConvertSupported(CUrtsp_format src, CUrtsp_format dst)
+{
+    return (dst == CU_RTSP_FORMAT_NV12 || dst == CU_RTSP_FORMAT_I420) && src <= CU_RTSP_FORMAT_RGB;
+}
+
+void cuRTSPConvertFrame(const CUrtsp_image *pSrc, const CUrtsp_image *pDst)
+{
+    const CUrtsp_rgb_layout *layout;
+
+    layout = cuRTSPConvertRgbLayout(pSrc->format);
+    if (layout != NULL)
+    {
+        cuRTSPConvertRgb(layout, pSrc, pDst);
+    }
+    else
+    {
+        cuRTSPConvertYuv(pSrc, pDst);
+    }
+}
+
+const char *cuRTSPConvertIsa(void)
+{
+    return cuRTSPConvertSelect()->name;
+}
+
+bool cuRTSPConvertForceIsa(const char *name)
+{
+    size_t index;
+
+    for (index = 0; index < sizeof(CONVERT_ISAS) / sizeof(CONVERT_ISAS[0]); index++)
+    {
+        if (strcmp(CONVERT_ISAS[index].name, name) == 0)
+        {
+#ifdef CU_RTSP_CONVERT_X86
+            __builtin_cpu_init();
+            if ((CONVERT_ISAS[index].rows == cuRTSPConvertRowsAvx512 && !__builtin_cpu_supports("avx512bw")) ||
+                (CONVERT_ISAS[index].rows == cuRTSPConvertRowsAvx2 && !__builtin_cpu_supports("avx2")) ||
+                (CONVERT_ISAS[index].rows == cuRTSPConvertRowsSse41 && !__builtin_cpu_supports("sse4.1")))
+            {
+                return false;
+            }
+#endif
+            __atomic_store_n(&CONVERT_ISA, &CONVERT_ISAS[index], __ATOMIC_RELEASE);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static const CUrtsp_rgb_layout *cuRTSPConvertRgbLayout(CUrtsp_format format)
+{
+    const CUrtsp_rgb_layout *result;
+    size_t index;
+
+    result = NULL;
+
+    for (index = 0; index < sizeof(RGB_LAYOUTS) / sizeof(RGB_LAYOUTS[0]) && result == NULL; index++)
+    {
+        if (RGB_LAYOUTS[index].format == format)
+        {
+            result = &RGB_LAYOUTS[index];
+        }
+    }
+
+    return result;
+}
+
+static const CUrtsp_convert_isa *cuRTSPConvertSelect(void)
+{
+    const CUrtsp_convert_isa *result;
+
+    result = __atomic_load_n(&CONVERT_ISA, __ATOMIC_ACQUIRE);
+    if (result == NULL)
+    {
+        result = &CONVERT_ISAS[sizeof(CONVERT_ISAS) / sizeof(CONVERT_ISAS[0]) - 1];
+#ifdef CU_RTSP_CONVERT_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512bw"))
+        {
+            result = &CONVERT_ISAS[0];
+        }
+        else if (__builtin_cpu_supports("avx2"))
+        {
+            result = &CONVERT_ISAS[1];
+        }
+        else if (__builtin_cpu_supports("sse4.1"))
+        {
+            result = &CONVERT_ISAS[2];
+        }
+#endif
+        __atomic_store_n(&CONVERT_ISA, result, __ATOMIC_RELEASE);
+    }
+
+    return result;
+}
+
+static void cuRTSPConvertRgb(const CUrtsp_rgb_layout *layout, const CUrtsp_image *pSrc, const CUrtsp_image *pDst)
+{
+    CUrtsp_convert_rows rows;
+    const uint8_t *src0;
+    const uint8_t *src1;
+    uint8_t *y0;
+    uint8_t *y1;
+    uint8_t *u;
+    uint8_t *v;
+    uint8_t *uv;
+    uint32_t row;
+    uint32_t x;
+
+    rows = cuRTSPConvertSelect()->rows;
+    u = NULL;
+    v = NULL;
+    uv = NULL;
+
+    // the last row of an odd height is paired with itself
+    for (row = 0; row < pSrc->height; row += 2)
+    {
+        src0 = pSrc->planes[0] + row * pSrc->pitches[0];
+        src1 = (row + 1 < pSrc->height) ? src0 + pSrc->pitches[0] : src0;
+        y0 = pDst->planes[0] + row * pDst->pitches[0];
+        y1 = (row + 1 < pSrc->height) ? y0 + pDst->pitches[0] : y0;
+        if (pDst->format == CU_RTSP_FORMAT_NV12)
+        {
+            uv = pDst->planes[1] + (row / 2) * pDst->pitches[1];
+        }
+        else
+        {
+            u = pDst->planes[1] + (row / 2) * pDst->pitches[1];
+            v = pDst->planes[2] + (row / 2) * pDst->pitches[2];
+        }
+        x = rows(layout, src0, src1, y0, y1, u, v, uv, 0, pSrc->width);
+        cuRTSPConvertRowsScalar(layout, src0, src1, y0, y1, u, v, uv, x, pSrc->width);
+    }
+}
+
+static uint32_t cuRTSPConvertRowsScalar(
+    const CUrtsp_rgb_layout *layout,
+    const uint8_t *src0,
+    const uint8_t *src1,
+    uint8_t *y0,
+    uint8_t *y1,
+    uint8_t *u,
+    uint8_t *v,
+    uint8_t *uv,
+    uint32_t x,
+    uint32_t width)
+{
+    const uint8_t *p00;
+    const uint8_t *p01;
+    const uint8_t *p10;
+    const uint8_t *p11;
+    uint32_t x1;
+    int r;
+    int g;
+    int b;
+
+    for (; x < width; x += 2)
+    {
+        // the last column of an odd width is paired with itself
+        x1 = (x + 1 < width) ? x + 1 : x;
+        p00 = src0 + x * layout->bpp;
+        p01 = src0 + x1 * layout->bpp;
+        p10 = src1 + x * layout->bpp;
+        p11 = src1 + x1 * layout->bpp;
+        y0[x] = cuRTSPConvertLuma(p00[layout->r], p00[layout->g], p00[layout->b]);
+        y0[x1] = cuRTSPConvertLuma(p01[layout->r], p01[layout->g], p01[layout->b]);
+        y1[x] = cuRTSPConvertLuma(p10[layout->r], p10[layout->g], p10[layout->b]);
+        y1[x1] = cuRTSPConvertLuma(p11[layout->r], p11[layout->g], p11[layout->b]);
+        r = (p00[layout->r] + p01[layout->r] + p10[layout->r] + p11[layout->r] + 2) >> 2;
+        g = (p00[layout->g] + p01[layout->g] + p10[layout->g] + p11[layout->g] + 2) >> 2;
+        b = (p00[layout->b] + p01[layout->b] + p10[layout->b] + p11[layout->b] + 2) >> 2;
+        if (uv != NULL)
+        {
+            uv[x] = cuRTSPConvertCb(r, g, b);
+            uv[x + 1] = cuRTSPConvertCr(r, g, b);
+        }
+        else
+        {
+            u[x / 2] = cuRTSPConvertCb(r, g, b);
+            v[x / 2] = cuRTSPConvertCr(r, g, b);
+        }
+    }
+
+    return x;
+}
+
+#ifdef CU_RTSP_CONVERT_X86
+// gathers four pixels into 32 bit lanes of b, g, r and a zero byte
+__attribute__((target("sse4.1"))) static __m128i cuRTSPConvertShuffle(const CUrtsp_rgb_layout *layout)
+{
+    int8_t mask[16];
+    int pixel;
+
+    for (pixel = 0; pixel < 4; pixel++)
+    {
+        mask[pixel * 4 + 0] = (int8_t)(pixel * layout->bpp + layout->b);
+        mask[pixel * 4 + 1] = (int8_t)(pixel * layout->bpp + layout->g);
+        mask[pixel * 4 + 2] = (int8_t)(pixel * layout->bpp + layout->r);
+        mask[pixel * 4 + 3] = (int8_t)0x80;
+    }
+
+    return _mm_loadu_si128((const __m128i *)&mask[0]);
+}
+
+__attribute__((target("sse4.1"))) static uint32_t cuRTSPConvertRowsSse41(
+    const CUrtsp_rgb_layout *layout,
+    const uint8_t *src0,
+    const uint8_t *src1,
+    uint8_t *y0,
+    uint8_t *y1,
+    uint8_t *u,
+    uint8_t *v,
+    uint8_t *uv,
+    uint32_t x,
+    uint32_t width)
+{
+    const __m128i shuffle = cuRTSPConvertShuffle(layout);
+    const __m128i y_coeffs = _mm_setr_epi16(25, 129, 66, 0, 25, 129, 66, 0);
+    const __m128i u_coeffs = _mm_setr_epi16(112, -74, -38, 0, 112, -74, -38, 0);
+    const __m128i v_coeffs = _mm_setr_epi16(-18, -94, 112, 0, -18, -94, 112, 0);
+    const __m128i round = _mm_set1_epi32(128);
+    const __m128i y_offset = _mm_set1_epi32(16);
+    const __m128i two = _mm_set1_epi16(2);
+    const __m128i nv12_order = _mm_setr_epi8(0, 2, 1, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    __m128i row0;
+    __m128i row1;
+    __m128i lo0;
+    __m128i hi0;
+    __m128i lo1;
+    __m128i hi1;
+    __m128i luma;
+    __m128i lo;
+    __m128i hi;
+    __m128i chroma;
+    int packed;
+
+    // 16 byte loads stay inside the row, which ends a block early for 3 byte pixels
+    for (; (size_t)x * layout->bpp + 16 <= (size_t)width * layout->bpp; x += 4)
+    {
+        row0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src0 + x * layout->bpp)), shuffle);
+        row1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src1 + x * layout->bpp)), shuffle);
+        lo0 = _mm_cvtepu8_epi16(row0);
+        hi0 = _mm_cvtepu8_epi16(_mm_srli_si128(row0, 8));
+        lo1 = _mm_cvtepu8_epi16(row1);
+        hi1 = _mm_cvtepu8_epi16(_mm_srli_si128(row1, 8));
+
+        luma = _mm_hadd_epi32(_mm_madd_epi16(lo0, y_coeffs), _mm_madd_epi16(hi0, y_coeffs));
+        luma = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(luma, round), 8), y_offset);
+        luma = _mm_packus_epi16(_mm_packus_epi32(luma, luma), luma);
+        packed = _mm_cvtsi128_si32(luma);
+        memcpy(y0 + x, &packed, 4);
+        luma = _mm_hadd_epi32(_mm_madd_epi16(lo1, y_coeffs), _mm_madd_epi16(hi1, y_coeffs));
+        luma = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(luma, round), 8), y_offset);
+        luma = _mm_packus_epi16(_mm_packus_epi32(luma, luma), luma);
+        packed = _mm_cvtsi128_si32(luma);
+        memcpy(y1 + x, &packed, 4);
+
+        lo = _mm_add_epi16(lo0, lo1);
+        hi = _mm_add_epi16(hi0, hi1);
+        lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+        hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+        chroma = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), two), 2);
+        chroma = _mm_hadd_epi32(_mm_madd_epi16(chroma, u_coeffs), _mm_madd_epi16(chroma, v_coeffs));
+        chroma = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(chroma, round), 8), round);
+        chroma = _mm_packus_epi16(_mm_packus_epi32(chroma, chroma), chroma);
+        if (uv != NULL)
+        {
+            packed = _mm_cvtsi128_si32(_mm_shuffle_epi8(chroma, nv12_order));
+            memcpy(uv + x, &packed, 4);
+        }
+        else
+        {
+            packed = _mm_cvtsi128_si32(chroma);
+            memcpy(u + x / 2, &packed, 2);
+            memcpy(v + x / 2, (const uint8_t *)&packed + 2, 2);
+        }
+    }
+
+    return x;
+}
+
+__attribute__((target("avx2"))) static __m256i cuRTSPConvertLoad8(const uint8_t *src, const CUrtsp_rgb_layout *layout, __m256i shuffle)
+{
+    __m256i pixels;
+
+    pixels = _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)src));
+    pixels = _mm256_inserti128_si256(pixels, _mm_loadu_si128((const __m128i *)(src + 4 * layout->bpp)), 1);
+
+    return _mm256_shuffle_epi8(pixels, shuffle);
+}
+
+__attribute__((target("avx2"))) static uint32_t cuRTSPConvertRowsAvx2(
+    const CUrtsp_rgb_layout *layout,
+    const uint8_t *src0,
+    const uint8_t *src1,
+    uint8_t *y0,
+    uint8_t *y1,
+    uint8_t *u,
+    uint8_t *v,
+    uint8_t *uv,
+    uint32_t x,
+    uint32_t width)
+{
+    const __m256i shuffle = _mm256_broadcastsi128_si256(cuRTSPConvertShuffle(layout));
+    const __m256i y_coeffs = _mm256_setr_epi16(25, 129, 66, 0, 25, 129, 66, 0, 25, 129, 66, 0, 25, 129, 66, 0);
+    const __m256i u_coeffs = _mm256_setr_epi16(112, -74, -38, 0, 112, -74, -38, 0, 112, -74, -38, 0, 112, -74, -38, 0);
+    const __m256i v_coeffs = _mm256_setr_epi16(-18, -94, 112, 0, -18, -94, 112, 0, -18, -94, 112, 0, -18, -94, 112, 0);
+    const __m256i round = _mm256_set1_epi32(128);
+    const __m256i y_offset = _mm256_set1_epi32(16);
+    const __m256i two = _mm256_set1_epi16(2);
+    const __m256i chroma_order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    __m256i row0;
+    __m256i row1;
+    __m256i lo0;
+    __m256i hi0;
+    __m256i lo1;
+    __m256i hi1;
+    __m256i luma;
+    __m256i lo;
+    __m256i hi;
+    __m256i chroma;
+    int packed;
+
+    // each half of a row is loaded like the SSE path, so the same bound applies per half
+    for (; (size_t)x * layout->bpp + 4 * layout->bpp + 16 <= (size_t)width * layout->bpp; x += 8)
+    {
+        row0 = cuRTSPConvertLoad8(src0 + x * layout->bpp, layout, shuffle);
+        row1 = cuRTSPConvertLoad8(src1 + x * layout->bpp, layout, shuffle);
+        lo0 = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(row0));
+        hi0 = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(row0, 1));
+        lo1 = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(row1));
+        hi1 = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(row1, 1));
+
+        // in lane horizontal adds leave the pixels as 0 1 4 5 2 3 6 7
+        luma = _mm256_hadd_epi32(_mm256_madd_epi16(lo0, y_coeffs), _mm256_madd_epi16(hi0, y_coeffs));
+        luma = _mm256_permute4x64_epi64(luma, 0xD8);
+        luma = _mm256_add_epi32(_mm256_srai_epi32(_mm256_add_epi32(luma, round), 8), y_offset);
+        luma = _mm256_packus_epi16(_mm256_packus_epi32(luma, luma), luma);
+        packed = _mm256_extract_epi32(luma, 0);
+        memcpy(y0 + x, &packed, 4);
+        packed = _mm256_extract_epi32(luma, 4);
+        memcpy(y0 + x + 4, &packed, 4);
+        luma = _mm256_hadd_epi32(_mm256_madd_epi16(lo1, y_coeffs), _mm256_madd_epi16(hi1, y_coeffs));
+        luma = _mm256_permute4x64_epi64(luma, 0xD8);
+        luma = _mm256_add_epi32(_mm256_srai_epi32(_mm256_add_epi32(luma, round), 8), y_offset);
+        luma = _mm256_packus_epi16(_mm256_packus_epi32(luma, luma), luma);
+        packed = _mm256_extract_epi32(luma, 0);
+        memcpy(y1 + x, &packed, 4);
+        packed = _mm256_extract_epi32(luma, 4);
+        memcpy(y1 + x + 4, &packed, 4);
+
+        // blocks end up as 0 2 in the low lane and 1 3 in the high lane
+        lo = _mm256_add_epi16(lo0, lo1);
+        hi = _mm256_add_epi16(hi0, hi1);
+        lo = _mm256_add_epi16(lo, _mm256_srli_si256(lo, 8));
+        hi = _mm256_add_epi16(hi, _mm256_srli_si256(hi, 8));
+        chroma = _mm256_srli_epi16(_mm256_add_epi16(_mm256_unpacklo_epi64(lo, hi), two), 2);
+        chroma = _mm256_hadd_epi32(_mm256_madd_epi16(chroma, u_coeffs), _mm256_madd_epi16(chroma, v_coeffs));
+        chroma = _mm256_permutevar8x32_epi32(chroma, chroma_order);
+        chroma = _mm256_add_epi32(_mm256_srai_epi32(_mm256_add_epi32(chroma, round), 8), round);
+        chroma = _mm256_packus_epi16(_mm256_packus_epi32(chroma, chroma), chroma);
+        if (uv != NULL)
+        {
+            _mm_storel_epi64(
+                (__m128i *)(uv + x),
+                _mm_unpacklo_epi8(_mm256_castsi256_si128(chroma), _mm256_extracti128_si256(chroma, 1)));
+        }
+        else
+        {
+            packed = _mm256_extract_epi32(chroma, 0);
+            memcpy(u + x / 2, &packed, 4);
+            packed = _mm256_extract_epi32(chroma, 4);
+            memcpy(v + x / 2, &packed, 4);
+        }
+    }
+
+    return x;
+}
+
+__attribute__((target("avx512bw"))) static __m512i cuRTSPConvertLoad16(const uint8_t *src, const CUrtsp_rgb_layout *layout, __m512i shuffle)
+{
+    __m512i pixels;
+
+    pixels = _mm512_castsi128_si512(_mm_loadu_si128((const __m128i *)src));
+    pixels = _mm512_inserti32x4(pixels, _mm_loadu_si128((const __m128i *)(src + 4 * layout->bpp)), 1);
+    pixels = _mm512_inserti32x4(pixels, _mm_loadu_si128((const __m128i *)(src + 8 * layout->bpp)), 2);
+    pixels = _mm512_inserti32x4(pixels, _mm_loadu_si128((const __m128i *)(src + 12 * layout->bpp)), 3);
+
+    return _mm512_shuffle_epi8(pixels, shuffle);
+}
+
+// one weighted sum per pixel in the low byte of each 64 bit lane, luma and chroma stay within a byte
+__attribute__((target("avx512bw"))) static __m128i cuRTSPConvertWeigh8(__m512i pixels, __m512i coeffs, __m512i round, __m512i offset)
+{
+    __m512i sum;
+
+    sum = _mm512_madd_epi16(pixels, coeffs);
+    sum = _mm512_add_epi32(sum, _mm512_srli_epi64(sum, 32));
+    sum = _mm512_add_epi32(_mm512_srai_epi32(_mm512_add_epi32(sum, round), 8), offset);
+
+    return _mm512_cvtepi64_epi8(sum);
+}
+
+__attribute__((target("avx512bw"))) static uint32_t cuRTSPConvertRowsAvx512(
+    const CUrtsp_rgb_layout *layout,
+    const uint8_t *src0,
+    const uint8_t *src1,
+    uint8_t *y0,
+    uint8_t *y1,
+    uint8_t *u,
+    uint8_t *v,
+    uint8_t *uv,
+    uint32_t x,
+    uint32_t width)
+{
+    const __m512i shuffle = _mm512_broadcast_i32x4(cuRTSPConvertShuffle(layout));
+    const __m512i y_coeffs = _mm512_broadcast_i32x4(_mm_setr_epi16(25, 129, 66, 0, 25, 129, 66, 0));
+    const __m512i u_coeffs = _mm512_broadcast_i32x4(_mm_setr_epi16(112, -74, -38, 0, 112, -74, -38, 0));
+    const __m512i v_coeffs = _mm512_broadcast_i32x4(_mm_setr_epi16(-18, -94, 112, 0, -18, -94, 112, 0));
+    const __m512i round = _mm512_set1_epi32(128);
+    const __m512i y_offset = _mm512_set1_epi32(16);
+    const __m512i two = _mm512_set1_epi16(2);
+    const __m512i blocks_order = _mm512_setr_epi64(0, 2, 4, 6, 8, 10, 12, 14);
+    __m512i row0;
+    __m512i row1;
+    __m512i lo0;
+    __m512i hi0;
+    __m512i lo1;
+    __m512i hi1;
+    __m512i lo;
+    __m512i hi;
+    __m512i blocks;
+    __m128i cb;
+    __m128i cr;
+
+    for (; (size_t)x * layout->bpp + 12 * layout->bpp + 16 <= (size_t)width * layout->bpp; x += 16)
+    {
+        row0 = cuRTSPConvertLoad16(src0 + x * layout->bpp, layout, shuffle);
+        row1 = cuRTSPConvertLoad16(src1 + x * layout->bpp, layout, shuffle);
+        lo0 = _mm512_cvtepu8_epi16(_mm512_castsi512_si256(row0));
+        hi0 = _mm512_cvtepu8_epi16(_mm512_extracti64x4_epi64(row0, 1));
+        lo1 = _mm512_cvtepu8_epi16(_mm512_castsi512_si256(row1));
+        hi1 = _mm512_cvtepu8_epi16(_mm512_extracti64x4_epi64(row1, 1));
+
+        _mm_storeu_si128((__m128i *)(y0 + x), _mm_unpacklo_epi64(cuRTSPConvertWeigh8(lo0, y_coeffs, round, y_offset), cuRTSPConvertWeigh8(hi0, y_coeffs, round, y_offset)));
+        _mm_storeu_si128((__m128i *)(y1 + x), _mm_unpacklo_epi64(cuRTSPConvertWeigh8(lo1, y_coeffs, round, y_offset), cuRTSPConvertWeigh8(hi1, y_coeffs, round, y_offset)));
+
+        // a 128 bit lane holds the two pixels of a block, its sum lands in the low half
+        lo = _mm512_add_epi16(lo0, lo1);
+        hi = _mm512_add_epi16(hi0, hi1);
+        lo = _mm512_add_epi16(lo, _mm512_bsrli_epi128(lo, 8));
+        hi = _mm512_add_epi16(hi, _mm512_bsrli_epi128(hi, 8));
+        blocks = _mm512_srli_epi16(_mm512_add_epi16(_mm512_permutex2var_epi64(lo, blocks_order, hi), two), 2);
+        cb = cuRTSPConvertWeigh8(blocks, u_coeffs, round, round);
+        cr = cuRTSPConvertWeigh8(blocks, v_coeffs, round, round);
+        if (uv != NULL)
+        {
+            _mm_storeu_si128((__m128i *)(uv + x), _mm_unpacklo_epi8(cb, cr));
+        }
+        else
+        {
+            _mm_storel_epi64((__m128i *)(u + x / 2), cb);
+            _mm_storel_epi64((__m128i *)(v + x / 2), cr);
+        }
+    }
+
+    return x;
+}
+#endif
+
+static void cuRTSPConvertYuv(const CUrtsp_image *pSrc, const CUrtsp_image *pDst)
+{
+    const CUrtsp_relayout *relayout;
+    const uint8_t *src0;
+    const uint8_t *src1;
+    const uint8_t *u0;
+    const uint8_t *u1;
+    const uint8_t *v0;
+    const uint8_t *v1;
+    uint8_t *y0;
+    uint8_t *y1;
+    uint8_t *u;
+    uint8_t *v;
+    uint8_t *uv;
+    uint32_t row;
+    uint32_t row1;
+    uint32_t x;
+
+    relayout = cuRTSPConvertSelect()->relayout;
+    switch (pSrc->format)
+    {
+    case CU_RTSP_FORMAT_NV12:
+    case CU_RTSP_FORMAT_I420:
+    case CU_RTSP_FORMAT_YV12:
+        cuRTSPConvertYuv420(relayout, pSrc, pDst);
+        return;
+    case CU_RTSP_FORMAT_Y444:
+    case CU_RTSP_FORMAT_VUYA:
+        break;
+    default:
+        cuRTSPConvertYuvGeneric(pSrc, pDst);
+        return;
+    }
+
+    u = NULL;
+    v = NULL;
+    uv = NULL;
+    for (row = 0; row < pSrc->height; row += 2)
+    {
+        row1 = (row + 1 < pSrc->height) ? row + 1 : row;
+        y0 = pDst->planes[0] + row * pDst->pitches[0];
+        y1 = pDst->planes[0] + row1 * pDst->pitches[0];
+        if (pDst->format == CU_RTSP_FORMAT_NV12)
+        {
+            uv = pDst->planes[1] + (row / 2) * pDst->pitches[1];
+        }
+        else
+        {
+            u = pDst->planes[1] + (row / 2) * pDst->pitches[1];
+            v = pDst->planes[2] + (row / 2) * pDst->pitches[2];
+        }
+        if (pSrc->format == CU_RTSP_FORMAT_VUYA)
+        {
+            src0 = pSrc->planes[0] + row * pSrc->pitches[0];
+            src1 = pSrc->planes[0] + row1 * pSrc->pitches[0];
+            x = relayout->vuya_luma(src0, y0, 0, pSrc->width);
+            cuRTSPVuyaLumaScalar(src0, y0, x, pSrc->width);
+            x = relayout->vuya_luma(src1, y1, 0, pSrc->width);
+            cuRTSPVuyaLumaScalar(src1, y1, x, pSrc->width);
+            x = relayout->vuya_chroma(src0, src1, u, v, uv, 0, pSrc->width);
+            cuRTSPVuyaChromaScalar(src0, src1, u, v, uv, x, pSrc->width);
+        }
+        else
+        {
+            memcpy(y0, pSrc->planes[0] + row * pSrc->pitches[0], pSrc->width);
+            memcpy(y1, pSrc->planes[0] + row1 * pSrc->pitches[0], pSrc->width);
+            u0 = pSrc->planes[1] + row * pSrc->pitches[1];
+            u1 = pSrc->planes[1] + row1 * pSrc->pitches[1];
+            v0 = pSrc->planes[2] + row * pSrc->pitches[2];
+            v1 = pSrc->planes[2] + row1 * pSrc->pitches[2];
+            x = relayout->average(u0, u1, v0, v1, u, v, uv, 0, pSrc->width);
+            cuRTSPAverageScalar(u0, u1, v0, v1, u, v, uv, x, pSrc->width);
+        }
+    }
+}
+
+static void cuRTSPConvertYuv420(const CUrtsp_relayout *relayout, const CUrtsp_image *pSrc, const CUrtsp_image *pDst)
+{
+    const uint8_t *src_u;
+    const uint8_t *src_v;
+    const uint8_t *src_uv;
+    uint8_t *u;
+    uint8_t *v;
+    uint8_t *uv;
+    uint32_t count;
+    uint32_t row;
+    uint32_t x;
+
+    for (row = 0; row < pSrc->height; row++)
+    {
+        memcpy(pDst->planes[0] + row * pDst->pitches[0], pSrc->planes[0] + row * pSrc->pitches[0], pSrc->width);
+    }
+
+    count = (pSrc->width + 1) / 2;
+    for (row = 0; row < (pSrc->height + 1) / 2; row++)
+    {
+        u = pDst->planes[1] + row * pDst->pitches[1];
+        v = (pDst->format == CU_RTSP_FORMAT_NV12) ? NULL : pDst->planes[2] + row * pDst->pitches[2];
+        uv = u;
+        if (pSrc->format == CU_RTSP_FORMAT_NV12)
+        {
+            src_uv = pSrc->planes[1] + row * pSrc->pitches[1];
+            if (pDst->format == CU_RTSP_FORMAT_NV12)
+            {
+                memcpy(uv, src_uv, (size_t)count * 2);
+            }
+            else
+            {
+                x = relayout->deinterleave(src_uv, u, v, 0, count);
+                cuRTSPDeinterleaveScalar(src_uv, u, v, x, count);
+            }
+            continue;
+        }
+
+        src_u = pSrc->planes[(pSrc->format == CU_RTSP_FORMAT_I420) ? 1 : 2] + row * pSrc->pitches[(pSrc->format == CU_RTSP_FORMAT_I420) ? 1 : 2];
+        src_v = pSrc->planes[(pSrc->format == CU_RTSP_FORMAT_I420) ? 2 : 1] + row * pSrc->pitches[(pSrc->format == CU_RTSP_FORMAT_I420) ? 2 : 1];
+        if (pDst->format == CU_RTSP_FORMAT_NV12)
+        {
+            x = relayout->interleave(src_u, src_v, uv, 0, count);
+            cuRTSPInterleaveScalar(src_u, src_v, uv, x, count);
+        }
+        else
+        {
+            memcpy(u, src_u, count);
+            memcpy(v, src_v, count);
+        }
+    }
+}
+
+static uint32_t cuRTSPInterleaveScalar(const uint8_t *u, const uint8_t *v, uint8_t *uv, uint32_t x, uint32_t count)
+{
+    for (; x < count; x++)
+    {
+        uv[x * 2] = u[x];
+        uv[x * 2 + 1] = v[x];
+    }
+
+    return x;
+}
+
+static uint32_t cuRTSPDeinterleaveScalar(const uint8_t *uv, uint8_t *u, uint8_t *v, uint32_t x, uint32_t count)
+{
+    for (; x < count; x++)
+    {
+        u[x] = uv[x * 2];
+        v[x] = uv[x * 2 + 1];
+    }
+
+    return x;
+}
+
+static uint32_t cuRTSPAverageScalar(const uint8_t *u0, const uint8_t *u1, const uint8_t *v0, const uint8_t *v1, uint8_t *u, uint8_t *v, uint8_t *uv, uint32_t x, uint32_t width)
+{
+    uint32_t x1;
+    int cb;
+    int cr;
+
+    for (; x < width; x += 2)
+    {
+        x1 = (x + 1 < width) ? x + 1 : x;
+        cb = (u0[x] + u0[x1] + u1[x] + u1[x1] + 2) >> 2;
+        cr = (v0[x] + v0[x1] + v1[x] + v1[x1] + 2) >> 2;
+        if (uv != NULL)
+        {
+            uv[x] = (uint8_t)cb;
+            uv[x + 1] = (uint8_t)cr;
+        }
+        else
+        {
+            u[x / 2] = (uint8_t)cb;
+            v[x / 2] = (uint8_t)cr;
+        }
+    }
+
+    return x;
+}
+
+static uint32_t cuRTSPVuyaLumaScalar(const uint8_t *src, uint8_t *y, uint32_t x, uint32_t width)
+{
+    for (; x < width; x++)
+    {
+        y[x] = src[x * 4 + 2];
+    }
+
+    return x;
+}
+
+static uint32_t cuRTSPVuyaChromaScalar(const uint8_t *src0, const uint8_t *src1, uint8_t *u, uint8_t *v, uint8_t *uv, uint32_t x, uint32_t width)
+{
+    uint32_t x1;
+    int cb;
+    int cr;
+
+    for (; x < width; x += 2)
+    {
+        x1 = (x + 1 < width) ? x + 1 : x;
+        cb = (src0[x * 4 + 1] + src0[x1 * 4 + 1] + src1[x * 4 + 1] + src1[x1 * 4 + 1] + 2) >> 2;
+        cr = (src0[x * 4] + src0[x1 * 4] + src1[x * 4] + src1[x1 * 4] + 2) >> 2;
+        if (uv != NULL)
+        {
+            uv[x] = (uint8_t)cb;
+            uv[x + 1] = (uint8_t)cr;
+        }
+        else
+        {
+            u[x / 2] = (uint8_t)cb;
+            v[x / 2] = (uint8_t)cr;
+        }
+    }
+
+    return x;
+}
+
+#ifdef CU_RTSP_CONVERT_X86
+__attribute__((target("sse4.1"))) static uint32_t cuRTSPInterleaveSse41(const uint8_t *u, const uint8_t *v, uint8_t *uv, uint32_t x, uint32_t count)
+{
+    __m128i cb;
+    __m128i cr;
+
+    for (; x + 16 <= count; x += 16)
+    {
+        cb = _mm_loadu_si128((const __m128i *)(u + x));
+        cr = _mm_loadu_si128((const __m128i *)(v + x));
+        _mm_storeu_si128((__m128i *)(uv + x * 2), _mm_unpacklo_epi8(cb, cr));
+        _mm_storeu_si128((__m128i *)(uv + x * 2 + 16), _mm_unpackhi_epi8(cb, cr));
+    }
+
+    return x;
+}
+
+__attribute__((target("sse4.1"))) static uint32_t cuRTSPDeinterleaveSse41(const uint8_t *uv, uint8_t *u, uint8_t *v, uint32_t x, uint32_t count)
+{
+    const __m128i split = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+    __m128i lo;
+    __m128i hi;
+
+    for (; x + 16 <= count; x += 16)
+    {
+        lo = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(uv + x * 2)), split);
+        hi = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(uv + x * 2 + 16)), split);
+        _mm_storeu_si128((__m128i *)(u + x), _mm_unpacklo_epi64(lo, hi));
+        _mm_storeu_si128((__m128i *)(v + x), _mm_unpackhi_epi64(lo, hi));
+    }
+
+    return x;
+}
+
+// rounded average of the 2x2 blocks of 32 columns, sums stay in 16 bit lanes
+__attribute__((target("sse4.1"))) static __m128i cuRTSPAverage16(const uint8_t *row0, const uint8_t *row1)
+{
+    const __m128i ones = _mm_set1_epi8(1);
+    const __m128i two = _mm_set1_epi16(2);
+    __m128i lo;
+    __m128i hi;
+
+    lo = _mm_add_epi16(
+        _mm_maddubs_epi16(_mm_loadu_si128((const __m128i *)row0), ones),
+        _mm_maddubs_epi16(_mm_loadu_si128((const __m128i *)row1), ones));
+    hi = _mm_add_epi16(
+        _mm_maddubs_epi16(_mm_loadu_si128((const __m128i *)(row0 + 16)), ones),
+        _mm_maddubs_epi16(_mm_loadu_si128((const __m128i *)(row1 + 16)), ones));
+
+    return _mm_packus_epi16(_mm_srli_epi16(_mm_add_epi16(lo, two), 2), _mm_srli_epi16(_mm_add_epi16(hi, two), 2));
+}
+
+__attribute__((target("sse4.1"))) static uint32_t cuRTSPAverageSse41(const uint8_t *u0, const uint8_t *u1, const uint8_t *v0, const uint8_t *v1, uint8_t *u, uint8_t *v, uint8_t *uv, uint32_t x, uint32_t width)
+{
+    __m128i cb;
+    __m128i cr;
+
+    for (; x + 32 <= width; x += 32)
+    {
+        cb = cuRTSPAverage16(u0 + x, u1 + x);
+        cr = cuRTSPAverage16(v0 + x, v1 + x);
+        if (uv != NULL)
+        {
+            _mm_storeu_si128((__m128i *)(uv + x), _mm_unpacklo_epi8(cb, cr));
+            _mm_storeu_si128((__m128i *)(uv + x + 16), _mm_unpackhi_epi8(cb, cr));
+        }
+        else
+        {
+            _mm_storeu_si128((__m128i *)(u + x / 2), cb);
+            _mm_storeu_si128((__m128i *)(v + x / 2), cr);
+        }
+    }
+
+    return x;
+}
+
+// byte at offset of 16 consecutive VUYA pixels
+__attribute__((target("sse4.1"))) static inline __m128i cuRTSPVuyaGather(const uint8_t *src, int offset)
+{
+    const __m128i mask = _mm_setr_epi8(offset, offset + 4, offset + 8, offset + 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    __m128i lo;
+    __m128i hi;
+
+    lo = _mm_unpacklo_epi32(
+        _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)src), mask),
+        _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + 16)), mask));
+    hi = _mm_unpacklo_epi32(
+        _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + 32)), mask),
+        _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + 48)), mask));
+
+    return _mm_unpacklo_epi64(lo, hi);
+}
+
+__attribute__((target("sse4.1"))) static uint32_t cuRTSPVuyaLumaSse41(const uint8_t *src, uint8_t *y, uint32_t x, uint32_t width)
+{
+    for (; x + 16 <= width; x += 16)
+    {
+        _mm_storeu_si128((__m128i *)(y + x), cuRTSPVuyaGather(src + x * 4, 2));
+    }
+
+    return x;
+}
+
+__attribute__((target("sse4.1"))) static uint32_t cuRTSPVuyaChromaSse41(const uint8_t *src0, const uint8_t *src1, uint8_t *u, uint8_t *v, uint8_t *uv, uint32_t x, uint32_t width)
+{
+    const __m128i ones = _mm_set1_epi8(1);
+    const __m128i two = _mm_set1_epi16(2);
+    __m128i cb;
+    __m128i cr;
+
+    for (; x + 16 <= width; x += 16)
+    {
+        cb = _mm_add_epi16(_mm_maddubs_epi16(cuRTSPVuyaGather(src0 + x * 4, 1), ones), _mm_maddubs_epi16(cuRTSPVuyaGather(src1 + x * 4, 1), ones));
+        cr = _mm_add_epi16(_mm_maddubs_epi16(cuRTSPVuyaGather(src0 + x * 4, 0), ones), _mm_maddubs_epi16(cuRTSPVuyaGather(src1 + x * 4, 0), ones));
+        cb = _mm_packus_epi16(_mm_srli_epi16(_mm_add_epi16(cb, two), 2), cb);
+        cr = _mm_packus_epi16(_mm_srli_epi16(_mm_add_epi16(cr, two), 2), cr);
+        if (uv != NULL)
+        {
+            _mm_storeu_si128((__m128i *)(uv + x), _mm_unpacklo_epi8(cb, cr));
+        }
+        else
+        {
+            _mm_storel_epi64((__m128i *)(u + x / 2), cb);
+            _mm_storel_epi64((__m128i *)(v + x / 2), cr);
+        }
+    }
+
+    return x;
+}
+#endif
+
+static void cuRTSPConvertYuvGeneric(const CUrtsp_image *pSrc, const CUrtsp_image *pDst)
+{
+    CUrtsp_yuv_component luma;
+    CUrtsp_yuv_component u;
+    CUrtsp_yuv_component v;
+    const uint8_t *src;
+    const uint8_t *u0;
+    const uint8_t *u1;
+    const uint8_t *v0;
+    const uint8_t *v1;
+    uint8_t *dst;
+    uint32_t x;
+    uint32_t y;
+    uint32_t x1;
+    uint32_t y1;
+    size_t ux;
+    size_t ux1;
+    size_t vx;
+    size_t vx1;
+    int cb;
+    int cr;
+
+    cuRTSPConvertComponents(pSrc, &luma, &u, &v);
+
+    for (y = 0; y < pSrc->height; y++)
+    {
+        src = luma.plane + y * luma.pitch;
+        dst = pDst->planes[0] + y * pDst->pitches[0];
+        for (x = 0; x < pSrc->width; x++)
+        {
+            dst[x] = src[x * luma.step];
+        }
+    }
+
+    for (y = 0; y < pSrc->height; y += 2)
+    {
+        y1 = (y + 1 < pSrc->height) ? y + 1 : y;
+        u0 = u.plane + (y >> u.shift_y) * u.pitch;
+        u1 = u.plane + (y1 >> u.shift_y) * u.pitch;
+        v0 = v.plane + (y >> v.shift_y) * v.pitch;
+        v1 = v.plane + (y1 >> v.shift_y) * v.pitch;
+        for (x = 0; x < pSrc->width; x += 2)
+        {
+            x1 = (x + 1 < pSrc->width) ? x + 1 : x;
+            // subsampled sources read the same chroma for all four samples
+            ux = (x >> u.shift_x) * u.step;
+            ux1 = (x1 >> u.shift_x) * u.step;
+            vx = (x >> v.shift_x) * v.step;
+            vx1 = (x1 >> v.shift_x) * v.step;
+            cb = (u0[ux] + u0[ux1] + u1[ux] + u1[ux1] + 2) >> 2;
+            cr = (v0[vx] + v0[vx1] + v1[vx] + v1[vx1] + 2) >> 2;
+            if (pDst->format == CU_RTSP_FORMAT_NV12)
+            {
+                pDst->planes[1][(y / 2) * pDst->pitches[1] + x] = (uint8_t)cb;
+                pDst->planes[1][(y / 2) * pDst->pitches[1] + x + 1] = (uint8_t)cr;
+            }
+            else
+            {
+                pDst->planes[1][(y / 2) * pDst->pitches[1] + x / 2] = (uint8_t)cb;
+                pDst->planes[2][(y / 2) * pDst->pitches[2] + x / 2] = (uint8_t)cr;
+            }
+        }
+    }
+}
+
+static void cuRTSPConvertComponents(const CUrtsp_image *pSrc, CUrtsp_yuv_component *pY, CUrtsp_yuv_component *pU, CUrtsp_yuv_component *pV)
+{
+    // a zero step and pitch read the same black sample everywhere
+    static const uint8_t BLACK[] = {16, 128};
+
+    switch (pSrc->format)
+    {
+    case CU_RTSP_FORMAT_NV12:
+        cuRTSPConvertComponent(pY, pSrc->planes[0], pSrc->pitches[0], 1, 0);
+        cuRTSPConvertComponent(pU, pSrc->planes[1], pSrc->pitches[1], 2, 1);
+        cuRTSPConvertComponent(pV, pSrc->planes[1] + 1, pSrc->pitches[1], 2, 1);
+        break;
+    case CU_RTSP_FORMAT_I420:
+        cuRTSPConvertComponent(pY, pSrc->planes[0], pSrc->pitches[0], 1, 0);
+        cuRTSPConvertComponent(pU, pSrc->planes[1], pSrc->pitches[1], 1, 1);
+        cuRTSPConvertComponent(pV, pSrc->planes[2], pSrc->pitches[2], 1, 1);
+        break;
+    case CU_RTSP_FORMAT_YV12:
+        cuRTSPConvertComponent(pY, pSrc->planes[0], pSrc->pitches[0], 1, 0);
+        cuRTSPConvertComponent(pV, pSrc->planes[1], pSrc->pitches[1], 1, 1);
+        cuRTSPConvertComponent(pU, pSrc->planes[2], pSrc->pitches[2], 1, 1);
+        break;
+    case CU_RTSP_FORMAT_Y444:
+        cuRTSPConvertComponent(pY, pSrc->planes[0], pSrc->pitches[0], 1, 0);
+        cuRTSPConvertComponent(pU, pSrc->planes[1], pSrc->pitches[1], 1, 0);
+        cuRTSPConvertComponent(pV, pSrc->planes[2], pSrc->pitches[2], 1, 0);
+        break;
+    case CU_RTSP_FORMAT_VUYA:
+        cuRTSPConvertComponent(pY, pSrc->planes[0] + 2, pSrc->pitches[0], 4, 0);
+        cuRTSPConvertComponent(pU, pSrc->planes[0] + 1, pSrc->pitches[0], 4, 0);
+        cuRTSPConvertComponent(pV, pSrc->planes[0], pSrc->pitches[0], 4, 0);
+        break;
+    default:
+        cuRTSPConvertComponent(pY, &BLACK[0], 0, 0, 0);
+        cuRTSPConvertComponent(pU, &BLACK[1], 0, 0, 0);
+        cuRTSPConvertComponent(pV, &BLACK[1], 0, 0, 0);
+        break;
+    }
+}
+
+static void cuRTSPConvertComponent(CUrtsp_yuv_component *pComponent, const uint8_t *plane, size_t pitch, uint8_t step, uint8_t shift)
+{
+    pComponent->plane = plane;
+    pComponent->pitch = pitch;
+    pComponent->step = step;
+    pComponent->shift_x = shift;
+    pComponent->shift_y = shift;
+}
@@ -0,0 +1,40 @@
+#ifndef CUDA_RTSP_CONVERT_H
+#define CUDA_RTSP_CONVERT_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+#include "cuda_rtsp.h"
+
+    // a frame in system memory, planes and pitches follow the layout of its format
+    typedef struct CUrtsp_image_st
+    {
+        CUrtsp_format format;
+        uint32_t width;
+        uint32_t height;
+        uint8_t *planes[CU_RTSP_MAX_PLANES];
+        size_t pitches[CU_RTSP_MAX_PLANES];
+    } CUrtsp_image;
+
+    // only NV12 and I420, the formats encoders read natively, are destinations
+    bool cuRTSPConvertSupported(CUrtsp_format src, CUrtsp_format dst);
+
+    // BT.601 limited range, luma within 1 and chroma within 1.5 of the exact matrix on the rounded 2x2 mean,
+    // identical bytes on every instruction set
+    void cuRTSPConvertFrame(const CUrtsp_image *pSrc, const CUrtsp_image *pDst);
+
+    // name of the row converter picked for this CPU
+    const char *cuRTSPConvertIsa(void);
+
+    // picks a row converter by name for tests and benchmarks, false when it is unknown or this CPU lacks it
+    bool cuRTSPConvertForceIsa(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
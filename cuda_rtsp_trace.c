@@ -0,0 +1,204 @@
+#include "cuda_rtsp_trace.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include <glib.h>
+
+typedef struct CUrtsp_trace_event_st
+{
+    const char *name;
+    char phase;
+    uint32_t session;
+    uint32_t thread;
+    uint32_t media;
+    uint64_t frame;
+    uint64_t pts;
+    int64_t time;
+    int64_t duration;
+} CUrtsp_trace_event;
+
+// events are claimed with one atomic add and nothing is formatted until the trace ends,
+// writers in flight are counted so the buffer is never freed under them
+static CUrtsp_trace_event *TRACE_EVENTS = NULL;
+static size_t TRACE_CAPACITY = 0;
+static size_t TRACE_NEXT = 0;
+static int TRACE_ENABLED = 0;
+static int TRACE_WRITERS = 0;
+static FILE *TRACE_FILE = NULL;
+static GMutex TRACE_LOCK;
+
+static uint32_t TRACE_IDS = 0;
+static uint32_t TRACE_THREADS = 0;
+static __thread uint32_t TRACE_THREAD = 0;
+
+static CUrtsp_trace_event *cuRTSPTraceClaim(void);
+
+static void cuRTSPTraceCommit(void);
+
+static void cuRTSPTraceWrite(FILE *file, size_t count, size_t dropped);
+
+bool cuRTSPTraceEnabled(void)
+{
+    return __atomic_load_n(&TRACE_ENABLED, __ATOMIC_RELAXED) != 0;
+}
+
+uint32_t cuRTSPTraceId(void)
+{
+    return __atomic_add_fetch(&TRACE_IDS, 1, __ATOMIC_RELAXED);
+}
+
+bool cuRTSPTraceBegin(FILE *file, size_t capacity)
+{
+    bool result;
+
+    result = false;
+    g_mutex_lock(&TRACE_LOCK);
+    if (TRACE_FILE == NULL)
+    {
+        TRACE_FILE = file;
+        TRACE_CAPACITY = (capacity > 0) ? capacity : CU_RTSP_TRACE_DEFAULT_EVENTS;
+        TRACE_EVENTS = malloc(TRACE_CAPACITY * sizeof(CUrtsp_trace_event));
+        __atomic_store_n(&TRACE_NEXT, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&TRACE_ENABLED, 1, __ATOMIC_SEQ_CST);
+        result = true;
+    }
+    g_mutex_unlock(&TRACE_LOCK);
+
+    return result;
+}
+
+FILE *cuRTSPTraceEnd(void)
+{
+    FILE *file;
+    size_t next;
+
+    g_mutex_lock(&TRACE_LOCK);
+    file = TRACE_FILE;
+    if (file != NULL)
+    {
+        __atomic_store_n(&TRACE_ENABLED, 0, __ATOMIC_SEQ_CST);
+        // a writer either saw the trace stopped or is counted here
+        while (__atomic_load_n(&TRACE_WRITERS, __ATOMIC_SEQ_CST) > 0)
+        {
+            g_thread_yield();
+        }
+        next = __atomic_load_n(&TRACE_NEXT, __ATOMIC_ACQUIRE);
+        cuRTSPTraceWrite(file, MIN(next, TRACE_CAPACITY), (next > TRACE_CAPACITY) ? next - TRACE_CAPACITY : 0);
+        free(TRACE_EVENTS);
+        TRACE_EVENTS = NULL;
+        TRACE_CAPACITY = 0;
+        TRACE_FILE = NULL;
+    }
+    g_mutex_unlock(&TRACE_LOCK);
+
+    return file;
+}
+
+void cuRTSPTraceSpan(const char *name, uint32_t session, int64_t start, int64_t end)
+{
+    CUrtsp_trace_event *event;
+
+    event = cuRTSPTraceClaim();
+    if (event != NULL)
+    {
+        event->name = name;
+        event->phase = 'X';
+        event->session = session;
+        event->media = 0;
+        event->frame = 0;
+        event->pts = 0;
+        event->time = start;
+        event->duration = end - start;
+        cuRTSPTraceCommit();
+    }
+}
+
+void cuRTSPTraceFrame(const char *name, char phase, uint32_t session, uint32_t media, uint64_t frame, uint64_t pts, int64_t time)
+{
+    CUrtsp_trace_event *event;
+
+    event = cuRTSPTraceClaim();
+    if (event != NULL)
+    {
+        event->name = name;
+        event->phase = phase;
+        event->session = session;
+        event->media = media;
+        event->frame = frame;
+        event->pts = pts;
+        event->time = time;
+        event->duration = 0;
+        cuRTSPTraceCommit();
+    }
+}
+
+static CUrtsp_trace_event *cuRTSPTraceClaim(void)
+{
+    CUrtsp_trace_event *event;
+    size_t index;
+
+    event = NULL;
+    __atomic_add_fetch(&TRACE_WRITERS, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&TRACE_ENABLED, __ATOMIC_SEQ_CST))
+    {
+        index = __atomic_fetch_add(&TRACE_NEXT, 1, __ATOMIC_RELAXED);
+        if (index < TRACE_CAPACITY)
+        {
+            event = &TRACE_EVENTS[index];
+            if (TRACE_THREAD == 0)
+            {
+                TRACE_THREAD = __atomic_add_fetch(&TRACE_THREADS, 1, __ATOMIC_RELAXED);
+            }
+            event->thread = TRACE_THREAD;
+        }
+    }
+    if (event == NULL)
+    {
+        cuRTSPTraceCommit();
+    }
+
+    return event;
+}
+
+static void cuRTSPTraceCommit(void)
+{
+    __atomic_sub_fetch(&TRACE_WRITERS, 1, __ATOMIC_RELEASE);
+}
+
+static void cuRTSPTraceWrite(FILE *file, size_t count, size_t dropped)
+{
+    GHashTable *sessions;
+    const CUrtsp_trace_event *event;
+    const char *separator;
+    size_t index;
+
+    sessions = g_hash_table_new(g_direct_hash, g_direct_equal);
+    separator = "";
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":%zu},\"traceEvents\":[", dropped);
+    for (index = 0; index < count; index++)
+    {
+        event = &TRACE_EVENTS[index];
+        // each session is a process, its frames are async tracks keyed by media and frame
+        if (!g_hash_table_contains(sessions, GUINT_TO_POINTER(event->session)))
+        {
+            g_hash_table_add(sessions, GUINT_TO_POINTER(event->session));
+            fprintf(file, "%s\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%" PRIu32 ",\"args\":{\"name\":\"session %" PRIu32 "\"}}",
+                    separator, event->session, event->session);
+            separator = ",";
+        }
+        if (event->phase == 'X')
+        {
+            fprintf(file, "%s\n{\"name\":\"%s\",\"cat\":\"session\",\"ph\":\"X\",\"pid\":%" PRIu32 ",\"tid\":%" PRIu32 ",\"ts\":%" PRId64 ",\"dur\":%" PRId64 "}",
+                    separator, event->name, event->session, event->thread, event->time, event->duration);
+        }
+        else
+        {
+            fprintf(file, "%s\n{\"name\":\"%s\",\"cat\":\"frame\",\"ph\":\"%c\",\"pid\":%" PRIu32 ",\"tid\":%" PRIu32 ",\"id\":\"%" PRIu32 ":%" PRIu64 "\",\"ts\":%" PRId64 ",\"args\":{\"media\":%" PRIu32 ",\"frame\":%" PRIu64 ",\"pts\":%" PRIu64 "}}",
+                    separator, event->name, event->phase, event->session, event->thread, event->media, event->frame, event->time, event->media, event->frame, event->pts);
+        }
+        separator = ",";
+    }
+    fprintf(file, "\n]}\n");
+    g_hash_table_destroy(sessions);
+}
@@ -0,0 +1,40 @@
+#ifndef CUDA_RTSP_TRACE_H
+#define CUDA_RTSP_TRACE_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "cuda_rtsp.h"
+
+#define CU_RTSP_TRACE_DEFAULT_EVENTS (1 << 20)
+
+    // checked before a stage is timed, so a stopped trace costs one load
+    bool cuRTSPTraceEnabled(void);
+
+    // labels sessions and medias in the trace, unique for the life of the process
+    uint32_t cuRTSPTraceId(void);
+
+    // false while another trace is recording, events past capacity are counted and dropped
+    bool cuRTSPTraceBegin(FILE *file, size_t capacity);
+
+    // writes the events as Chrome trace JSON and hands back the file given to cuRTSPTraceBegin, NULL when none was recording
+    FILE *cuRTSPTraceEnd(void);
+
+    // names must outlive the trace, times are monotonic microseconds
+
+    // work on the calling thread that belongs to no single frame yet
+    void cuRTSPTraceSpan(const char *name, uint32_t session, int64_t start, int64_t end);
+
+    // a frame entering ('b') or leaving ('e') a stage, or passing a point ('n')
+    void cuRTSPTraceFrame(const char *name, char phase, uint32_t session, uint32_t media, uint64_t frame, uint64_t pts, int64_t time);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -107,9 +107,11 @@ void egl_application_render(struct egl_application *application)
     application->degrees = (application->degrees + 1) % 360;
 }
 
-void egl_application_copy_frame(struct egl_application *application, CUdeviceptr buffer, size_t size)
+bool egl_application_copy_frame(struct egl_application *application, CUdeviceptr buffer, size_t size)
 {
     EGLint stream_state;
+    bool copied;
+    copied = false;
     CUgraphicsResource graphics_resource;
     CUeglFrame egl_frame;
     assert(eglQueryStreamKHR(application->egl_display, application->egl_stream, EGL_STREAM_STATE_KHR, &stream_state) == EGL_TRUE);
@@ -130,5 +132,7 @@ void egl_application_copy_frame(struct egl_application *application, CUdeviceptr
         };
         cuMemcpy2D(&copy_info);
         assert(cuEGLStreamConsumerReleaseFrame(&application->cu_egl_stream_connection, graphics_resource, NULL) == CUDA_SUCCESS);
+        copied = true;
     }
+    return copied;
 }
\ No newline at end of file
@@ -27,4 +27,4 @@ void egl_application_free();
 
 void egl_application_render(struct egl_application *application);
 
-void egl_application_copy_frame(struct egl_application *application, CUdeviceptr buffer, size_t size);
+bool egl_application_copy_frame(struct egl_application *application, CUdeviceptr buffer, size_t size);
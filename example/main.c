@@ -3,7 +3,7 @@
 
 #include <sigfn.h>
 
-static void copy_frame(CUdeviceptr buffer, size_t size, void *user_data);
+static CUrtsp_frame_status copy_frame(CUdeviceptr buffer, size_t size, CUrtsp_rect *dirty, void *user_data);
 
 static void handle_signal(int signum, void *user_data);
 
@@ -35,7 +35,8 @@ int main(int argc, const char **argv)
         .fpsNum = 30,
         .fpsDen = 1,
         .live = true,
-        .writeCallback = copy_frame,
+        .idleIntervalMs = 1000,
+        .updateCallback = copy_frame,
         .userData = application,
     };
 
@@ -53,6 +54,8 @@ int main(int argc, const char **argv)
         egl_application_render(application);
     }
 
+    cuRTSPSessionDestroy(cu_session);
+
     cuRTSPServerDestroy(cu_server);
 
     cuRTSPDeinit();
@@ -60,10 +63,10 @@ int main(int argc, const char **argv)
     return 0;
 }
 
-void copy_frame(CUdeviceptr buffer, size_t size, void *user_data)
+CUrtsp_frame_status copy_frame(CUdeviceptr buffer, size_t size, CUrtsp_rect *dirty, void *user_data)
 {
     struct egl_application *const application = (struct egl_application *)user_data;
-    egl_application_copy_frame(application, buffer, size);
+    return egl_application_copy_frame(application, buffer, size) ? CU_RTSP_FRAME_NEW : CU_RTSP_FRAME_UNCHANGED;
 }
 
 void handle_signal(int signum, void *user_data)
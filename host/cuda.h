@@ -0,0 +1,137 @@
+#ifndef CUDA_RTSP_HOST_CUDA_H
+#define CUDA_RTSP_HOST_CUDA_H
+
+// Host-memory stand-in for the subset of the CUDA driver API used by
+// cuda_rtsp. Device pointers are plain host pointers and contexts only
+// exist to keep push/pop bookkeeping honest.
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CUDA_CB
+#define CU_RTSP_HOST_CUDA 1
+
+    typedef enum cudaError_enum
+    {
+        CUDA_SUCCESS = 0,
+        CUDA_ERROR_INVALID_VALUE = 1,
+        CUDA_ERROR_OUT_OF_MEMORY = 2,
+        CUDA_ERROR_NOT_INITIALIZED = 3,
+        CUDA_ERROR_NO_DEVICE = 100,
+        CUDA_ERROR_INVALID_DEVICE = 101,
+        CUDA_ERROR_INVALID_CONTEXT = 201,
+        CUDA_ERROR_INVALID_HANDLE = 400,
+        CUDA_ERROR_NOT_READY = 600,
+        CUDA_ERROR_NOT_SUPPORTED = 801,
+        CUDA_ERROR_UNKNOWN = 999,
+    } CUresult;
+
+    typedef int CUdevice;
+    typedef uintptr_t CUdeviceptr;
+    typedef struct CUctx_st *CUcontext;
+    typedef struct CUstream_st *CUstream;
+    typedef struct CUevent_st *CUevent;
+
+    typedef enum CUstream_flags_enum
+    {
+        CU_STREAM_DEFAULT = 0x0,
+        CU_STREAM_NON_BLOCKING = 0x1,
+    } CUstream_flags;
+
+    typedef enum CUevent_flags_enum
+    {
+        CU_EVENT_DEFAULT = 0x0,
+        CU_EVENT_BLOCKING_SYNC = 0x1,
+        CU_EVENT_DISABLE_TIMING = 0x2,
+    } CUevent_flags;
+
+    typedef enum CUmemorytype_enum
+    {
+        CU_MEMORYTYPE_HOST = 0x01,
+        CU_MEMORYTYPE_DEVICE = 0x02,
+        CU_MEMORYTYPE_ARRAY = 0x03,
+        CU_MEMORYTYPE_UNIFIED = 0x04,
+    } CUmemorytype;
+
+    typedef struct CUarray_st *CUarray;
+
+    typedef struct CUDA_MEMCPY2D_st
+    {
+        size_t srcXInBytes;
+        size_t srcY;
+        CUmemorytype srcMemoryType;
+        const void *srcHost;
+        CUdeviceptr srcDevice;
+        CUarray srcArray;
+        size_t srcPitch;
+        size_t dstXInBytes;
+        size_t dstY;
+        CUmemorytype dstMemoryType;
+        void *dstHost;
+        CUdeviceptr dstDevice;
+        CUarray dstArray;
+        size_t dstPitch;
+        size_t WidthInBytes;
+        size_t Height;
+    } CUDA_MEMCPY2D;
+
+    CUresult cuInit(unsigned int flags);
+
+    CUresult cuDeviceGet(CUdevice *device, int ordinal);
+
+    CUresult cuDeviceGetCount(int *count);
+
+    CUresult cuCtxCreate(CUcontext *pctx, unsigned int flags, CUdevice dev);
+
+    CUresult cuCtxDestroy(CUcontext ctx);
+
+    CUresult cuCtxPushCurrent(CUcontext ctx);
+
+    CUresult cuCtxPopCurrent(CUcontext *pctx);
+
+    CUresult cuCtxGetCurrent(CUcontext *pctx);
+
+    CUresult cuStreamCreate(CUstream *phStream, unsigned int Flags);
+
+    CUresult cuStreamDestroy(CUstream hStream);
+
+    CUresult cuStreamSynchronize(CUstream hStream);
+
+    CUresult cuEventCreate(CUevent *phEvent, unsigned int Flags);
+
+    CUresult cuEventDestroy(CUevent hEvent);
+
+    CUresult cuEventRecord(CUevent hEvent, CUstream hStream);
+
+    CUresult cuEventQuery(CUevent hEvent);
+
+    CUresult cuEventSynchronize(CUevent hEvent);
+
+    CUresult cuMemAlloc(CUdeviceptr *dptr, size_t bytesize);
+
+    CUresult cuMemFree(CUdeviceptr dptr);
+
+    CUresult cuMemcpy(CUdeviceptr dst, CUdeviceptr src, size_t ByteCount);
+
+    CUresult cuMemcpyHtoD(CUdeviceptr dstDevice, const void *srcHost, size_t ByteCount);
+
+    CUresult cuMemcpyDtoH(void *dstHost, CUdeviceptr srcDevice, size_t ByteCount);
+
+    CUresult cuMemcpy2D(const CUDA_MEMCPY2D *pCopy);
+
+    CUresult cuMemsetD8(CUdeviceptr dstDevice, unsigned char uc, size_t N);
+
+    CUresult cuMemsetD32(CUdeviceptr dstDevice, unsigned int ui, size_t N);
+
+    CUresult cuGetErrorString(CUresult error, const char **pStr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,469 @@
+#include "cuda.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CU_HOST_CONTEXT_STACK 16
+
+typedef struct CUctx_st
+{
+    CUdevice device;
+} CUctx_st;
+
+// work is synchronous, so streams only carry their flags
+typedef struct CUstream_st
+{
+    unsigned int flags;
+} CUstream_st;
+
+typedef struct CUevent_st
+{
+    unsigned int flags;
+    bool recorded;
+} CUevent_st;
+
+static bool initialized = false;
+
+// per-thread context stack mirroring the driver's behaviour
+static __thread CUcontext context_stack[CU_HOST_CONTEXT_STACK];
+static __thread int context_depth = 0;
+
+CUresult cuInit(unsigned int flags)
+{
+    CUresult result;
+
+    result = CUDA_SUCCESS;
+
+    if (flags != 0)
+    {
+        result = CUDA_ERROR_INVALID_VALUE;
+    }
+    else
+    {
+        initialized = true;
+    }
+
+    return result;
+}
+
+CUresult cuDeviceGet(CUdevice *device, int ordinal)
+{
+    CUresult result;
+
+    result = CUDA_SUCCESS;
+
+    if (!initialized)
+    {
+        result = CUDA_ERROR_NOT_INITIALIZED;
+    }
+    else if (device == NULL)
+    {
+        result = CUDA_ERROR_INVALID_VALUE;
+    }
+    else if (ordinal != 0)
+    {
+        result = CUDA_ERROR_INVALID_DEVICE;
+    }
+    else
+    {
+        *device = 0;
+    }
+
+    return result;
+}
+
+CUresult cuDeviceGetCount(int *count)
+{
+    CUresult result;
+
+    result = CUDA_SUCCESS;
+
+    if (!initialized)
+    {
+        result = CUDA_ERROR_NOT_INITIALIZED;
+    }
+    else if (count == NULL)
+    {
+        result = CUDA_ERROR_INVALID_VALUE;
+    }
+    else
+    {
+        *count = 1;
+    }
+
+    return result;
+}
+
+CUresult cuCtxCreate(CUcontext *pctx, unsigned int flags, CUdevice dev)
+{
+    CUresult result;
+
+    result = CUDA_SUCCESS;
+
+    if (pctx == NULL)
+    {
+        result = CUDA_ERROR_INVALID_VALUE;
+        goto done;
+    }
+
+    if (dev != 0)
+    {
+        result = CUDA_ERROR_INVALID_DEVICE;
+        goto done;
+    }
+
+    *pctx = calloc(1, sizeof(CUctx_st));
+    if (*pctx == NULL)
+    {
+        result = CUDA_ERROR_OUT_OF_MEMORY;
+        goto done;
+    }
+    (*pctx)->device = dev;
+
+    // like the driver, a new context becomes current on the calling thread
+    result = cuCtxPushCurrent(*pctx);
+done:
+    return result;
+}
+
+CUresult cuCtxDestroy(CUcontext ctx)
+{
+    int index;
+
+    if (ctx == NULL)
+    {
+        return CUDA_ERROR_INVALID_VALUE;
+    }
+
+    for (index = 0; index < context_depth; index++)
+    {
+        if (context_stack[index] == ctx)
+        {
+            context_stack[index] = NULL;
+        }
+    }
+    free(ctx);
+
+    return CUDA_SUCCESS;
+}
+
+CUresult cuCtxPushCurrent(CUcontext ctx)
+{
+    CUresult result;
+
+    result = CUDA_SUCCESS;
+
+    if (ctx == NULL)
+    {
+        result = CUDA_ERROR_INVALID_CONTEXT;
+    }
+    else if (context_depth >= CU_HOST_CONTEXT_STACK)
+    {
+        result = CUDA_ERROR_UNKNOWN;
+    }
+    else
+    {
+        context_stack[context_depth++] = ctx;
+    }
+
+    return result;
+}
+
+CUresult cuCtxPopCurrent(CUcontext *pctx)
+{
+    CUresult result;
+
+    result = CUDA_SUCCESS;
+
+    if (context_depth == 0)
+    {
+        result = CUDA_ERROR_INVALID_CONTEXT;
+    }
+    else
+    {
+        context_depth--;
+        if (pctx != NULL)
+        {
+            *pctx = context_stack[context_depth];
+        }
+    }
+
+    return result;
+}
+
+CUresult cuCtxGetCurrent(CUcontext *pctx)
+{
+    if (pctx == NULL)
+    {
+        return CUDA_ERROR_INVALID_VALUE;
+    }
+
+    *pctx = (context_depth > 0) ? context_stack[context_depth - 1] : NULL;
+
+    return CUDA_SUCCESS;
+}
+
+CUresult cuStreamCreate(CUstream *phStream, unsigned int Flags)
+{
+    if (phStream == NULL)
+    {
+        return CUDA_ERROR_INVALID_VALUE;
+    }
+
+    *phStream = calloc(1, sizeof(CUstream_st));
+    if (*phStream == NULL)
+    {
+        return CUDA_ERROR_OUT_OF_MEMORY;
+    }
+    (*phStream)->flags = Flags;
+
+    return CUDA_SUCCESS;
+}
+
+CUresult cuStreamDestroy(CUstream hStream)
+{
+    if (hStream == NULL)
+    {
+        return CUDA_ERROR_INVALID_HANDLE;
+    }
+
+    free(hStream);
+
+    return CUDA_SUCCESS;
+}
+
+CUresult cuStreamSynchronize(CUstream hStream)
+{
+    return CUDA_SUCCESS;
+}
+
+CUresult cuEventCreate(CUevent *phEvent, unsigned int Flags)
+{
+    if (phEvent == NULL)
+    {
+        return CUDA_ERROR_INVALID_VALUE;
+    }
+
+    *phEvent = calloc(1, sizeof(CUevent_st));
+    if (*phEvent == NULL)
+    {
+        return CUDA_ERROR_OUT_OF_MEMORY;
+    }
+    (*phEvent)->flags = Flags;
+
+    return CUDA_SUCCESS;
+}
+
+CUresult cuEventDestroy(CUevent hEvent)
+{
+    if (hEvent == NULL)
+    {
+        return CUDA_ERROR_INVALID_HANDLE;
+    }
+
+    free(hEvent);
+
+    return CUDA_SUCCESS;
+}
+
+CUresult cuEventRecord(CUevent hEvent, CUstream hStream)
+{
+    if (hEvent == NULL)
+    {
+        return CUDA_ERROR_INVALID_HANDLE;
+    }
+
+    // everything queued on the stream has already run
+    hEvent->recorded = true;
+
+    return CUDA_SUCCESS;
+}
+
+CUresult cuEventQuery(CUevent hEvent)
+{
+    if (hEvent == NULL)
+    {
+        return CUDA_ERROR_INVALID_HANDLE;
+    }
+
+    return CUDA_SUCCESS;
+}
+
+CUresult cuEventSynchronize(CUevent hEvent)
+{
+    if (hEvent == NULL)
+    {
+        return CUDA_ERROR_INVALID_HANDLE;
+    }
+
+    return CUDA_SUCCESS;
+}
+
+CUresult cuMemAlloc(CUdeviceptr *dptr, size_t bytesize)
+{
+    void *data;
+
+    if (dptr == NULL || bytesize == 0)
+    {
+        return CUDA_ERROR_INVALID_VALUE;
+    }
+
+    data = malloc(bytesize);
+    if (data == NULL)
+    {
+        return CUDA_ERROR_OUT_OF_MEMORY;
+    }
+    *dptr = (CUdeviceptr)data;
+
+    return CUDA_SUCCESS;
+}
+
+CUresult cuMemFree(CUdeviceptr dptr)
+{
+    free((void *)dptr);
+    return CUDA_SUCCESS;
+}
+
+CUresult cuMemcpy(CUdeviceptr dst, CUdeviceptr src, size_t ByteCount)
+{
+    if ((dst == 0 || src == 0) && ByteCount > 0)
+    {
+        return CUDA_ERROR_INVALID_VALUE;
+    }
+
+    memmove((void *)dst, (const void *)src, ByteCount);
+
+    return CUDA_SUCCESS;
+}
+
+CUresult cuMemcpyHtoD(CUdeviceptr dstDevice, const void *srcHost, size_t ByteCount)
+{
+    return cuMemcpy(dstDevice, (CUdeviceptr)srcHost, ByteCount);
+}
+
+CUresult cuMemcpyDtoH(void *dstHost, CUdeviceptr srcDevice, size_t ByteCount)
+{
+    return cuMemcpy((CUdeviceptr)dstHost, srcDevice, ByteCount);
+}
+
+CUresult cuMemcpy2D(const CUDA_MEMCPY2D *pCopy)
+{
+    const unsigned char *src;
+    unsigned char *dst;
+    size_t row;
+
+    if (pCopy == NULL)
+    {
+        return CUDA_ERROR_INVALID_VALUE;
+    }
+
+    // arrays only exist on real devices
+    if (pCopy->srcMemoryType == CU_MEMORYTYPE_ARRAY || pCopy->dstMemoryType == CU_MEMORYTYPE_ARRAY)
+    {
+        return CUDA_ERROR_NOT_SUPPORTED;
+    }
+
+    src = (pCopy->srcMemoryType == CU_MEMORYTYPE_HOST) ? (const unsigned char *)pCopy->srcHost : (const unsigned char *)pCopy->srcDevice;
+    dst = (pCopy->dstMemoryType == CU_MEMORYTYPE_HOST) ? (unsigned char *)pCopy->dstHost : (unsigned char *)pCopy->dstDevice;
+
+    if (src == NULL || dst == NULL)
+    {
+        return CUDA_ERROR_INVALID_VALUE;
+    }
+
+    if (pCopy->Height > 1 && (pCopy->srcPitch < pCopy->WidthInBytes || pCopy->dstPitch < pCopy->WidthInBytes))
+    {
+        return CUDA_ERROR_INVALID_VALUE;
+    }
+
+    src += pCopy->srcY * pCopy->srcPitch + pCopy->srcXInBytes;
+    dst += pCopy->dstY * pCopy->dstPitch + pCopy->dstXInBytes;
+    for (row = 0; row < pCopy->Height; row++)
+    {
+        memcpy(dst + row * pCopy->dstPitch, src + row * pCopy->srcPitch, pCopy->WidthInBytes);
+    }
+
+    return CUDA_SUCCESS;
+}
+
+CUresult cuMemsetD8(CUdeviceptr dstDevice, unsigned char uc, size_t N)
+{
+    if (dstDevice == 0 && N > 0)
+    {
+        return CUDA_ERROR_INVALID_VALUE;
+    }
+
+    memset((void *)dstDevice, uc, N);
+
+    return CUDA_SUCCESS;
+}
+
+CUresult cuMemsetD32(CUdeviceptr dstDevice, unsigned int ui, size_t N)
+{
+    unsigned int *dst;
+    size_t index;
+
+    if ((dstDevice == 0 && N > 0) || dstDevice % sizeof(unsigned int) != 0)
+    {
+        return CUDA_ERROR_INVALID_VALUE;
+    }
+
+    dst = (unsigned int *)dstDevice;
+    for (index = 0; index < N; index++)
+    {
+        dst[index] = ui;
+    }
+
+    return CUDA_SUCCESS;
+}
+
+CUresult cuGetErrorString(CUresult error, const char **pStr)
+{
+    const char *str;
+
+    if (pStr == NULL)
+    {
+        return CUDA_ERROR_INVALID_VALUE;
+    }
+
+    switch (error)
+    {
+    case CUDA_SUCCESS:
+        str = "no error";
+        break;
+    case CUDA_ERROR_INVALID_VALUE:
+        str = "invalid argument";
+        break;
+    case CUDA_ERROR_OUT_OF_MEMORY:
+        str = "out of memory";
+        break;
+    case CUDA_ERROR_NOT_INITIALIZED:
+        str = "initialization error";
+        break;
+    case CUDA_ERROR_NO_DEVICE:
+        str = "no CUDA-capable device is detected";
+        break;
+    case CUDA_ERROR_INVALID_DEVICE:
+        str = "invalid device ordinal";
+        break;
+    case CUDA_ERROR_INVALID_CONTEXT:
+        str = "invalid device context";
+        break;
+    case CUDA_ERROR_INVALID_HANDLE:
+        str = "invalid resource handle";
+        break;
+    case CUDA_ERROR_NOT_READY:
+        str = "device not ready";
+        break;
+    case CUDA_ERROR_NOT_SUPPORTED:
+        str = "operation not supported";
+        break;
+    default:
+        str = "unknown error";
+        break;
+    }
+    *pStr = str;
+
+    return CUDA_SUCCESS;
+}
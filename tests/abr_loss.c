@@ -0,0 +1,105 @@
+#include "harness.h"
+
+#include <string.h>
+
+// two clients share one encoder, one of them loses a fifth of its RTP packets: the bitrate must
+// back off for the shared media and grow again once the loss stops
+
+#define START_BITRATE 4000
+#define LOSS_SECONDS 30
+#define RECOVERY_SECONDS 30
+#define LOSS_PERCENT 20
+
+static int lossy;
+
+static GstPadProbeReturn dropPacket(GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+    if (__atomic_load_n(&lossy, __ATOMIC_RELAXED) && g_random_int_range(0, 100) < LOSS_PERCENT)
+    {
+        return GST_PAD_PROBE_DROP;
+    }
+
+    return GST_PAD_PROBE_OK;
+}
+
+// RTP arrives on the even port of each pair, RTCP on the odd one is left alone
+static void elementAdded(GstBin *bin, GstBin *sub_bin, GstElement *element, gpointer user_data)
+{
+    GstElementFactory *factory;
+    GstPad *pad;
+    gint port;
+
+    factory = gst_element_get_factory(element);
+    if (factory == NULL || strcmp(GST_OBJECT_NAME(factory), "udpsrc") != 0)
+    {
+        return;
+    }
+    g_object_get(element, "port", &port, NULL);
+    if (port % 2 == 0)
+    {
+        pad = gst_element_get_static_pad(element, "src");
+        gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, dropPacket, NULL, NULL);
+        gst_object_unref(pad);
+    }
+}
+
+static unsigned int bitrate(CUrtsp_session session)
+{
+    CUDA_RTSP_SESSION_STATS stats;
+
+    TEST_CHECK(cuRTSPSessionGetStats(session, &stats) == CUDA_SUCCESS);
+
+    return (unsigned int)stats.bitrate;
+}
+
+int main(void)
+{
+    test_server server;
+    CUDA_RTSP_SESSION create_session;
+    CUrtsp_session session;
+    test_client *clean;
+    test_client *lossy_client;
+    unsigned int backed_off;
+    unsigned int recovered;
+
+    testInit();
+    testServerStart(&server, NULL);
+
+    testSessionDefaults(&create_session, 1280, 720);
+    create_session.shared = true;
+    create_session.encoder.bitrate = START_BITRATE;
+    create_session.encoder.minBitrate = START_BITRATE / 8;
+    create_session.encoder.maxBitrate = START_BITRATE;
+    TEST_CHECK(cuRTSPSessionCreate(&session, &create_session) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionMount(session, server.server, "/abr") == CUDA_SUCCESS);
+
+    clean = testClientStart(server.port, "/abr", "udp");
+    lossy_client = testClientCreate(server.port, "/abr", "udp");
+    g_signal_connect(lossy_client->pipeline, "deep-element-added", (GCallback)elementAdded, NULL);
+    __atomic_store_n(&lossy, 1, __ATOMIC_RELAXED);
+    testClientPlay(lossy_client);
+    TEST_CHECK(testClientWait(clean, 1, 10000));
+    TEST_CHECK(testClientWait(lossy_client, 1, 10000));
+    TEST_CHECK(bitrate(session) == START_BITRATE);
+
+    // receivers report about every five seconds
+    testSleepMs(LOSS_SECONDS * 1000);
+    backed_off = bitrate(session);
+    __atomic_store_n(&lossy, 0, __ATOMIC_RELAXED);
+    testSleepMs(RECOVERY_SECONDS * 1000);
+    recovered = bitrate(session);
+    printf("bitrate %u kbit/s, %u after %d s of %d%% loss at one receiver, %u after %d s without loss\n", START_BITRATE, backed_off,
+           LOSS_SECONDS, LOSS_PERCENT, recovered, RECOVERY_SECONDS);
+
+    TEST_CHECK(backed_off < START_BITRATE);
+    TEST_CHECK(backed_off >= START_BITRATE / 8);
+    TEST_CHECK(recovered > backed_off);
+
+    testClientStop(lossy_client);
+    testClientStop(clean);
+    cuRTSPSessionDestroy(session);
+    testServerStop(&server);
+    cuRTSPDeinit();
+
+    return 0;
+}
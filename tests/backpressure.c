@@ -0,0 +1,114 @@
+#include "harness.h"
+
+#include <unistd.h>
+
+// an interleaved client that never reads is throttled on its own send queue,
+// while the other interleaved clients of the shared stream keep the frame rate
+
+#define FPS 30
+#define CLIENTS 4
+#define SECONDS 4
+#define MAX_QUEUE (128 << 10)
+#define MAX_STATS 16
+
+static uint32_t NOISE = 1;
+
+// noise keeps the encoder at its bitrate, so the stalled client's queue fills within a second
+static void CUDA_CB noiseFrame(CUdeviceptr buffer, size_t size, void *user_data)
+{
+    uint32_t *words;
+    uint32_t state;
+    size_t index;
+
+    words = (uint32_t *)buffer;
+    state = NOISE;
+    for (index = 0; index < size / sizeof(uint32_t); index++)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        words[index] = state;
+    }
+    NOISE = state;
+}
+
+int main(void)
+{
+    test_server server;
+    CUDA_RTSP_SESSION create_session;
+    CUDA_RTSP_SESSION_STATS stats;
+    CUDA_RTSP_CLIENT_STATS client_stats[MAX_STATS];
+    CUrtsp_session session;
+    test_client *clients[CLIENTS];
+    test_client window;
+    char session_id[128];
+    uint64_t throttle_events;
+    size_t count;
+    size_t index;
+    int fd;
+
+    testInit();
+    testServerStart(&server, NULL);
+
+    testSessionDefaults(&create_session, 640, 360);
+    create_session.shared = true;
+    create_session.writeCallback = noiseFrame;
+    create_session.encoder.bitrate = 8000;
+    create_session.backpressure.maxQueueBytes = MAX_QUEUE;
+    create_session.backpressure.policy = CU_RTSP_BACKPRESSURE_DROP;
+    TEST_CHECK(cuRTSPSessionCreate(&session, &create_session) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionMount(session, server.server, "/throttle") == CUDA_SUCCESS);
+
+    for (index = 0; index < CLIENTS; index++)
+    {
+        clients[index] = testClientStart(server.port, "/throttle", "tcp");
+    }
+    for (index = 0; index < CLIENTS; index++)
+    {
+        TEST_CHECK(testClientWait(clients[index], FPS, 20000));
+    }
+
+    // a small receive buffer and no reads leave everything sent to it queued at the server
+    fd = testRtspConnect(server.port, 4096);
+    TEST_CHECK(fd >= 0);
+    TEST_CHECK(testRtspPlay(fd, server.port, "/throttle", "RTP/AVP/TCP;unicast;interleaved=0-1", session_id, sizeof(session_id)));
+    testSleepMs(1000);
+
+    for (index = 0; index < CLIENTS; index++)
+    {
+        testClientReset(clients[index]);
+    }
+    testSleepMs(SECONDS * 1000);
+    for (index = 0; index < CLIENTS; index++)
+    {
+        testClientSnapshot(clients[index], &window);
+        printf("client %zu: %.1f fps\n", index, (double)window.frames / SECONDS);
+        TEST_CHECK(window.frames >= FPS * SECONDS * 0.8);
+    }
+
+    count = MAX_STATS;
+    TEST_CHECK(cuRTSPServerGetStats(server.server, client_stats, &count) == CUDA_SUCCESS);
+    throttle_events = 0;
+    for (index = 0; index < count && index < MAX_STATS; index++)
+    {
+        printf("%s interleaved=%d queued %llu bytes, throttled=%d, %llu events, %llu frames skipped\n", client_stats[index].address,
+               client_stats[index].interleaved, (unsigned long long)client_stats[index].sendQueueBytes, client_stats[index].throttled,
+               (unsigned long long)client_stats[index].throttleEvents, (unsigned long long)client_stats[index].framesSkipped);
+        throttle_events += client_stats[index].throttleEvents;
+    }
+    TEST_CHECK(cuRTSPSessionGetStats(session, &stats) == CUDA_SUCCESS);
+    printf("%llu clients throttled\n", (unsigned long long)stats.clientsThrottled);
+    TEST_CHECK(throttle_events > 0);
+    TEST_CHECK(stats.clientsThrottled > 0);
+
+    close(fd);
+    for (index = 0; index < CLIENTS; index++)
+    {
+        testClientStop(clients[index]);
+    }
+    cuRTSPSessionDestroy(session);
+    testServerStop(&server);
+    cuRTSPDeinit();
+
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include "harness.h"
+
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// a throttled interleaved client that drains its queue again is resumed at a key unit,
+// and the frames it missed until then are counted as skipped
+
+#define GOP 90
+#define MAX_QUEUE (128 << 10)
+#define MAX_STATS 16
+
+static uint32_t NOISE = 1;
+
+static void CUDA_CB noiseFrame(CUdeviceptr buffer, size_t size, void *user_data)
+{
+    uint32_t *words;
+    uint32_t state;
+    size_t index;
+
+    words = (uint32_t *)buffer;
+    state = NOISE;
+    for (index = 0; index < size / sizeof(uint32_t); index++)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        words[index] = state;
+    }
+    NOISE = state;
+}
+
+static bool readFull(int fd, uint8_t *data, size_t size, gint64 deadline)
+{
+    struct pollfd pfd;
+    size_t used;
+    ssize_t received;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    for (used = 0; used < size; used += (size_t)received)
+    {
+        if (g_get_monotonic_time() >= deadline || poll(&pfd, 1, 100) < 0)
+        {
+            return false;
+        }
+        received = (pfd.revents & POLLIN) ? recv(fd, data + used, size - used, 0) : 0;
+        if (received < 0 || (received == 0 && (pfd.revents & POLLIN)))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// the first packet of an H.264 key unit: parameter sets, an IDR slice or the start of a fragmented one
+static bool startsKeyUnit(const uint8_t *packet, size_t size)
+{
+    size_t header;
+    int type;
+
+    header = 12 + (size_t)(packet[0] & 0x0f) * 4;
+    if ((packet[0] & 0x10) && size >= header + 4)
+    {
+        header += 4 + (size_t)((packet[header + 2] << 8) | packet[header + 3]) * 4;
+    }
+    if (size < header + 4)
+    {
+        return false;
+    }
+    type = packet[header] & 0x1f;
+    if (type == 24)
+    {
+        type = packet[header + 3] & 0x1f;
+    }
+    else if (type == 28)
+    {
+        type = (packet[header + 1] & 0x80) ? packet[header + 1] & 0x1f : 0;
+    }
+
+    return type == 5 || type == 7 || type == 8;
+}
+
+int main(void)
+{
+    test_server server;
+    CUDA_RTSP_SESSION create_session;
+    CUDA_RTSP_CLIENT_STATS client_stats[MAX_STATS];
+    CUrtsp_session session;
+    char session_id[128];
+    uint8_t header[4];
+    uint8_t packet[65536];
+    uint16_t sequence;
+    uint16_t expected;
+    gint64 deadline;
+    size_t length;
+    size_t count;
+    size_t index;
+    bool started;
+    bool resumed;
+    bool key;
+    int fd;
+
+    testInit();
+    testServerStart(&server, NULL);
+
+    testSessionDefaults(&create_session, 640, 360);
+    create_session.writeCallback = noiseFrame;
+    create_session.encoder.bitrate = 8000;
+    create_session.encoder.gopLength = GOP;
+    create_session.backpressure.maxQueueBytes = MAX_QUEUE;
+    create_session.backpressure.policy = CU_RTSP_BACKPRESSURE_DROP;
+    TEST_CHECK(cuRTSPSessionCreate(&session, &create_session) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionMount(session, server.server, "/resume") == CUDA_SUCCESS);
+
+    // nothing is read until the client is throttled
+    fd = testRtspConnect(server.port, 4096);
+    TEST_CHECK(fd >= 0);
+    TEST_CHECK(testRtspPlay(fd, server.port, "/resume", "RTP/AVP/TCP;unicast;interleaved=0-1", session_id, sizeof(session_id)));
+    testSleepMs(1500);
+
+    // the queued packets follow each other, the first one after the gap has to start a key unit
+    started = false;
+    resumed = false;
+    key = false;
+    expected = 0;
+    deadline = g_get_monotonic_time() + (GOP / 30 + 5) * G_TIME_SPAN_SECOND;
+    while (!resumed && readFull(fd, header, sizeof(header), deadline))
+    {
+        TEST_CHECK(header[0] == '$');
+        length = (size_t)((header[2] << 8) | header[3]);
+        TEST_CHECK(readFull(fd, packet, length, deadline));
+        if (header[1] != 0 || length < 12)
+        {
+            continue;
+        }
+        sequence = (uint16_t)((packet[2] << 8) | packet[3]);
+        if (started && sequence != expected)
+        {
+            resumed = true;
+            key = startsKeyUnit(packet, length);
+        }
+        started = true;
+        expected = (uint16_t)(sequence + 1);
+    }
+    printf("resumed=%d at a key unit=%d\n", resumed, key);
+    TEST_CHECK(resumed);
+    TEST_CHECK(key);
+
+    count = MAX_STATS;
+    TEST_CHECK(cuRTSPServerGetStats(server.server, client_stats, &count) == CUDA_SUCCESS);
+    TEST_CHECK(count >= 1);
+    for (index = 0; index < count && index < MAX_STATS; index++)
+    {
+        printf("%s throttled=%d, %llu events, %llu frames skipped\n", client_stats[index].address, client_stats[index].throttled,
+               (unsigned long long)client_stats[index].throttleEvents, (unsigned long long)client_stats[index].framesSkipped);
+        TEST_CHECK(client_stats[index].throttleEvents > 0);
+        TEST_CHECK(client_stats[index].framesSkipped > 0);
+    }
+
+    close(fd);
+    cuRTSPSessionDestroy(session);
+    testServerStop(&server);
+    cuRTSPDeinit();
+
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include "harness.h"
+
+// two clients of a shared stream that joined at different times report what each of them was sent
+
+#define FPS 30
+#define MAX_STATS 8
+
+static void checkDistinct(const CUDA_RTSP_CLIENT_STATS *stats, size_t count, bool interleaved)
+{
+    uint64_t bytes[2];
+    uint64_t packets[2];
+    size_t found;
+    size_t index;
+
+    found = 0;
+    for (index = 0; index < count; index++)
+    {
+        if (stats[index].interleaved == interleaved && found < 2)
+        {
+            bytes[found] = stats[index].bytesSent;
+            packets[found] = stats[index].packetsSent;
+            found++;
+        }
+    }
+    TEST_CHECK(found == 2);
+    TEST_CHECK(bytes[0] > 0 && bytes[1] > 0);
+    TEST_CHECK(packets[0] > 0 && packets[1] > 0);
+    // the late client missed half of the stream
+    TEST_CHECK(MAX(bytes[0], bytes[1]) > MIN(bytes[0], bytes[1]) * 3 / 2);
+    TEST_CHECK(MAX(packets[0], packets[1]) > MIN(packets[0], packets[1]) * 3 / 2);
+}
+
+int main(void)
+{
+    test_server server;
+    CUDA_RTSP_SESSION create_session;
+    CUDA_RTSP_CLIENT_STATS client_stats[MAX_STATS];
+    CUrtsp_session session;
+    test_client *early[2];
+    test_client *late[2];
+    size_t count;
+    size_t index;
+
+    testInit();
+    testServerStart(&server, NULL);
+
+    testSessionDefaults(&create_session, 640, 360);
+    create_session.shared = true;
+    TEST_CHECK(cuRTSPSessionCreate(&session, &create_session) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionMount(session, server.server, "/stats") == CUDA_SUCCESS);
+
+    early[0] = testClientStart(server.port, "/stats", "udp");
+    early[1] = testClientStart(server.port, "/stats", "tcp");
+    TEST_CHECK(testClientWait(early[0], FPS, 20000));
+    TEST_CHECK(testClientWait(early[1], FPS, 20000));
+    testSleepMs(3000);
+
+    late[0] = testClientStart(server.port, "/stats", "udp");
+    late[1] = testClientStart(server.port, "/stats", "tcp");
+    TEST_CHECK(testClientWait(late[0], 1, 20000));
+    TEST_CHECK(testClientWait(late[1], 1, 20000));
+    testSleepMs(1000);
+
+    count = MAX_STATS;
+    TEST_CHECK(cuRTSPServerGetStats(server.server, client_stats, &count) == CUDA_SUCCESS);
+    TEST_CHECK(count == 4);
+    for (index = 0; index < count; index++)
+    {
+        printf("%s interleaved=%d %llu bytes, %llu packets\n", client_stats[index].address, client_stats[index].interleaved,
+               (unsigned long long)client_stats[index].bytesSent, (unsigned long long)client_stats[index].packetsSent);
+    }
+    checkDistinct(client_stats, count, false);
+    checkDistinct(client_stats, count, true);
+
+    for (index = 0; index < 2; index++)
+    {
+        testClientStop(early[index]);
+        testClientStop(late[index]);
+    }
+    cuRTSPSessionDestroy(session);
+    testServerStop(&server);
+    cuRTSPDeinit();
+
+    return 0;
+}
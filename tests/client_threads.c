@@ -0,0 +1,214 @@
+#include "harness.h"
+
+#include <dirent.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// RTSP setup rate and interleaved throughput with one, two and four client threads,
+// then a pinned pool whose client threads must run on the configured CPU only
+
+#define SECONDS 3
+#define CONNECTORS 8
+#define READERS 16
+
+typedef struct load_st
+{
+    uint16_t port;
+    int stopped;
+    uint64_t setups;
+    uint64_t bytes;
+    int failures;
+} load;
+
+static gpointer connectLoop(gpointer data)
+{
+    load *state;
+    char session[128];
+    char response[4096];
+    char url[256];
+    char headers[192];
+    int fd;
+
+    state = (load *)data;
+    snprintf(url, sizeof(url), "rtsp://127.0.0.1:%u/load", state->port);
+    while (!__atomic_load_n(&state->stopped, __ATOMIC_SEQ_CST))
+    {
+        fd = testRtspConnect(state->port, 0);
+        if (fd < 0 || !testRtspPlay(fd, state->port, "/load", "RTP/AVP/TCP;unicast;interleaved=0-1", session, sizeof(session)))
+        {
+            __atomic_add_fetch(&state->failures, 1, __ATOMIC_RELAXED);
+        }
+        else
+        {
+            snprintf(headers, sizeof(headers), "Session: %s\r\n", session);
+            testRtspRequest(fd, "TEARDOWN", url, headers, response, sizeof(response));
+            __atomic_add_fetch(&state->setups, 1, __ATOMIC_RELAXED);
+        }
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+
+    return NULL;
+}
+
+static gpointer readLoop(gpointer data)
+{
+    load *state;
+    char session[128];
+    char buffer[65536];
+    ssize_t count;
+    int fd;
+
+    state = (load *)data;
+    fd = testRtspConnect(state->port, 0);
+    if (fd < 0 || !testRtspPlay(fd, state->port, "/load", "RTP/AVP/TCP;unicast;interleaved=0-1", session, sizeof(session)))
+    {
+        __atomic_add_fetch(&state->failures, 1, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        while (!__atomic_load_n(&state->stopped, __ATOMIC_SEQ_CST) && (count = recv(fd, buffer, sizeof(buffer), 0)) > 0)
+        {
+            __atomic_add_fetch(&state->bytes, (uint64_t)count, __ATOMIC_RELAXED);
+        }
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+
+    return NULL;
+}
+
+// client threads are the only ones restricted to a single CPU
+static size_t countPinned(int cpu)
+{
+    DIR *tasks;
+    struct dirent *entry;
+    char path[300];
+    char line[256];
+    char expected[32];
+    FILE *status;
+    size_t count;
+
+    count = 0;
+    snprintf(expected, sizeof(expected), "Cpus_allowed_list:\t%d\n", cpu);
+    tasks = opendir("/proc/self/task");
+    TEST_CHECK(tasks != NULL);
+    while ((entry = readdir(tasks)) != NULL)
+    {
+        snprintf(path, sizeof(path), "/proc/self/task/%s/status", entry->d_name);
+        status = fopen(path, "r");
+        while (status != NULL && fgets(line, sizeof(line), status) != NULL)
+        {
+            if (strcmp(line, expected) == 0)
+            {
+                count++;
+            }
+        }
+        if (status != NULL)
+        {
+            fclose(status);
+        }
+    }
+    closedir(tasks);
+
+    return count;
+}
+
+// returns how many threads were pinned to cpu just before the load stopped, cpu -1 skips counting
+static size_t runThreads(load *state, GThreadFunc func, size_t count, int cpu)
+{
+    GThread *threads[READERS];
+    size_t pinned;
+    size_t index;
+
+    __atomic_store_n(&state->stopped, 0, __ATOMIC_SEQ_CST);
+    for (index = 0; index < count; index++)
+    {
+        threads[index] = g_thread_new("load", func, state);
+    }
+    testSleepMs(SECONDS * 1000);
+    pinned = (cpu >= 0) ? countPinned(cpu) : 0;
+    __atomic_store_n(&state->stopped, 1, __ATOMIC_SEQ_CST);
+    for (index = 0; index < count; index++)
+    {
+        g_thread_join(threads[index]);
+    }
+
+    return pinned;
+}
+
+static CUrtsp_session mountLoad(test_server *server)
+{
+    CUDA_RTSP_SESSION create_session;
+    CUrtsp_session session;
+
+    testSessionDefaults(&create_session, 1280, 720);
+    create_session.shared = true;
+    create_session.prewarm = true;
+    create_session.encoder.bitrate = 8000;
+    TEST_CHECK(cuRTSPSessionCreate(&session, &create_session) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionMount(session, server->server, "/load") == CUDA_SUCCESS);
+
+    return session;
+}
+
+int main(void)
+{
+    static const size_t thread_counts[] = {1, 2, 4};
+    CUDA_RTSP_SERVER create_server = {0};
+    test_server server;
+    CUrtsp_session session;
+    load state;
+    size_t index;
+    size_t pinned;
+    int cpu;
+
+    testInit();
+
+    for (index = 0; index < G_N_ELEMENTS(thread_counts); index++)
+    {
+        create_server.clientThreads = thread_counts[index];
+        testServerStart(&server, &create_server);
+        session = mountLoad(&server);
+        memset(&state, 0, sizeof(state));
+        state.port = server.port;
+
+        runThreads(&state, connectLoop, CONNECTORS, -1);
+        runThreads(&state, readLoop, READERS, -1);
+        printf("%zu client threads: %.1f setups/s, %.1f Mbit/s to %d interleaved clients, %d failures\n",
+               thread_counts[index], (double)state.setups / SECONDS, state.bytes * 8.0 / SECONDS / 1e6, READERS, state.failures);
+        TEST_CHECK(state.setups > 0);
+        TEST_CHECK(state.bytes > 0);
+        TEST_CHECK(state.failures == 0);
+
+        cuRTSPSessionDestroy(session);
+        testServerStop(&server);
+    }
+
+    // with one CPU every thread is on it, so pinning cannot be told apart
+    if (g_get_num_processors() > 1)
+    {
+        cpu = (int)g_get_num_processors() - 1;
+        create_server.clientThreads = 2;
+        create_server.cpus = &cpu;
+        create_server.cpuCount = 1;
+        testServerStart(&server, &create_server);
+        session = mountLoad(&server);
+        memset(&state, 0, sizeof(state));
+        state.port = server.port;
+        TEST_CHECK(countPinned(cpu) == 0);
+        pinned = runThreads(&state, readLoop, READERS, cpu);
+        printf("%zu threads pinned to CPU %d while %d clients played\n", pinned, cpu, READERS);
+        TEST_CHECK(pinned > 0);
+        cuRTSPSessionDestroy(session);
+        testServerStop(&server);
+    }
+
+    cuRTSPDeinit();
+
+    return 0;
+}
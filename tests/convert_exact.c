@@ -0,0 +1,310 @@
+#include "harness.h"
+
+#include <math.h>
+#include <string.h>
+
+// every row converter and the YUV relayout produce the bytes of a plain per-pixel BT.601 reference,
+// for every source format, both destinations and odd sizes, and that reference stays within the
+// documented distance of the real-valued BT.601 limited-range matrix for every RGB triple
+
+static const char *const ISAS[] = {"avx512bw", "avx2", "sse4.1", "scalar"};
+
+static const CUrtsp_format SOURCES[] = {
+    CU_RTSP_FORMAT_NV12,
+    CU_RTSP_FORMAT_YV12,
+    CU_RTSP_FORMAT_I420,
+    CU_RTSP_FORMAT_BGRA,
+    CU_RTSP_FORMAT_RGBA,
+    CU_RTSP_FORMAT_Y444,
+    CU_RTSP_FORMAT_VUYA,
+    CU_RTSP_FORMAT_ARGB,
+    CU_RTSP_FORMAT_ABGR,
+    CU_RTSP_FORMAT_BGR,
+    CU_RTSP_FORMAT_RGB,
+};
+
+static const uint32_t SIZES[][2] = {{1, 1}, {2, 2}, {37, 19}, {64, 32}, {130, 7}, {333, 101}};
+
+// components of (x, y) as bytes: Y U V for YUV sources, R G B for RGB ones
+static void referenceSample(const CUrtsp_image *src, uint32_t x, uint32_t y, int *c0, int *c1, int *c2)
+{
+    const uint8_t *p;
+
+    switch (src->format)
+    {
+    case CU_RTSP_FORMAT_NV12:
+        *c0 = src->planes[0][y * src->pitches[0] + x];
+        *c1 = src->planes[1][(y / 2) * src->pitches[1] + (x / 2) * 2];
+        *c2 = src->planes[1][(y / 2) * src->pitches[1] + (x / 2) * 2 + 1];
+        break;
+    case CU_RTSP_FORMAT_I420:
+        *c0 = src->planes[0][y * src->pitches[0] + x];
+        *c1 = src->planes[1][(y / 2) * src->pitches[1] + x / 2];
+        *c2 = src->planes[2][(y / 2) * src->pitches[2] + x / 2];
+        break;
+    case CU_RTSP_FORMAT_YV12:
+        *c0 = src->planes[0][y * src->pitches[0] + x];
+        *c1 = src->planes[2][(y / 2) * src->pitches[2] + x / 2];
+        *c2 = src->planes[1][(y / 2) * src->pitches[1] + x / 2];
+        break;
+    case CU_RTSP_FORMAT_Y444:
+        *c0 = src->planes[0][y * src->pitches[0] + x];
+        *c1 = src->planes[1][y * src->pitches[1] + x];
+        *c2 = src->planes[2][y * src->pitches[2] + x];
+        break;
+    case CU_RTSP_FORMAT_VUYA:
+        p = src->planes[0] + y * src->pitches[0] + x * 4;
+        *c0 = p[2];
+        *c1 = p[1];
+        *c2 = p[0];
+        break;
+    case CU_RTSP_FORMAT_BGRA:
+    case CU_RTSP_FORMAT_BGR:
+        p = src->planes[0] + y * src->pitches[0] + x * ((src->format == CU_RTSP_FORMAT_BGR) ? 3 : 4);
+        *c0 = p[2];
+        *c1 = p[1];
+        *c2 = p[0];
+        break;
+    case CU_RTSP_FORMAT_RGBA:
+    case CU_RTSP_FORMAT_RGB:
+        p = src->planes[0] + y * src->pitches[0] + x * ((src->format == CU_RTSP_FORMAT_RGB) ? 3 : 4);
+        *c0 = p[0];
+        *c1 = p[1];
+        *c2 = p[2];
+        break;
+    case CU_RTSP_FORMAT_ARGB:
+        p = src->planes[0] + y * src->pitches[0] + x * 4;
+        *c0 = p[1];
+        *c1 = p[2];
+        *c2 = p[3];
+        break;
+    default:
+        p = src->planes[0] + y * src->pitches[0] + x * 4;
+        *c0 = p[3];
+        *c1 = p[2];
+        *c2 = p[1];
+        break;
+    }
+}
+
+static bool isRgb(CUrtsp_format format)
+{
+    return format == CU_RTSP_FORMAT_BGRA || format == CU_RTSP_FORMAT_RGBA || format == CU_RTSP_FORMAT_ARGB ||
+           format == CU_RTSP_FORMAT_ABGR || format == CU_RTSP_FORMAT_BGR || format == CU_RTSP_FORMAT_RGB;
+}
+
+static void reference(const CUrtsp_image *src, const CUrtsp_image *dst)
+{
+    uint32_t xs[2];
+    uint32_t ys[2];
+    uint32_t x;
+    uint32_t y;
+    int sum[3];
+    int c[3];
+    int cb;
+    int cr;
+    int i;
+
+    for (y = 0; y < src->height; y += 2)
+    {
+        for (x = 0; x < src->width; x += 2)
+        {
+            // odd edges pair the last column and row with themselves
+            xs[0] = x;
+            xs[1] = (x + 1 < src->width) ? x + 1 : x;
+            ys[0] = y;
+            ys[1] = (y + 1 < src->height) ? y + 1 : y;
+            sum[0] = sum[1] = sum[2] = 0;
+            for (i = 0; i < 4; i++)
+            {
+                referenceSample(src, xs[i & 1], ys[i >> 1], &c[0], &c[1], &c[2]);
+                dst->planes[0][ys[i >> 1] * dst->pitches[0] + xs[i & 1]] =
+                    isRgb(src->format) ? (uint8_t)(((66 * c[0] + 129 * c[1] + 25 * c[2] + 128) >> 8) + 16) : (uint8_t)c[0];
+                sum[0] += c[0];
+                sum[1] += c[1];
+                sum[2] += c[2];
+            }
+            if (isRgb(src->format))
+            {
+                c[0] = (sum[0] + 2) >> 2;
+                c[1] = (sum[1] + 2) >> 2;
+                c[2] = (sum[2] + 2) >> 2;
+                cb = ((-38 * c[0] - 74 * c[1] + 112 * c[2] + 128) >> 8) + 128;
+                cr = ((112 * c[0] - 94 * c[1] - 18 * c[2] + 128) >> 8) + 128;
+            }
+            else
+            {
+                cb = (sum[1] + 2) >> 2;
+                cr = (sum[2] + 2) >> 2;
+            }
+            if (dst->format == CU_RTSP_FORMAT_NV12)
+            {
+                dst->planes[1][(y / 2) * dst->pitches[1] + x] = (uint8_t)cb;
+                dst->planes[1][(y / 2) * dst->pitches[1] + x + 1] = (uint8_t)cr;
+            }
+            else
+            {
+                dst->planes[1][(y / 2) * dst->pitches[1] + x / 2] = (uint8_t)cb;
+                dst->planes[2][(y / 2) * dst->pitches[2] + x / 2] = (uint8_t)cr;
+            }
+        }
+    }
+}
+
+static bool samePlanes(const CUrtsp_image *a, const CUrtsp_image *b)
+{
+    size_t chroma_bytes;
+    uint32_t y;
+
+    chroma_bytes = (a->format == CU_RTSP_FORMAT_NV12) ? ((a->width + 1) & ~1u) : (a->width + 1) / 2;
+    for (y = 0; y < a->height; y++)
+    {
+        if (memcmp(a->planes[0] + y * a->pitches[0], b->planes[0] + y * b->pitches[0], a->width) != 0)
+        {
+            return false;
+        }
+    }
+    for (y = 0; y < (a->height + 1) / 2; y++)
+    {
+        if (memcmp(a->planes[1] + y * a->pitches[1], b->planes[1] + y * b->pitches[1], chroma_bytes) != 0 ||
+            (a->format == CU_RTSP_FORMAT_I420 && memcmp(a->planes[2] + y * a->pitches[2], b->planes[2] + y * b->pitches[2], chroma_bytes) != 0))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static double exactLuma(double r, double g, double b)
+{
+    return 16.0 + 219.0 * (0.299 * r + 0.587 * g + 0.114 * b) / 255.0;
+}
+
+static double exactCb(double r, double g, double b)
+{
+    return 128.0 + 224.0 * (-0.168736 * r - 0.331264 * g + 0.5 * b) / 255.0;
+}
+
+static double exactCr(double r, double g, double b)
+{
+    return 128.0 + 224.0 * (0.5 * r - 0.418688 * g - 0.081312 * b) / 255.0;
+}
+
+// one BGRA pixel per RGB triple, chroma against the matrix applied to the unrounded 2x2 mean
+static void checkDeviation(void)
+{
+    CUrtsp_image *src;
+    CUrtsp_image *dst;
+    const uint8_t *p;
+    double worst[3];
+    double mean[3];
+    double deviation;
+    uint32_t x;
+    uint32_t y;
+    uint32_t i;
+
+    src = testImageNew(CU_RTSP_FORMAT_BGRA, 4096, 4096);
+    dst = testImageNew(CU_RTSP_FORMAT_I420, 4096, 4096);
+    for (y = 0; y < 4096; y++)
+    {
+        for (x = 0; x < 4096; x++)
+        {
+            i = y * 4096 + x;
+            src->planes[0][y * src->pitches[0] + x * 4] = (uint8_t)i;
+            src->planes[0][y * src->pitches[0] + x * 4 + 1] = (uint8_t)(i >> 8);
+            src->planes[0][y * src->pitches[0] + x * 4 + 2] = (uint8_t)(i >> 16);
+            src->planes[0][y * src->pitches[0] + x * 4 + 3] = 255;
+        }
+    }
+    cuRTSPConvertFrame(src, dst);
+
+    worst[0] = worst[1] = worst[2] = 0.0;
+    for (y = 0; y < 4096; y++)
+    {
+        for (x = 0; x < 4096; x++)
+        {
+            p = src->planes[0] + y * src->pitches[0] + x * 4;
+            deviation = fabs(dst->planes[0][y * dst->pitches[0] + x] - exactLuma(p[2], p[1], p[0]));
+            worst[0] = (deviation > worst[0]) ? deviation : worst[0];
+        }
+    }
+    for (y = 0; y < 4096; y += 2)
+    {
+        for (x = 0; x < 4096; x += 2)
+        {
+            mean[0] = mean[1] = mean[2] = 0.0;
+            for (i = 0; i < 4; i++)
+            {
+                p = src->planes[0] + (y + i / 2) * src->pitches[0] + (x + i % 2) * 4;
+                mean[0] += p[2] / 4.0;
+                mean[1] += p[1] / 4.0;
+                mean[2] += p[0] / 4.0;
+            }
+            deviation = fabs(dst->planes[1][(y / 2) * dst->pitches[1] + x / 2] - exactCb(mean[0], mean[1], mean[2]));
+            worst[1] = (deviation > worst[1]) ? deviation : worst[1];
+            deviation = fabs(dst->planes[2][(y / 2) * dst->pitches[2] + x / 2] - exactCr(mean[0], mean[1], mean[2]));
+            worst[2] = (deviation > worst[2]) ? deviation : worst[2];
+        }
+    }
+    printf("deviation from BT.601: Y %.3f Cb %.3f Cr %.3f\n", worst[0], worst[1], worst[2]);
+    TEST_CHECK(worst[0] < 1.0);
+    TEST_CHECK(worst[1] < 1.5);
+    TEST_CHECK(worst[2] < 1.5);
+
+    testImageFree(dst);
+    testImageFree(src);
+}
+
+int main(void)
+{
+    static const CUrtsp_format destinations[] = {CU_RTSP_FORMAT_NV12, CU_RTSP_FORMAT_I420};
+    CUrtsp_image *src;
+    CUrtsp_image *expected;
+    CUrtsp_image *actual;
+    size_t isa;
+    size_t format;
+    size_t destination;
+    size_t size;
+    size_t compared;
+
+    compared = 0;
+    for (isa = 0; isa < G_N_ELEMENTS(ISAS); isa++)
+    {
+        if (!cuRTSPConvertForceIsa(ISAS[isa]))
+        {
+            printf("%s: not supported by this CPU\n", ISAS[isa]);
+            continue;
+        }
+        for (format = 0; format < G_N_ELEMENTS(SOURCES); format++)
+        {
+            for (destination = 0; destination < G_N_ELEMENTS(destinations); destination++)
+            {
+                TEST_CHECK(cuRTSPConvertSupported(SOURCES[format], destinations[destination]));
+                for (size = 0; size < G_N_ELEMENTS(SIZES); size++)
+                {
+                    src = testImageNew(SOURCES[format], SIZES[size][0], SIZES[size][1]);
+                    expected = testImageNew(destinations[destination], SIZES[size][0], SIZES[size][1]);
+                    actual = testImageNew(destinations[destination], SIZES[size][0], SIZES[size][1]);
+                    reference(src, expected);
+                    cuRTSPConvertFrame(src, actual);
+                    if (!samePlanes(expected, actual))
+                    {
+                        fprintf(stderr, "%s: format %d to %d at %ux%u differs from the reference\n", ISAS[isa], (int)SOURCES[format],
+                                (int)destinations[destination], SIZES[size][0], SIZES[size][1]);
+                        exit(1);
+                    }
+                    testImageFree(actual);
+                    testImageFree(expected);
+                    testImageFree(src);
+                    compared++;
+                }
+            }
+        }
+        printf("%s: bit-exact\n", ISAS[isa]);
+    }
+    TEST_CHECK(compared > 0);
+    checkDeviation();
+
+    return 0;
+}
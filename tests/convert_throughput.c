@@ -0,0 +1,72 @@
+#include "harness.h"
+
+// 1080p frames per second of the host conversion for each row converter this CPU supports
+
+#define WIDTH 1920
+#define HEIGHT 1080
+#define SECONDS 0.5
+
+typedef struct convert_case_st
+{
+    const char *name;
+    CUrtsp_format src;
+    CUrtsp_format dst;
+} convert_case;
+
+static const char *const ISAS[] = {"avx512bw", "avx2", "sse4.1", "scalar"};
+
+static const convert_case CASES[] = {
+    {"BGRA to NV12", CU_RTSP_FORMAT_BGRA, CU_RTSP_FORMAT_NV12},
+    {"RGB to I420", CU_RTSP_FORMAT_RGB, CU_RTSP_FORMAT_I420},
+    {"I420 to NV12", CU_RTSP_FORMAT_I420, CU_RTSP_FORMAT_NV12},
+    {"VUYA to NV12", CU_RTSP_FORMAT_VUYA, CU_RTSP_FORMAT_NV12},
+};
+
+static double framesPerSecond(const convert_case *pCase)
+{
+    CUrtsp_image *src;
+    CUrtsp_image *dst;
+    gint64 start;
+    gint64 elapsed;
+    uint64_t frames;
+
+    src = testImageNew(pCase->src, WIDTH, HEIGHT);
+    dst = testImageNew(pCase->dst, WIDTH, HEIGHT);
+    // the first frame faults the destination in
+    cuRTSPConvertFrame(src, dst);
+    frames = 0;
+    start = g_get_monotonic_time();
+    do
+    {
+        cuRTSPConvertFrame(src, dst);
+        frames++;
+        elapsed = g_get_monotonic_time() - start;
+    } while (elapsed < SECONDS * G_USEC_PER_SEC);
+    testImageFree(dst);
+    testImageFree(src);
+
+    return frames * (double)G_USEC_PER_SEC / elapsed;
+}
+
+int main(void)
+{
+    size_t isa;
+    size_t index;
+    double fps;
+
+    for (isa = 0; isa < G_N_ELEMENTS(ISAS); isa++)
+    {
+        if (!cuRTSPConvertForceIsa(ISAS[isa]))
+        {
+            continue;
+        }
+        for (index = 0; index < G_N_ELEMENTS(CASES); index++)
+        {
+            fps = framesPerSecond(&CASES[index]);
+            printf("%-6s %-12s %8.1f fps %8.1f Mpixel/s\n", ISAS[isa], CASES[index].name, fps, fps * WIDTH * HEIGHT / 1e6);
+            TEST_CHECK(fps > 0.0);
+        }
+    }
+
+    return 0;
+}
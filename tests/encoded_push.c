@@ -0,0 +1,172 @@
+#include "harness.h"
+
+#include <string.h>
+
+// access units pushed into an unshared session reach every client in full through one media,
+// and a queue that overflows drops whole GOP tails so the stream resumes at a key unit
+
+#define WIDTH 640
+#define HEIGHT 360
+#define FPS 30
+#define UNITS 90
+#define CLIENTS 2
+#define SECONDS 5
+#define GOP 10
+#define DROP_DEPTH 3
+
+typedef struct pusher_st
+{
+    CUrtsp_session session;
+    const test_access_unit *units;
+    int stopped;
+    uint64_t pushed;
+} pusher;
+
+static gpointer pushLoop(gpointer data)
+{
+    pusher *state;
+    size_t index;
+
+    state = (pusher *)data;
+    for (index = 0; !__atomic_load_n(&state->stopped, __ATOMIC_SEQ_CST); index++)
+    {
+        TEST_CHECK(cuRTSPSessionPushAccessUnit(state->session, state->units[index % UNITS].data, state->units[index % UNITS].size,
+                                               index * GST_SECOND / FPS, state->units[index % UNITS].keyframe) == CUDA_SUCCESS);
+        __atomic_add_fetch(&state->pushed, 1, __ATOMIC_RELAXED);
+    }
+
+    return NULL;
+}
+
+static CUrtsp_session createSession(test_server *server, const char *path, CUrtsp_queue_policy policy, size_t depth)
+{
+    CUDA_RTSP_SESSION create_session;
+    CUrtsp_session session;
+
+    testSessionDefaults(&create_session, WIDTH, HEIGHT);
+    create_session.input = CU_RTSP_INPUT_ENCODED;
+    create_session.writeCallback = NULL;
+    create_session.shared = false;
+    create_session.queuePolicy = policy;
+    create_session.queueDepth = depth;
+    TEST_CHECK(cuRTSPSessionCreate(&session, &create_session) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionMount(session, server->server, path) == CUDA_SUCCESS);
+
+    return session;
+}
+
+// every client of a pushed session reads the one media, none of them loses frames to another
+static void fanout(test_server *server, const test_access_unit *units)
+{
+    CUDA_RTSP_SESSION_STATS stats;
+    test_client *clients[CLIENTS];
+    test_client window;
+    pusher state;
+    GThread *thread;
+    uint64_t pushed;
+    size_t index;
+
+    memset(&state, 0, sizeof(state));
+    state.units = units;
+    state.session = createSession(server, "/pushed", CU_RTSP_QUEUE_BLOCK, 4);
+    for (index = 0; index < CLIENTS; index++)
+    {
+        clients[index] = testClientStart(server->port, "/pushed", "tcp");
+    }
+    thread = g_thread_new("push", pushLoop, &state);
+    for (index = 0; index < CLIENTS; index++)
+    {
+        TEST_CHECK(testClientWait(clients[index], FPS, 20000));
+        testClientReset(clients[index]);
+    }
+    pushed = __atomic_load_n(&state.pushed, __ATOMIC_RELAXED);
+    testSleepMs(SECONDS * 1000);
+    pushed = __atomic_load_n(&state.pushed, __ATOMIC_RELAXED) - pushed;
+    TEST_CHECK(cuRTSPSessionGetStats(state.session, &stats) == CUDA_SUCCESS);
+    printf("%llu access units pushed in %d s, %zu media\n", (unsigned long long)pushed, SECONDS, stats.mediaCount);
+    TEST_CHECK(stats.mediaCount == 1);
+    for (index = 0; index < CLIENTS; index++)
+    {
+        testClientSnapshot(clients[index], &window);
+        printf("client %zu: %llu access units\n", index, (unsigned long long)window.frames);
+        TEST_CHECK(window.frames >= pushed * 0.95);
+    }
+
+    __atomic_store_n(&state.stopped, 1, __ATOMIC_SEQ_CST);
+    g_thread_join(thread);
+    for (index = 0; index < CLIENTS; index++)
+    {
+        testClientStop(clients[index]);
+    }
+    TEST_CHECK(cuRTSPSessionUnmount(state.session, server->server, "/pushed") == CUDA_SUCCESS);
+    cuRTSPSessionDestroy(state.session);
+}
+
+static void pushGop(CUrtsp_session session, const test_access_unit *units, size_t count, uint64_t *pts)
+{
+    size_t index;
+
+    // the key unit flags are the test's own, whatever the encoder chose
+    for (index = 0; index < count; index++)
+    {
+        TEST_CHECK(cuRTSPSessionPushAccessUnit(session, units[index].data, units[index].size, *pts, index == 0) == CUDA_SUCCESS);
+        *pts += GST_SECOND / FPS;
+    }
+}
+
+// with no client nothing drains the queue, so every drop is predictable
+static void dropOldest(test_server *server, const test_access_unit *units)
+{
+    CUDA_RTSP_SESSION_STATS stats;
+    CUrtsp_session session;
+    test_client *client;
+    uint64_t pts;
+
+    session = createSession(server, "/dropped", CU_RTSP_QUEUE_DROP_OLDEST, DROP_DEPTH);
+    pts = 0;
+
+    // the fourth unit evicts the key unit, the deltas behind it and itself, the rest of the GOP waits for a key unit
+    pushGop(session, units, GOP, &pts);
+    TEST_CHECK(cuRTSPSessionGetStats(session, &stats) == CUDA_SUCCESS);
+    TEST_CHECK(stats.framesDropped == GOP);
+    TEST_CHECK(stats.queueDepth == 0);
+
+    // a new key unit starts a decodable queue again
+    pushGop(session, units, DROP_DEPTH, &pts);
+    TEST_CHECK(cuRTSPSessionGetStats(session, &stats) == CUDA_SUCCESS);
+    TEST_CHECK(stats.framesDropped == GOP);
+    TEST_CHECK(stats.queueDepth == DROP_DEPTH);
+
+    client = testClientStart(server->port, "/dropped", "tcp");
+    while (!testClientWait(client, DROP_DEPTH + GOP, 100) && pts < 20 * GST_SECOND)
+    {
+        pushGop(session, units, GOP, &pts);
+        testSleepMs(GOP * 1000 / FPS);
+    }
+    TEST_CHECK(testClientWait(client, DROP_DEPTH + GOP, 1000));
+    TEST_CHECK(cuRTSPSessionGetStats(session, &stats) == CUDA_SUCCESS);
+    printf("drop oldest: %llu access units dropped\n", (unsigned long long)stats.framesDropped);
+
+    testClientStop(client);
+    TEST_CHECK(cuRTSPSessionUnmount(session, server->server, "/dropped") == CUDA_SUCCESS);
+    cuRTSPSessionDestroy(session);
+}
+
+int main(void)
+{
+    test_server server;
+    test_access_unit *units;
+
+    testInit();
+    units = testAccessUnitsEncode(WIDTH, HEIGHT, UNITS, 2000, FPS);
+    testServerStart(&server, NULL);
+
+    fanout(&server, units);
+    dropOldest(&server, units);
+
+    testServerStop(&server);
+    testAccessUnitsFree(units, UNITS);
+    cuRTSPDeinit();
+
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include "harness.h"
+
+#include <unistd.h>
+
+// a session per codec and encoder type announces the matching payload, and tuning the selected
+// encoder does not know fails session creation instead of being ignored
+
+#define FPS 30
+
+static const char *const RTPMAPS[] = {"H264/90000", "H265/90000", "AV1/90000"};
+
+static bool describe(uint16_t port, const char *path, char *response, size_t size)
+{
+    char url[256];
+    int fd;
+    int status;
+
+    fd = testRtspConnect(port, 0);
+    TEST_CHECK(fd >= 0);
+    snprintf(url, sizeof(url), "rtsp://127.0.0.1:%u%s", port, path);
+    status = testRtspRequest(fd, "DESCRIBE", url, "Accept: application/sdp\r\n", response, size);
+    close(fd);
+
+    return status == 200;
+}
+
+static bool createTuned(CUrtsp_rate_control rateControl, const char *preset)
+{
+    CUDA_RTSP_SESSION create_session;
+    CUrtsp_session session;
+    bool created;
+
+    testSessionDefaults(&create_session, 320, 240);
+    create_session.encoder.rateControl = rateControl;
+    create_session.encoder.preset = preset;
+    created = cuRTSPSessionCreate(&session, &create_session) == CUDA_SUCCESS;
+    if (created)
+    {
+        cuRTSPSessionDestroy(session);
+    }
+    else
+    {
+        printf("rate control %d, preset %s: %s\n", (int)rateControl, (preset != NULL) ? preset : "default", cuRTSPGetError());
+    }
+
+    return created;
+}
+
+int main(void)
+{
+    static const CUrtsp_encoder types[] = {CU_RTSP_ENCODER_AUTO, CU_RTSP_ENCODER_SOFTWARE};
+    test_server server;
+    CUDA_RTSP_SESSION create_session;
+    CUrtsp_session session;
+    test_client *client;
+    char response[8192];
+    char path[32];
+    bool x264;
+    int codec;
+    size_t index;
+
+    testInit();
+    testServerStart(&server, NULL);
+
+    for (codec = CU_RTSP_CODEC_H264; codec <= CU_RTSP_CODEC_AV1; codec++)
+    {
+        for (index = 0; index < G_N_ELEMENTS(types); index++)
+        {
+            testSessionDefaults(&create_session, 320, 240);
+            create_session.encoder.codec = (CUrtsp_codec)codec;
+            create_session.encoder.encoder = types[index];
+            if (cuRTSPSessionCreate(&session, &create_session) != CUDA_SUCCESS)
+            {
+                // testInit made sure a software H.264 encoder is installed
+                TEST_CHECK(codec != CU_RTSP_CODEC_H264);
+                printf("%s with encoder type %d skipped: %s\n", RTPMAPS[codec], (int)types[index], cuRTSPGetError());
+                continue;
+            }
+            snprintf(path, sizeof(path), "/codec%d%zu", codec, index);
+            TEST_CHECK(cuRTSPSessionMount(session, server.server, path) == CUDA_SUCCESS);
+            TEST_CHECK(describe(server.port, path, response, sizeof(response)));
+            printf("%s with encoder type %d announced\n", RTPMAPS[codec], (int)types[index]);
+            TEST_CHECK(strstr(response, RTPMAPS[codec]) != NULL);
+            TEST_CHECK(cuRTSPSessionUnmount(session, server.server, path) == CUDA_SUCCESS);
+            cuRTSPSessionDestroy(session);
+        }
+    }
+
+    // x264enc is preferred over openh264enc, which only has bitrate control and no presets
+    x264 = gst_element_factory_find("x264enc") != NULL;
+    TEST_CHECK(createTuned(CU_RTSP_RATE_CONTROL_CBR, NULL));
+    TEST_CHECK(createTuned(CU_RTSP_RATE_CONTROL_VBR, NULL) == x264);
+    TEST_CHECK(createTuned(CU_RTSP_RATE_CONTROL_CQP, NULL) == x264);
+    TEST_CHECK(createTuned(CU_RTSP_RATE_CONTROL_DEFAULT, "veryfast") == x264);
+    TEST_CHECK(!createTuned(CU_RTSP_RATE_CONTROL_DEFAULT, "no-such-preset"));
+    TEST_CHECK(!createTuned((CUrtsp_rate_control)(CU_RTSP_RATE_CONTROL_CQP + 1), NULL));
+
+    // the mapped rate control values are accepted by the running encoder too
+    if (x264)
+    {
+        testSessionDefaults(&create_session, 320, 240);
+        create_session.encoder.rateControl = CU_RTSP_RATE_CONTROL_VBR;
+        TEST_CHECK(cuRTSPSessionCreate(&session, &create_session) == CUDA_SUCCESS);
+        TEST_CHECK(cuRTSPSessionMount(session, server.server, "/vbr") == CUDA_SUCCESS);
+        client = testClientStart(server.port, "/vbr", "udp");
+        TEST_CHECK(testClientWait(client, FPS, 10000));
+        testClientStop(client);
+        cuRTSPSessionDestroy(session);
+    }
+
+    testServerStop(&server);
+    cuRTSPDeinit();
+
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include "harness.h"
+
+#include <string.h>
+
+// application-owned frames with pitched planes stream without a copy into the pool,
+// and every wrapped frame is released exactly once
+
+#define FPS 30
+#define FRAMES 90
+#define WIDTH 320
+#define HEIGHT 240
+#define PITCH (WIDTH + 64)
+
+typedef struct external_frame_st
+{
+    uint8_t *data;
+    int released;
+} external_frame;
+
+static int RELEASED = 0;
+
+static void CUDA_CB releaseFrame(void *user_data)
+{
+    external_frame *frame;
+
+    frame = (external_frame *)user_data;
+    TEST_CHECK(__atomic_fetch_add(&frame->released, 1, __ATOMIC_SEQ_CST) == 0);
+    __atomic_fetch_add(&RELEASED, 1, __ATOMIC_SEQ_CST);
+}
+
+static void frameDescribe(external_frame *frame, CUDA_RTSP_FRAME *pFrame)
+{
+    memset(pFrame, 0, sizeof(CUDA_RTSP_FRAME));
+    pFrame->planes[0] = (CUdeviceptr)frame->data;
+    pFrame->planes[1] = (CUdeviceptr)(frame->data + PITCH * HEIGHT);
+    pFrame->planes[2] = (CUdeviceptr)(frame->data + PITCH * HEIGHT + PITCH / 2 * HEIGHT / 2);
+    pFrame->pitches[0] = PITCH;
+    pFrame->pitches[1] = PITCH / 2;
+    pFrame->pitches[2] = PITCH / 2;
+    pFrame->releaseCallback = releaseFrame;
+    pFrame->userData = frame;
+}
+
+int main(void)
+{
+    test_server server;
+    CUDA_RTSP_SESSION create_session;
+    CUDA_RTSP_FRAME desc;
+    CUrtsp_session session;
+    CUrtsp_session callback_session;
+    test_client *client;
+    external_frame *frames;
+    int pushed;
+    size_t index;
+
+    testInit();
+    testServerStart(&server, NULL);
+
+    testSessionDefaults(&create_session, WIDTH, HEIGHT);
+    create_session.input = CU_RTSP_INPUT_PUSH;
+    create_session.queueDepth = 4;
+    create_session.queuePolicy = CU_RTSP_QUEUE_DROP_OLDEST;
+    create_session.writeCallback = NULL;
+    TEST_CHECK(cuRTSPSessionCreate(&session, &create_session) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionMount(session, server.server, "/external") == CUDA_SUCCESS);
+
+    frames = calloc(FRAMES, sizeof(external_frame));
+    TEST_CHECK(frames != NULL);
+    for (index = 0; index < FRAMES; index++)
+    {
+        frames[index].data = malloc(PITCH * HEIGHT * 2);
+        TEST_CHECK(frames[index].data != NULL);
+        memset(frames[index].data, (int)index, PITCH * HEIGHT * 2);
+    }
+
+    // a plane before planes[0] is refused and the application keeps its memory
+    frameDescribe(&frames[0], &desc);
+    desc.planes[1] = desc.planes[0] - 1;
+    TEST_CHECK(cuRTSPSessionPushExternalFrame(session, &desc) == CUDA_ERROR_INVALID_VALUE);
+    TEST_CHECK(cuRTSPSessionPushExternalFrame(session, NULL) == CUDA_ERROR_INVALID_VALUE);
+    TEST_CHECK(__atomic_load_n(&RELEASED, __ATOMIC_SEQ_CST) == 0);
+
+    testSessionDefaults(&create_session, WIDTH, HEIGHT);
+    TEST_CHECK(cuRTSPSessionCreate(&callback_session, &create_session) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionPushExternalFrame(callback_session, &desc) == CUDA_ERROR_INVALID_VALUE);
+    cuRTSPSessionDestroy(callback_session);
+
+    client = testClientStart(server.port, "/external", "udp");
+    pushed = 0;
+    for (index = 0; index < FRAMES; index++)
+    {
+        frameDescribe(&frames[index], &desc);
+        if (cuRTSPSessionPushExternalFrame(session, &desc) == CUDA_SUCCESS)
+        {
+            pushed++;
+        }
+        testSleepMs(1000 / FPS);
+    }
+    TEST_CHECK(testClientWait(client, FPS / 2, 10000));
+    testClientStop(client);
+    cuRTSPSessionDestroy(session);
+
+    printf("%d frames pushed, %d released\n", pushed, __atomic_load_n(&RELEASED, __ATOMIC_SEQ_CST));
+    TEST_CHECK(pushed > FRAMES / 2);
+    TEST_CHECK(__atomic_load_n(&RELEASED, __ATOMIC_SEQ_CST) == pushed);
+    for (index = 0; index < FRAMES; index++)
+    {
+        free(frames[index].data);
+    }
+    free(frames);
+
+    testServerStop(&server);
+    cuRTSPDeinit();
+
+    return 0;
+}
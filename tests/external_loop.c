@@ -0,0 +1,146 @@
+#include "harness.h"
+
+#include <string.h>
+
+#include <poll.h>
+#include <unistd.h>
+
+// OPTIONS round trips through the server's own dispatch thread and through a caller's poll(2) loop,
+// then a stream served entirely from the caller's loop
+
+#define REQUESTS 1000
+#define MAX_FDS 64
+
+typedef struct external_st
+{
+    CUrtsp_server server;
+    int stopped;
+    uint64_t iterations;
+} external;
+
+static gpointer pollLoop(gpointer data)
+{
+    external *state;
+    CUDA_RTSP_POLLFD fds[MAX_FDS];
+    struct pollfd pfds[MAX_FDS];
+    size_t count;
+    size_t index;
+    int timeout;
+
+    state = (external *)data;
+    while (!__atomic_load_n(&state->stopped, __ATOMIC_SEQ_CST))
+    {
+        count = MAX_FDS;
+        TEST_CHECK(cuRTSPServerPrepare(state->server, fds, &count, &timeout) == CUDA_SUCCESS);
+        for (index = 0; index < count; index++)
+        {
+            pfds[index].fd = fds[index].fd;
+            pfds[index].events = (short)fds[index].events;
+            pfds[index].revents = 0;
+        }
+        // bounded so the stop flag is seen
+        poll(pfds, count, (timeout < 0 || timeout > 50) ? 50 : timeout);
+        for (index = 0; index < count; index++)
+        {
+            fds[index].revents = (unsigned short)pfds[index].revents;
+        }
+        TEST_CHECK(cuRTSPServerIterate(state->server, fds, count) == CUDA_SUCCESS);
+        state->iterations++;
+    }
+
+    return NULL;
+}
+
+static int compareDouble(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+// fills p50 and p99 of OPTIONS round trips in milliseconds
+static void measureOptions(uint16_t port, double *pP50, double *pP99)
+{
+    static double samples[REQUESTS];
+    char response[4096];
+    char url[64];
+    gint64 start;
+    size_t index;
+    int fd;
+
+    snprintf(url, sizeof(url), "rtsp://127.0.0.1:%u/loop", port);
+    fd = testRtspConnect(port, 0);
+    TEST_CHECK(fd >= 0);
+    for (index = 0; index < REQUESTS; index++)
+    {
+        start = g_get_monotonic_time();
+        TEST_CHECK(testRtspRequest(fd, "OPTIONS", url, "", response, sizeof(response)) == 200);
+        samples[index] = (g_get_monotonic_time() - start) / 1000.0;
+    }
+    close(fd);
+    qsort(samples, REQUESTS, sizeof(samples[0]), compareDouble);
+    *pP50 = samples[REQUESTS / 2];
+    *pP99 = samples[REQUESTS * 99 / 100];
+}
+
+static CUrtsp_session mountLoop(CUrtsp_server server)
+{
+    CUDA_RTSP_SESSION create_session;
+    CUrtsp_session session;
+
+    testSessionDefaults(&create_session, 640, 360);
+    TEST_CHECK(cuRTSPSessionCreate(&session, &create_session) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionMount(session, server, "/loop") == CUDA_SUCCESS);
+
+    return session;
+}
+
+int main(void)
+{
+    CUDA_RTSP_SERVER create_server = {0};
+    test_server server;
+    external state;
+    CUrtsp_session session;
+    test_client *client;
+    GThread *thread;
+    double dispatch_p50;
+    double dispatch_p99;
+    double external_p50;
+    double external_p99;
+
+    testInit();
+
+    testServerStart(&server, NULL);
+    session = mountLoop(server.server);
+    measureOptions(server.port, &dispatch_p50, &dispatch_p99);
+    cuRTSPSessionDestroy(session);
+    testServerStop(&server);
+
+    memset(&state, 0, sizeof(state));
+    create_server.host = "127.0.0.1";
+    create_server.port = testFreePort();
+    TEST_CHECK(cuRTSPServerCreate(&state.server, &create_server) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPServerAttachExternal(state.server) == CUDA_SUCCESS);
+    session = mountLoop(state.server);
+    thread = g_thread_new("poll-loop", pollLoop, &state);
+    measureOptions(create_server.port, &external_p50, &external_p99);
+
+    // RTSP and the media's own sources all run from the caller's loop
+    client = testClientStart(create_server.port, "/loop", "tcp");
+    TEST_CHECK(testClientWait(client, 30, 10000));
+    testClientStop(client);
+    cuRTSPSessionDestroy(session);
+
+    __atomic_store_n(&state.stopped, 1, __ATOMIC_SEQ_CST);
+    g_thread_join(thread);
+    printf("OPTIONS round trip: dispatch thread p50 %.3f ms p99 %.3f ms, external loop p50 %.3f ms p99 %.3f ms, %llu iterations\n",
+           dispatch_p50, dispatch_p99, external_p50, external_p99, (unsigned long long)state.iterations);
+    // a request must wake the loop at once, never wait out the bounded poll
+    TEST_CHECK(external_p50 < 25.0);
+
+    cuRTSPServerDestroy(state.server);
+    cuRTSPDeinit();
+
+    return 0;
+}
@@ -0,0 +1,581 @@
+#include "harness.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static CUdevice DEVICE;
+static CUcontext CONTEXT = NULL;
+static uint8_t FRAME_VALUE = 0;
+static int CSEQ = 0;
+
+static gpointer testServerRun(gpointer data);
+
+static GstPadProbeReturn testClientFrame(GstPad *pad, GstPadProbeInfo *info, gpointer user_data);
+
+static bool testRtspRead(int fd, void *data, size_t size);
+
+static bool testRtspHeader(const char *response, const char *name, char *value, size_t size);
+
+void testInit(void)
+{
+    static const char *const elements[] = {"rtspsrc", "rtph264depay", "fakesink"};
+    size_t index;
+
+    TEST_CHECK(cuRTSPInit() == CUDA_SUCCESS);
+    for (index = 0; index < G_N_ELEMENTS(elements); index++)
+    {
+        if (!gst_element_factory_find(elements[index]))
+        {
+            printf("skipped, %s is not installed\n", elements[index]);
+            exit(TEST_SKIP);
+        }
+    }
+    if (!gst_element_factory_find("x264enc") && !gst_element_factory_find("openh264enc"))
+    {
+        printf("skipped, no software H.264 encoder is installed\n");
+        exit(TEST_SKIP);
+    }
+    TEST_CHECK(cuDeviceGet(&DEVICE, 0) == CUDA_SUCCESS);
+    TEST_CHECK(cuCtxCreate(&CONTEXT, 0, DEVICE) == CUDA_SUCCESS);
+}
+
+CUdevice testDevice(void)
+{
+    return DEVICE;
+}
+
+CUcontext testContext(void)
+{
+    return CONTEXT;
+}
+
+void testSleepMs(unsigned int ms)
+{
+    g_usleep((gulong)ms * 1000);
+}
+
+uint16_t testFreePort(void)
+{
+    struct sockaddr_in address;
+    socklen_t length;
+    int fd;
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    TEST_CHECK(fd >= 0);
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    TEST_CHECK(bind(fd, (struct sockaddr *)&address, sizeof(address)) == 0);
+    length = sizeof(address);
+    TEST_CHECK(getsockname(fd, (struct sockaddr *)&address, &length) == 0);
+    close(fd);
+
+    return ntohs(address.sin_port);
+}
+
+void testSessionDefaults(CUDA_RTSP_SESSION *pInfo, size_t width, size_t height)
+{
+    memset(pInfo, 0, sizeof(*pInfo));
+    pInfo->device = DEVICE;
+    pInfo->context = CONTEXT;
+    pInfo->width = width;
+    pInfo->height = height;
+    pInfo->format = CU_RTSP_FORMAT_I420;
+    pInfo->fpsNum = 30;
+    pInfo->fpsDen = 1;
+    pInfo->live = true;
+    pInfo->encoder.encoder = CU_RTSP_ENCODER_SOFTWARE;
+    pInfo->writeCallback = testWriteFrame;
+}
+
+void CUDA_CB testWriteFrame(CUdeviceptr buffer, size_t size, void *user_data)
+{
+    memset((void *)buffer, __atomic_add_fetch(&FRAME_VALUE, 1, __ATOMIC_RELAXED), size);
+}
+
+void testServerStart(test_server *pServer, const CUDA_RTSP_SERVER *pCreateServer)
+{
+    CUDA_RTSP_SERVER create_server;
+
+    memset(&create_server, 0, sizeof(create_server));
+    if (pCreateServer != NULL)
+    {
+        create_server = *pCreateServer;
+    }
+    create_server.host = "127.0.0.1";
+    create_server.port = testFreePort();
+    pServer->port = create_server.port;
+    TEST_CHECK(cuRTSPServerCreate(&pServer->server, &create_server) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPServerAttach(pServer->server) == CUDA_SUCCESS);
+    __atomic_store_n(&pServer->running, 1, __ATOMIC_SEQ_CST);
+    pServer->thread = g_thread_new("test-server", testServerRun, pServer);
+}
+
+void testServerStop(test_server *pServer)
+{
+    // a quit before the loop started running is lost, so it is repeated until the thread returns
+    while (__atomic_load_n(&pServer->running, __ATOMIC_SEQ_CST))
+    {
+        cuRTSPServerShutdown(pServer->server);
+        testSleepMs(10);
+    }
+    g_thread_join(pServer->thread);
+    cuRTSPServerDestroy(pServer->server);
+}
+
+test_client *testClientCreate(uint16_t port, const char *path, const char *protocols)
+{
+    test_client *client;
+    GstElement *sink;
+    GstPad *pad;
+    gchar *description;
+
+    client = g_new0(test_client, 1);
+    g_mutex_init(&client->lock);
+    description = g_strdup_printf(
+        "rtspsrc location=rtsp://127.0.0.1:%u%s protocols=%s latency=0 ! rtph264depay ! fakesink name=sink sync=false",
+        port, path, protocols);
+    client->pipeline = gst_parse_launch(description, NULL);
+    g_free(description);
+    TEST_CHECK(client->pipeline != NULL);
+    sink = gst_bin_get_by_name(GST_BIN(client->pipeline), "sink");
+    pad = gst_element_get_static_pad(sink, "sink");
+    gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, testClientFrame, client, NULL);
+    gst_object_unref(pad);
+    gst_object_unref(sink);
+
+    return client;
+}
+
+void testClientPlay(test_client *client)
+{
+    client->started = g_get_monotonic_time();
+    TEST_CHECK(gst_element_set_state(client->pipeline, GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+}
+
+test_client *testClientStart(uint16_t port, const char *path, const char *protocols)
+{
+    test_client *client;
+
+    client = testClientCreate(port, path, protocols);
+    testClientPlay(client);
+
+    return client;
+}
+
+void testClientStop(test_client *client)
+{
+    gst_element_set_state(client->pipeline, GST_STATE_NULL);
+    gst_object_unref(client->pipeline);
+    g_mutex_clear(&client->lock);
+    g_free(client);
+}
+
+bool testClientWait(test_client *client, uint64_t count, unsigned int timeout_ms)
+{
+    gint64 end_time;
+    uint64_t frames;
+
+    end_time = g_get_monotonic_time() + (gint64)timeout_ms * 1000;
+    do
+    {
+        g_mutex_lock(&client->lock);
+        frames = client->frames;
+        g_mutex_unlock(&client->lock);
+        if (frames >= count)
+        {
+            return true;
+        }
+        testSleepMs(10);
+    } while (g_get_monotonic_time() < end_time);
+
+    return false;
+}
+
+void testClientReset(test_client *client)
+{
+    g_mutex_lock(&client->lock);
+    client->frames = 0;
+    client->last_frame = 0;
+    memset(&client->intervals, 0, sizeof(client->intervals));
+    g_mutex_unlock(&client->lock);
+}
+
+void testClientSnapshot(test_client *client, test_client *pCopy)
+{
+    g_mutex_lock(&client->lock);
+    *pCopy = *client;
+    g_mutex_unlock(&client->lock);
+}
+
+test_access_unit *testAccessUnitsEncode(size_t width, size_t height, size_t count, unsigned int bitrate, unsigned int gop)
+{
+    static const char *const elements[] = {"x264enc", "h264parse", "appsink"};
+    test_access_unit *units;
+    GstElement *pipeline;
+    GstElement *sink;
+    GstSample *sample;
+    GstBuffer *buffer;
+    gchar *description;
+    size_t index;
+
+    for (index = 0; index < G_N_ELEMENTS(elements); index++)
+    {
+        if (!gst_element_factory_find(elements[index]))
+        {
+            printf("skipped, %s is not installed\n", elements[index]);
+            exit(TEST_SKIP);
+        }
+    }
+    description = g_strdup_printf(
+        "videotestsrc pattern=snow num-buffers=%zu ! video/x-raw,format=I420,width=%zu,height=%zu,framerate=30/1 ! "
+        "x264enc tune=zerolatency speed-preset=ultrafast bitrate=%u key-int-max=%u ! h264parse ! "
+        "video/x-h264,stream-format=byte-stream,alignment=au ! appsink name=sink sync=false",
+        count, width, height, bitrate, gop);
+    pipeline = gst_parse_launch(description, NULL);
+    g_free(description);
+    TEST_CHECK(pipeline != NULL);
+    sink = gst_bin_get_by_name(GST_BIN(pipeline), "sink");
+    TEST_CHECK(gst_element_set_state(pipeline, GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+    units = g_new0(test_access_unit, count);
+    for (index = 0; index < count; index++)
+    {
+        // the action signal spares the tests a link to the app library
+        sample = NULL;
+        g_signal_emit_by_name(sink, "pull-sample", &sample);
+        TEST_CHECK(sample != NULL);
+        buffer = gst_sample_get_buffer(sample);
+        units[index].size = gst_buffer_get_size(buffer);
+        units[index].data = g_malloc(units[index].size);
+        gst_buffer_extract(buffer, 0, units[index].data, units[index].size);
+        units[index].keyframe = !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+        gst_sample_unref(sample);
+    }
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(sink);
+    gst_object_unref(pipeline);
+
+    return units;
+}
+
+void testAccessUnitsFree(test_access_unit *units, size_t count)
+{
+    size_t index;
+
+    for (index = 0; index < count; index++)
+    {
+        g_free(units[index].data);
+    }
+    g_free(units);
+}
+
+int testRtspConnect(uint16_t port, int receive_buffer)
+{
+    struct sockaddr_in address;
+    int fd;
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    TEST_CHECK(fd >= 0);
+    if (receive_buffer > 0)
+    {
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer));
+    }
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+int testRtspRequest(int fd, const char *method, const char *url, const char *headers, char *response, size_t size)
+{
+    gchar *request;
+    char length[32];
+    size_t used;
+    size_t body;
+    uint8_t frame[4];
+    uint8_t skipped[1500];
+    size_t remaining;
+    bool sent;
+    int status;
+
+    request = g_strdup_printf("%s %s RTSP/1.0\r\nCSeq: %d\r\n%s\r\n", method, url, __atomic_add_fetch(&CSEQ, 1, __ATOMIC_RELAXED), headers);
+    sent = send(fd, request, strlen(request), MSG_NOSIGNAL) == (ssize_t)strlen(request);
+    g_free(request);
+    if (!sent)
+    {
+        return 0;
+    }
+
+    // interleaved packets may arrive ahead of the response
+    used = 0;
+    while (used < 4 || memcmp(response + used - 4, "\r\n\r\n", 4) != 0)
+    {
+        if (used + 1 >= size || !testRtspRead(fd, response + used, 1))
+        {
+            return 0;
+        }
+        if (used == 0 && response[0] == '$')
+        {
+            if (!testRtspRead(fd, frame, 3))
+            {
+                return 0;
+            }
+            for (remaining = ((size_t)frame[1] << 8) | frame[2]; remaining > 0; remaining -= MIN(remaining, sizeof(skipped)))
+            {
+                if (!testRtspRead(fd, skipped, MIN(remaining, sizeof(skipped))))
+                {
+                    return 0;
+                }
+            }
+            continue;
+        }
+        used++;
+    }
+    body = testRtspHeader(response, "Content-Length", length, sizeof(length)) ? strtoul(length, NULL, 10) : 0;
+    if (used + body >= size || !testRtspRead(fd, response + used, body))
+    {
+        return 0;
+    }
+    response[used + body] = '\0';
+
+    return (sscanf(response, "RTSP/1.0 %d", &status) == 1) ? status : 0;
+}
+
+bool testRtspPlay(int fd, uint16_t port, const char *path, const char *transport, char *session, size_t size)
+{
+    char response[8192];
+    char base[256];
+    char url[512];
+    char control[256];
+    char *media;
+    char *line;
+    gchar *headers;
+    int status;
+
+    snprintf(url, sizeof(url), "rtsp://127.0.0.1:%u%s", port, path);
+    if (testRtspRequest(fd, "DESCRIBE", url, "Accept: application/sdp\r\n", response, sizeof(response)) != 200)
+    {
+        return false;
+    }
+    if (!testRtspHeader(response, "Content-Base", base, sizeof(base)))
+    {
+        snprintf(base, sizeof(base), "%s/", url);
+    }
+    // the first stream's control attribute follows its m= line
+    media = strstr(response, "\nm=");
+    line = (media != NULL) ? strstr(media, "a=control:") : NULL;
+    if (line == NULL || sscanf(line, "a=control:%255[^\r\n]", control) != 1)
+    {
+        return false;
+    }
+    if (strncmp(control, "rtsp://", 7) == 0)
+    {
+        snprintf(url, sizeof(url), "%s", control);
+    }
+    else
+    {
+        snprintf(url, sizeof(url), "%s%s", base, control);
+    }
+
+    headers = g_strdup_printf("Transport: %s\r\n", transport);
+    status = testRtspRequest(fd, "SETUP", url, headers, response, sizeof(response));
+    g_free(headers);
+    if (status != 200 || !testRtspHeader(response, "Session", session, size))
+    {
+        return false;
+    }
+    session[strcspn(session, ";")] = '\0';
+
+    snprintf(url, sizeof(url), "rtsp://127.0.0.1:%u%s", port, path);
+    headers = g_strdup_printf("Session: %s\r\nRange: npt=0-\r\n", session);
+    status = testRtspRequest(fd, "PLAY", url, headers, response, sizeof(response));
+    g_free(headers);
+
+    return status == 200;
+}
+
+CUrtsp_image *testImageNew(CUrtsp_format format, uint32_t width, uint32_t height)
+{
+    CUrtsp_image *image;
+    size_t row_bytes[CU_RTSP_MAX_PLANES] = {0};
+    size_t rows[CU_RTSP_MAX_PLANES] = {0};
+    size_t plane;
+    size_t index;
+
+    switch (format)
+    {
+    case CU_RTSP_FORMAT_NV12:
+        row_bytes[0] = width;
+        rows[0] = height;
+        row_bytes[1] = (width + 1) & ~1u;
+        rows[1] = (height + 1) / 2;
+        break;
+    case CU_RTSP_FORMAT_YV12:
+    case CU_RTSP_FORMAT_I420:
+        row_bytes[0] = width;
+        rows[0] = height;
+        row_bytes[1] = row_bytes[2] = (width + 1) / 2;
+        rows[1] = rows[2] = (height + 1) / 2;
+        break;
+    case CU_RTSP_FORMAT_Y444:
+        row_bytes[0] = row_bytes[1] = row_bytes[2] = width;
+        rows[0] = rows[1] = rows[2] = height;
+        break;
+    case CU_RTSP_FORMAT_BGR:
+    case CU_RTSP_FORMAT_RGB:
+        row_bytes[0] = (size_t)width * 3;
+        rows[0] = height;
+        break;
+    default:
+        row_bytes[0] = (size_t)width * 4;
+        rows[0] = height;
+        break;
+    }
+    image = g_new0(CUrtsp_image, 1);
+    image->format = format;
+    image->width = width;
+    image->height = height;
+    for (plane = 0; plane < CU_RTSP_MAX_PLANES && rows[plane] > 0; plane++)
+    {
+        image->pitches[plane] = row_bytes[plane] + 24;
+        image->planes[plane] = g_malloc(image->pitches[plane] * rows[plane]);
+        for (index = 0; index < image->pitches[plane] * rows[plane]; index++)
+        {
+            image->planes[plane][index] = (uint8_t)g_random_int();
+        }
+    }
+
+    return image;
+}
+
+void testImageFree(CUrtsp_image *image)
+{
+    size_t plane;
+
+    for (plane = 0; plane < CU_RTSP_MAX_PLANES; plane++)
+    {
+        g_free(image->planes[plane]);
+    }
+    g_free(image);
+}
+
+void testTimingAdd(test_timing *timing, double value)
+{
+    timing->count++;
+    timing->sum += value;
+    timing->squares += value * value;
+    timing->max = MAX(timing->max, value);
+}
+
+double testTimingMean(const test_timing *timing)
+{
+    return (timing->count > 0) ? timing->sum / timing->count : 0.0;
+}
+
+double testTimingDeviation(const test_timing *timing)
+{
+    double mean;
+
+    if (timing->count < 2)
+    {
+        return 0.0;
+    }
+    mean = testTimingMean(timing);
+
+    return sqrt(MAX(timing->squares / timing->count - mean * mean, 0.0));
+}
+
+static gpointer testServerRun(gpointer data)
+{
+    test_server *server;
+
+    server = (test_server *)data;
+    cuRTSPServerDispatch(server->server);
+    __atomic_store_n(&server->running, 0, __ATOMIC_SEQ_CST);
+
+    return NULL;
+}
+
+static bool testRtspRead(int fd, void *data, size_t size)
+{
+    ssize_t count;
+    size_t used;
+
+    for (used = 0; used < size; used += (size_t)count)
+    {
+        count = recv(fd, (uint8_t *)data + used, size - used, 0);
+        if (count <= 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool testRtspHeader(const char *response, const char *name, char *value, size_t size)
+{
+    const char *line;
+    size_t length;
+
+    length = strlen(name);
+    for (line = strstr(response, "\r\n"); line != NULL && strncmp(line, "\r\n\r\n", 4) != 0; line = strstr(line + 2, "\r\n"))
+    {
+        if (g_ascii_strncasecmp(line + 2, name, length) == 0 && line[2 + length] == ':')
+        {
+            line += 3 + length;
+            line += strspn(line, " ");
+            length = strcspn(line, "\r\n");
+            if (length >= size)
+            {
+                return false;
+            }
+            memcpy(value, line, length);
+            value[length] = '\0';
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static GstPadProbeReturn testClientFrame(GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+    test_client *client;
+    GstBuffer *buffer;
+    gint64 now;
+
+    client = (test_client *)user_data;
+    buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    now = g_get_monotonic_time();
+    g_mutex_lock(&client->lock);
+    if (client->first_frame == 0)
+    {
+        client->first_frame = now;
+    }
+    if (client->first_keyframe == 0 && !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT))
+    {
+        client->first_keyframe = now;
+    }
+    if (client->last_frame != 0)
+    {
+        testTimingAdd(&client->intervals, (double)(now - client->last_frame) / 1000.0);
+    }
+    client->last_frame = now;
+    client->frames++;
+    g_mutex_unlock(&client->lock);
+
+    return GST_PAD_PROBE_OK;
+}
@@ -0,0 +1,129 @@
+#ifndef CUDA_RTSP_TEST_HARNESS_H
+#define CUDA_RTSP_TEST_HARNESS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <gst/gst.h>
+
+#include <cuda_rtsp.h>
+#include <cuda_rtsp_convert.h>
+
+#define TEST_SKIP 77
+
+// stays on in release builds, unlike assert
+#define TEST_CHECK(condition)                                                             \
+    do                                                                                    \
+    {                                                                                     \
+        if (!(condition))                                                                 \
+        {                                                                                 \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            exit(1);                                                                      \
+        }                                                                                 \
+    } while (0)
+
+typedef struct test_timing_st
+{
+    uint64_t count;
+    double sum;
+    double squares;
+    double max;
+} test_timing;
+
+typedef struct test_server_st
+{
+    CUrtsp_server server;
+    uint16_t port;
+    GThread *thread;
+    int running;
+} test_server;
+
+// an rtspsrc pipeline that depayloads H.264 and times every access unit it receives
+typedef struct test_client_st
+{
+    GstElement *pipeline;
+    GMutex lock;
+    gint64 started;
+    gint64 first_frame;
+    gint64 first_keyframe;
+    gint64 last_frame;
+    uint64_t frames;
+    test_timing intervals;
+} test_client;
+
+typedef struct test_access_unit_st
+{
+    void *data;
+    size_t size;
+    bool keyframe;
+} test_access_unit;
+
+// initializes the library and the host device, exits with TEST_SKIP when an element is missing
+void testInit(void);
+
+CUdevice testDevice(void);
+
+CUcontext testContext(void);
+
+void testSleepMs(unsigned int ms);
+
+uint16_t testFreePort(void);
+
+// a 30 fps I420 callback session on the software encoder
+void testSessionDefaults(CUDA_RTSP_SESSION *pInfo, size_t width, size_t height);
+
+// fills the frame with a value that changes every call so the encoder has work to do
+void CUDA_CB testWriteFrame(CUdeviceptr buffer, size_t size, void *user_data);
+
+// pCreateServer may be NULL, the port is always a free one
+void testServerStart(test_server *pServer, const CUDA_RTSP_SERVER *pCreateServer);
+
+void testServerStop(test_server *pServer);
+
+// protocols is an rtspsrc protocols value such as "udp" or "tcp"
+test_client *testClientStart(uint16_t port, const char *path, const char *protocols);
+
+// the client before it plays, for tests that hook its pipeline first
+test_client *testClientCreate(uint16_t port, const char *path, const char *protocols);
+
+void testClientPlay(test_client *client);
+
+void testClientStop(test_client *client);
+
+// false when the client did not receive count frames within timeout_ms
+bool testClientWait(test_client *client, uint64_t count, unsigned int timeout_ms);
+
+// frames and arrival intervals start counting again
+void testClientReset(test_client *client);
+
+void testClientSnapshot(test_client *client, test_client *pCopy);
+
+// count Annex-B H.264 access units of a snow pattern from x264enc, exits with TEST_SKIP when it is missing,
+// free with testAccessUnitsFree
+test_access_unit *testAccessUnitsEncode(size_t width, size_t height, size_t count, unsigned int bitrate, unsigned int gop);
+
+void testAccessUnitsFree(test_access_unit *units, size_t count);
+
+// a plain RTSP connection for what rtspsrc cannot do, a non-zero receive_buffer is set before connecting
+int testRtspConnect(uint16_t port, int receive_buffer);
+
+// sends one request and reads its response into response, returns the status code or 0 when the connection broke,
+// headers is empty or CRLF-terminated header lines
+int testRtspRequest(int fd, const char *method, const char *url, const char *headers, char *response, size_t size);
+
+// DESCRIBE, SETUP with the given Transport header value and PLAY, the session id is left in session
+bool testRtspPlay(int fd, uint16_t port, const char *path, const char *transport, char *session, size_t size);
+
+// planes padded past the row so converters cannot rely on tight pitches, filled with random bytes
+CUrtsp_image *testImageNew(CUrtsp_format format, uint32_t width, uint32_t height);
+
+void testImageFree(CUrtsp_image *image);
+
+void testTimingAdd(test_timing *timing, double value);
+
+double testTimingMean(const test_timing *timing);
+
+double testTimingDeviation(const test_timing *timing);
+
+#endif
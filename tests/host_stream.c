@@ -0,0 +1,56 @@
+#include "harness.h"
+
+// the host backend serves a session end to end without a GPU and reports
+// the stream's throughput and the session's latency histograms
+
+#define FPS 30
+#define SECONDS 5
+
+static void printHistogram(const char *name, const CUDA_RTSP_HISTOGRAM *histogram)
+{
+    printf("%-9s %6llu samples, mean %8.1f us, max %8llu us\n", name, (unsigned long long)histogram->count,
+           (histogram->count > 0) ? (double)histogram->sum / histogram->count : 0.0, (unsigned long long)histogram->max);
+}
+
+int main(void)
+{
+    test_server server;
+    CUDA_RTSP_SESSION create_session;
+    CUDA_RTSP_SESSION_STATS stats;
+    CUrtsp_session session;
+    test_client *client;
+    test_client window;
+
+    testInit();
+    testServerStart(&server, NULL);
+
+    testSessionDefaults(&create_session, 1280, 720);
+    TEST_CHECK(cuRTSPSessionCreate(&session, &create_session) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionMount(session, server.server, "/host") == CUDA_SUCCESS);
+
+    client = testClientStart(server.port, "/host", "udp");
+    TEST_CHECK(testClientWait(client, 1, 10000));
+    testClientSnapshot(client, &window);
+    printf("first frame after %.1f ms\n", (double)(window.first_frame - window.started) / 1000.0);
+    testClientReset(client);
+    testSleepMs(SECONDS * 1000);
+    testClientSnapshot(client, &window);
+
+    TEST_CHECK(cuRTSPSessionGetStats(session, &stats) == CUDA_SUCCESS);
+    printf("%.1f fps, interval deviation %.2f ms\n", (double)window.frames / SECONDS, testTimingDeviation(&window.intervals));
+    printHistogram("callback", &stats.callbackLatency);
+    printHistogram("acquire", &stats.acquireLatency);
+    printHistogram("encode", &stats.encodeLatency);
+    printHistogram("capture", &stats.captureLatency);
+
+    TEST_CHECK(window.frames >= FPS * SECONDS * 0.8);
+    TEST_CHECK(stats.framesEncoded > 0);
+    TEST_CHECK(stats.callbackLatency.count > 0);
+
+    testClientStop(client);
+    cuRTSPSessionDestroy(session);
+    testServerStop(&server);
+    cuRTSPDeinit();
+
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include "harness.h"
+
+// a producer that never changes its frame is encoded again only at the idle interval,
+// zero meaning the keyframe interval
+
+#define FPS 30
+#define SECONDS 3
+
+static uint64_t CALLS = 0;
+
+static CUrtsp_frame_status CUDA_CB unchangedFrame(CUdeviceptr buffer, size_t size, CUrtsp_rect *dirty, void *user_data)
+{
+    if (__atomic_fetch_add(&CALLS, 1, __ATOMIC_RELAXED) == 0)
+    {
+        testWriteFrame(buffer, size, user_data);
+        return CU_RTSP_FRAME_NEW;
+    }
+
+    return CU_RTSP_FRAME_UNCHANGED;
+}
+
+static uint64_t encodedFrames(test_server *server, unsigned int idle_ms, unsigned int gop)
+{
+    CUDA_RTSP_SESSION create_session;
+    CUDA_RTSP_SESSION_STATS before;
+    CUDA_RTSP_SESSION_STATS after;
+    CUrtsp_session session;
+    test_client *client;
+
+    __atomic_store_n(&CALLS, 0, __ATOMIC_RELAXED);
+    testSessionDefaults(&create_session, 320, 240);
+    create_session.writeCallback = NULL;
+    create_session.updateCallback = unchangedFrame;
+    create_session.idleIntervalMs = idle_ms;
+    create_session.encoder.gopLength = gop;
+    TEST_CHECK(cuRTSPSessionCreate(&session, &create_session) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionMount(session, server->server, "/idle") == CUDA_SUCCESS);
+
+    client = testClientStart(server->port, "/idle", "udp");
+    TEST_CHECK(testClientWait(client, 1, 20000));
+    TEST_CHECK(cuRTSPSessionGetStats(session, &before) == CUDA_SUCCESS);
+    testSleepMs(SECONDS * 1000);
+    TEST_CHECK(cuRTSPSessionGetStats(session, &after) == CUDA_SUCCESS);
+    printf("idle %u ms, gop %u: %llu frames encoded, %llu producer calls\n", idle_ms, gop,
+           (unsigned long long)(after.framesEncoded - before.framesEncoded), (unsigned long long)__atomic_load_n(&CALLS, __ATOMIC_RELAXED));
+    // the producer is still asked every frame period
+    TEST_CHECK(__atomic_load_n(&CALLS, __ATOMIC_RELAXED) >= FPS * SECONDS / 2);
+
+    testClientStop(client);
+    TEST_CHECK(cuRTSPSessionUnmount(session, server->server, "/idle") == CUDA_SUCCESS);
+    cuRTSPSessionDestroy(session);
+
+    return after.framesEncoded - before.framesEncoded;
+}
+
+int main(void)
+{
+    test_server server;
+    uint64_t encoded;
+
+    testInit();
+    testServerStart(&server, NULL);
+
+    // no GOP holds the frame for five seconds
+    encoded = encodedFrames(&server, 0, 0);
+    TEST_CHECK(encoded <= 1);
+
+    // a one second GOP repeats the frame once a second
+    encoded = encodedFrames(&server, 0, FPS);
+    TEST_CHECK(encoded >= SECONDS - 1 && encoded <= SECONDS + 1);
+
+    encoded = encodedFrames(&server, 100, 0);
+    TEST_CHECK(encoded >= SECONDS * 10 / 2 && encoded <= SECONDS * 10 + 2);
+
+    testServerStop(&server);
+    cuRTSPDeinit();
+
+    return 0;
+}
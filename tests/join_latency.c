@@ -0,0 +1,80 @@
+#include "harness.h"
+
+// time from DESCRIBE to the first key unit at the client, with and without a prewarmed pipeline,
+// and for a client joining a running shared stream whose natural key unit is twenty seconds away
+
+#define GOP 600
+
+static double firstKeyframe(uint16_t port, const char *path)
+{
+    test_client *client;
+    test_client copy;
+
+    client = testClientStart(port, path, "udp");
+    TEST_CHECK(testClientWait(client, 1, 10000));
+    while (true)
+    {
+        testClientSnapshot(client, &copy);
+        if (copy.first_keyframe != 0 || g_get_monotonic_time() - copy.started > 10 * G_USEC_PER_SEC)
+        {
+            break;
+        }
+        testSleepMs(10);
+    }
+    testClientStop(client);
+    TEST_CHECK(copy.first_keyframe != 0);
+
+    return (double)(copy.first_keyframe - copy.started) / 1000.0;
+}
+
+int main(void)
+{
+    test_server server;
+    CUDA_RTSP_SESSION create_session;
+    CUDA_RTSP_SESSION_STATS stats;
+    CUrtsp_session cold;
+    CUrtsp_session warm;
+    test_client *first;
+    double cold_ms;
+    double warm_ms;
+    double join_ms;
+
+    testInit();
+    testServerStart(&server, NULL);
+
+    testSessionDefaults(&create_session, 1280, 720);
+    create_session.shared = true;
+    create_session.encoder.gopLength = GOP;
+    TEST_CHECK(cuRTSPSessionCreate(&cold, &create_session) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionMount(cold, server.server, "/cold") == CUDA_SUCCESS);
+    create_session.prewarm = true;
+    TEST_CHECK(cuRTSPSessionCreate(&warm, &create_session) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionMount(warm, server.server, "/warm") == CUDA_SUCCESS);
+    // let the prewarmed pipeline reach its steady state
+    testSleepMs(2000);
+
+    cold_ms = firstKeyframe(server.port, "/cold");
+    warm_ms = firstKeyframe(server.port, "/warm");
+
+    // a second client joins mid-GOP, the forced key unit must not wait for the next natural one
+    first = testClientStart(server.port, "/warm", "udp");
+    TEST_CHECK(testClientWait(first, 60, 10000));
+    join_ms = firstKeyframe(server.port, "/warm");
+    testClientStop(first);
+
+    TEST_CHECK(cuRTSPSessionGetStats(warm, &stats) == CUDA_SUCCESS);
+    printf("first key unit: %.1f ms cold, %.1f ms prewarmed, %.1f ms joining mid-GOP\n", cold_ms, warm_ms, join_ms);
+    printf("server join latency: %llu joins, mean %.1f ms, max %.1f ms\n", (unsigned long long)stats.joinLatency.count,
+           (stats.joinLatency.count > 0) ? stats.joinLatency.sum / 1000.0 / stats.joinLatency.count : 0.0, stats.joinLatency.max / 1000.0);
+
+    TEST_CHECK(join_ms < 2000.0);
+    TEST_CHECK(warm_ms < 2000.0);
+    TEST_CHECK(stats.joinLatency.count > 0);
+
+    cuRTSPSessionDestroy(warm);
+    cuRTSPSessionDestroy(cold);
+    testServerStop(&server);
+    cuRTSPDeinit();
+
+    return 0;
+}
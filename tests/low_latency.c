@@ -0,0 +1,80 @@
+#include "harness.h"
+
+// capture-to-packet latency reported per frame, for a default session and for a low-latency one
+// that has to stay within the 50 ms budget
+
+#define FPS 30
+#define SECONDS 3
+#define BUDGET_MS 50.0
+
+typedef struct latency_st
+{
+    uint64_t count;
+    uint64_t sum;
+    uint64_t last_frame;
+} latency;
+
+static void CUDA_CB recordLatency(uint64_t frame, uint64_t nanoseconds, void *user_data)
+{
+    latency *state;
+
+    state = (latency *)user_data;
+    __atomic_add_fetch(&state->count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&state->sum, nanoseconds, __ATOMIC_RELAXED);
+    __atomic_store_n(&state->last_frame, frame, __ATOMIC_RELAXED);
+}
+
+static double meanLatency(test_server *server, bool lowLatency, const char *path)
+{
+    CUDA_RTSP_SESSION create_session;
+    CUDA_RTSP_SESSION_STATS stats;
+    CUrtsp_session session;
+    test_client *client;
+    latency state = {0};
+    double mean;
+
+    testSessionDefaults(&create_session, 640, 360);
+    create_session.lowLatency = lowLatency;
+    create_session.latencyCallback = recordLatency;
+    create_session.userData = &state;
+    TEST_CHECK(cuRTSPSessionCreate(&session, &create_session) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionMount(session, server->server, path) == CUDA_SUCCESS);
+
+    client = testClientStart(server->port, path, "udp");
+    TEST_CHECK(testClientWait(client, FPS, 10000));
+    __atomic_store_n(&state.count, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&state.sum, 0, __ATOMIC_RELAXED);
+    testSleepMs(SECONDS * 1000);
+    testClientStop(client);
+
+    TEST_CHECK(cuRTSPSessionGetStats(session, &stats) == CUDA_SUCCESS);
+    cuRTSPSessionDestroy(session);
+
+    TEST_CHECK(state.count > 0);
+    TEST_CHECK(stats.captureLatency.count >= state.count);
+    mean = (double)state.sum / state.count / 1e6;
+    printf("%s: %llu frames reported up to frame %llu, mean %.1f ms, histogram max %.1f ms\n", lowLatency ? "low latency" : "default",
+           (unsigned long long)state.count, (unsigned long long)state.last_frame, mean, stats.captureLatency.max / 1000.0);
+
+    return mean;
+}
+
+int main(void)
+{
+    test_server server;
+    double normal;
+    double low;
+
+    testInit();
+    testServerStart(&server, NULL);
+
+    normal = meanLatency(&server, false, "/default");
+    low = meanLatency(&server, true, "/low");
+    TEST_CHECK(low < BUDGET_MS);
+    TEST_CHECK(low < normal);
+
+    testServerStop(&server);
+    cuRTSPDeinit();
+
+    return 0;
+}
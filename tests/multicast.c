@@ -0,0 +1,157 @@
+#include "harness.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// multicast clients on loopback share the one sent stream of a mount that also serves unicast,
+// a mount without unicast refuses unicast transports
+
+#define FPS 30
+#define SECONDS 2
+#define GROUP "239.255.42.1"
+#define GROUP_PORT 5900
+
+// a datagram sent to a group through lo comes back to a member on lo, otherwise the sandbox has no multicast
+static bool multicastLoopback(void)
+{
+    struct sockaddr_in address;
+    struct ip_mreq request;
+    struct in_addr iface;
+    struct pollfd pfd;
+    unsigned char loop;
+    char data[4];
+    bool received;
+    int fd;
+
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(GROUP_PORT);
+    address.sin_addr.s_addr = inet_addr(GROUP);
+    request.imr_multiaddr.s_addr = inet_addr(GROUP);
+    request.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+    iface.s_addr = htonl(INADDR_LOOPBACK);
+    loop = 1;
+    received = bind(fd, (struct sockaddr *)&address, sizeof(address)) == 0 &&
+               setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &request, sizeof(request)) == 0 &&
+               setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface)) == 0 &&
+               setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) == 0 &&
+               sendto(fd, "ping", 4, 0, (struct sockaddr *)&address, sizeof(address)) == 4;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    received = received && poll(&pfd, 1, 500) == 1 && recv(fd, data, sizeof(data), 0) == 4;
+    close(fd);
+
+    return received;
+}
+
+// rtspsrc joins the group on the interface the server sends from
+static test_client *multicastClientStart(uint16_t port, const char *path)
+{
+    test_client *client;
+    GstIterator *iterator;
+    GValue item = G_VALUE_INIT;
+    GstElement *element;
+    GstElementFactory *factory;
+
+    client = testClientCreate(port, path, "udp-mcast");
+    iterator = gst_bin_iterate_elements(GST_BIN(client->pipeline));
+    while (gst_iterator_next(iterator, &item) == GST_ITERATOR_OK)
+    {
+        element = g_value_get_object(&item);
+        factory = gst_element_get_factory(element);
+        if (factory != NULL && strcmp(gst_plugin_feature_get_name(GST_PLUGIN_FEATURE(factory)), "rtspsrc") == 0)
+        {
+            g_object_set(element, "multicast-iface", "lo", NULL);
+        }
+        g_value_reset(&item);
+    }
+    g_value_unset(&item);
+    gst_iterator_free(iterator);
+    testClientPlay(client);
+
+    return client;
+}
+
+int main(void)
+{
+    test_server server;
+    CUDA_RTSP_SESSION create_session;
+    CUDA_RTSP_SESSION_STATS stats;
+    CUrtsp_session session;
+    CUrtsp_session multicast_only;
+    test_client *clients[4];
+    test_client window;
+    char session_id[128];
+    size_t index;
+    int fd;
+
+    testInit();
+    if (!multicastLoopback())
+    {
+        fprintf(stderr, "no multicast on the loopback interface\n");
+        return TEST_SKIP;
+    }
+    testServerStart(&server, NULL);
+
+    testSessionDefaults(&create_session, 640, 360);
+    create_session.multicast.addressMin = "239.255.42.2";
+    create_session.multicast.addressMax = "239.255.42.20";
+    create_session.multicast.portMin = 6000;
+    create_session.multicast.portMax = 6999;
+    create_session.multicast.ttl = 1;
+    create_session.multicast.iface = "lo";
+    create_session.multicast.unicast = true;
+    TEST_CHECK(cuRTSPSessionCreate(&session, &create_session) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionMount(session, server.server, "/mcast") == CUDA_SUCCESS);
+
+    create_session.multicast.addressMin = "239.255.43.2";
+    create_session.multicast.addressMax = NULL;
+    create_session.multicast.unicast = false;
+    TEST_CHECK(cuRTSPSessionCreate(&multicast_only, &create_session) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionMount(multicast_only, server.server, "/mcast-only") == CUDA_SUCCESS);
+
+    clients[0] = multicastClientStart(server.port, "/mcast");
+    clients[1] = multicastClientStart(server.port, "/mcast");
+    clients[2] = testClientStart(server.port, "/mcast", "udp");
+    clients[3] = testClientStart(server.port, "/mcast", "tcp");
+    for (index = 0; index < 4; index++)
+    {
+        TEST_CHECK(testClientWait(clients[index], FPS, 20000));
+        testClientReset(clients[index]);
+    }
+    testSleepMs(SECONDS * 1000);
+    for (index = 0; index < 4; index++)
+    {
+        testClientSnapshot(clients[index], &window);
+        printf("client %zu: %.1f fps\n", index, (double)window.frames / SECONDS);
+        TEST_CHECK(window.frames >= FPS * SECONDS * 0.8);
+    }
+    // one media encodes and sends for every client of the mount
+    TEST_CHECK(cuRTSPSessionGetStats(session, &stats) == CUDA_SUCCESS);
+    TEST_CHECK(stats.mediaCount == 1);
+
+    fd = testRtspConnect(server.port, 0);
+    TEST_CHECK(fd >= 0);
+    TEST_CHECK(!testRtspPlay(fd, server.port, "/mcast-only", "RTP/AVP;unicast;client_port=7000-7001", session_id, sizeof(session_id)));
+    close(fd);
+
+    for (index = 0; index < 4; index++)
+    {
+        testClientStop(clients[index]);
+    }
+    cuRTSPSessionDestroy(multicast_only);
+    cuRTSPSessionDestroy(session);
+    testServerStop(&server);
+    cuRTSPDeinit();
+
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include "harness.h"
+
+// sessions of one geometry and pool bounds on one context draw frames from one pool,
+// other geometries and bounds get a pool of their own that stays within poolMax
+
+#define FPS 30
+#define SECONDS 2
+#define POOL_MAX 8
+
+typedef struct producer_st
+{
+    GMutex lock;
+    GHashTable *buffers;
+} producer;
+
+static void CUDA_CB recordFrame(CUdeviceptr buffer, size_t size, void *user_data)
+{
+    producer *state;
+
+    state = (producer *)user_data;
+    g_mutex_lock(&state->lock);
+    g_hash_table_add(state->buffers, (gpointer)buffer);
+    g_mutex_unlock(&state->lock);
+    testWriteFrame(buffer, size, NULL);
+}
+
+static bool overlap(producer *a, producer *b)
+{
+    GHashTableIter iter;
+    gpointer key;
+    bool found;
+
+    found = false;
+    g_hash_table_iter_init(&iter, a->buffers);
+    while (!found && g_hash_table_iter_next(&iter, &key, NULL))
+    {
+        found = g_hash_table_contains(b->buffers, key);
+    }
+
+    return found;
+}
+
+int main(void)
+{
+    test_server server;
+    CUDA_RTSP_SESSION create_session;
+    CUrtsp_session sessions[4];
+    producer states[4];
+    test_client *clients[4];
+    test_client window;
+    char path[32];
+    size_t index;
+
+    testInit();
+    testServerStart(&server, NULL);
+
+    testSessionDefaults(&create_session, 640, 360);
+    create_session.poolMin = 4;
+    create_session.poolMax = 2;
+    TEST_CHECK(cuRTSPSessionCreate(&sessions[0], &create_session) != CUDA_SUCCESS);
+
+    // 0 and 1 share a pool, 2 differs in geometry and 3 in its bounds
+    for (index = 0; index < 4; index++)
+    {
+        g_mutex_init(&states[index].lock);
+        states[index].buffers = g_hash_table_new(g_direct_hash, g_direct_equal);
+        testSessionDefaults(&create_session, (index == 2) ? 320 : 640, (index == 2) ? 240 : 360);
+        create_session.lowLatency = true;
+        create_session.writeCallback = recordFrame;
+        create_session.userData = &states[index];
+        if (index == 3)
+        {
+            create_session.poolMin = 2;
+            create_session.poolMax = POOL_MAX;
+        }
+        TEST_CHECK(cuRTSPSessionCreate(&sessions[index], &create_session) == CUDA_SUCCESS);
+        snprintf(path, sizeof(path), "/pool%zu", index);
+        TEST_CHECK(cuRTSPSessionMount(sessions[index], server.server, path) == CUDA_SUCCESS);
+        clients[index] = testClientStart(server.port, path, "udp");
+    }
+    for (index = 0; index < 4; index++)
+    {
+        TEST_CHECK(testClientWait(clients[index], FPS, 20000));
+        testClientReset(clients[index]);
+    }
+    testSleepMs(SECONDS * 1000);
+    for (index = 0; index < 4; index++)
+    {
+        testClientSnapshot(clients[index], &window);
+        printf("session %zu: %.1f fps from %u buffers\n", index, (double)window.frames / SECONDS, g_hash_table_size(states[index].buffers));
+        TEST_CHECK(window.frames >= FPS * SECONDS * 0.8);
+        testClientStop(clients[index]);
+    }
+
+    TEST_CHECK(overlap(&states[0], &states[1]));
+    TEST_CHECK(!overlap(&states[0], &states[2]));
+    TEST_CHECK(!overlap(&states[0], &states[3]));
+    TEST_CHECK(g_hash_table_size(states[3].buffers) <= POOL_MAX);
+
+    for (index = 0; index < 4; index++)
+    {
+        cuRTSPSessionDestroy(sessions[index]);
+        g_hash_table_destroy(states[index].buffers);
+        g_mutex_clear(&states[index].lock);
+    }
+
+    // the registry went with its last session and comes back with the next one
+    testSessionDefaults(&create_session, 640, 360);
+    TEST_CHECK(cuRTSPSessionCreate(&sessions[0], &create_session) == CUDA_SUCCESS);
+    cuRTSPSessionDestroy(sessions[0]);
+
+    testServerStop(&server);
+    cuRTSPDeinit();
+
+    return 0;
+}
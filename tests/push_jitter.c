@@ -0,0 +1,98 @@
+#include "harness.h"
+
+// a producer pushing with a jittery cadence must not make the stream jitter,
+// the ring and the pipeline clock absorb it and the encoder is fed one frame per period
+
+#define FPS 30
+#define SECONDS 8
+
+typedef struct producer_st
+{
+    CUrtsp_session session;
+    int measuring;
+    int stopped;
+    test_timing intervals;
+} producer;
+
+static gpointer produce(gpointer data)
+{
+    producer *state;
+    gint64 period;
+    gint64 last;
+    gint64 now;
+    uint64_t frame;
+
+    state = (producer *)data;
+    period = G_USEC_PER_SEC / FPS;
+    last = 0;
+    for (frame = 0; !__atomic_load_n(&state->stopped, __ATOMIC_SEQ_CST); frame++)
+    {
+        TEST_CHECK(cuRTSPSessionPushFrame(state->session, testWriteFrame, NULL) == CUDA_SUCCESS);
+        now = g_get_monotonic_time();
+        if (__atomic_load_n(&state->measuring, __ATOMIC_SEQ_CST) && last != 0)
+        {
+            testTimingAdd(&state->intervals, (double)(now - last) / 1000.0);
+        }
+        last = now;
+        // between a fifth and almost twice the period, with a stall of three periods twice a second
+        g_usleep((frame % 15 == 14) ? 3 * period : (gulong)(period * g_random_double_range(0.2, 1.8)));
+    }
+
+    return NULL;
+}
+
+int main(void)
+{
+    test_server server;
+    CUDA_RTSP_SESSION create_session;
+    CUDA_RTSP_SESSION_STATS stats;
+    CUrtsp_session session;
+    test_client *client;
+    test_client window;
+    producer state = {0};
+    GThread *thread;
+    double fps;
+
+    testInit();
+    testServerStart(&server, NULL);
+
+    testSessionDefaults(&create_session, 640, 360);
+    create_session.input = CU_RTSP_INPUT_PUSH;
+    create_session.queueDepth = 4;
+    create_session.queuePolicy = CU_RTSP_QUEUE_DROP_OLDEST;
+    create_session.writeCallback = NULL;
+    TEST_CHECK(cuRTSPSessionCreate(&session, &create_session) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionMount(session, server.server, "/push") == CUDA_SUCCESS);
+
+    state.session = session;
+    thread = g_thread_new("producer", produce, &state);
+
+    client = testClientStart(server.port, "/push", "udp");
+    TEST_CHECK(testClientWait(client, FPS, 10000));
+    testClientReset(client);
+    __atomic_store_n(&state.measuring, 1, __ATOMIC_SEQ_CST);
+    testSleepMs(SECONDS * 1000);
+    testClientSnapshot(client, &window);
+    __atomic_store_n(&state.stopped, 1, __ATOMIC_SEQ_CST);
+    g_thread_join(thread);
+
+    TEST_CHECK(cuRTSPSessionGetStats(session, &stats) == CUDA_SUCCESS);
+    fps = (double)window.frames / SECONDS;
+    printf("producer: interval %.2f ms, deviation %.2f ms, max %.2f ms\n",
+           testTimingMean(&state.intervals), testTimingDeviation(&state.intervals), state.intervals.max);
+    printf("client:   interval %.2f ms, deviation %.2f ms, max %.2f ms, %.1f fps\n",
+           testTimingMean(&window.intervals), testTimingDeviation(&window.intervals), window.intervals.max, fps);
+    printf("session:  %llu produced, %llu sent, %llu repeated, %llu dropped\n",
+           (unsigned long long)stats.framesProduced, (unsigned long long)stats.framesSent,
+           (unsigned long long)stats.framesRepeated, (unsigned long long)stats.framesDropped);
+
+    TEST_CHECK(fps >= FPS * 0.8);
+    TEST_CHECK(testTimingDeviation(&window.intervals) < testTimingDeviation(&state.intervals));
+
+    testClientStop(client);
+    cuRTSPSessionDestroy(session);
+    testServerStop(&server);
+    cuRTSPDeinit();
+
+    return 0;
+}
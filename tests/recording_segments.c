@@ -0,0 +1,130 @@
+#include "harness.h"
+
+#include <string.h>
+
+#include <glib/gstdio.h>
+
+// a recording rolls over to a new segment every segmentSeconds, keeps only maxFiles of them,
+// and every finished segment starts with a key unit, for both containers
+
+#define SECONDS 7
+#define SEGMENT_SECONDS 1
+#define MAX_FILES 3
+
+static const char *const ELEMENTS[] = {"splitmuxsink", "mp4mux", "mpegtsmux", "qtdemux", "tsdemux", "h264parse", "appsink"};
+
+static bool firstIsKeyframe(const char *path, const char *demuxer)
+{
+    GstElement *pipeline;
+    GstElement *sink;
+    GstSample *sample;
+    gchar *description;
+    bool keyframe;
+
+    description = g_strdup_printf("filesrc location=%s ! %s ! h264parse ! appsink name=sink sync=false", path, demuxer);
+    pipeline = gst_parse_launch(description, NULL);
+    g_free(description);
+    TEST_CHECK(pipeline != NULL);
+    sink = gst_bin_get_by_name(GST_BIN(pipeline), "sink");
+    TEST_CHECK(gst_element_set_state(pipeline, GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+    sample = NULL;
+    g_signal_emit_by_name(sink, "pull-sample", &sample);
+    keyframe = sample != NULL && !GST_BUFFER_FLAG_IS_SET(gst_sample_get_buffer(sample), GST_BUFFER_FLAG_DELTA_UNIT);
+    if (sample != NULL)
+    {
+        gst_sample_unref(sample);
+    }
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(sink);
+    gst_object_unref(pipeline);
+
+    return keyframe;
+}
+
+static void record(CUrtsp_container container, const char *extension, const char *demuxer)
+{
+    CUDA_RTSP_SESSION create_session;
+    CUrtsp_session session;
+    test_server server;
+    GDir *dir;
+    const gchar *name;
+    gchar *directory;
+    gchar *location;
+    gchar *path;
+    int index;
+    int newest;
+    int files;
+
+    directory = g_dir_make_tmp("cu-rtsp-record-XXXXXX", NULL);
+    TEST_CHECK(directory != NULL);
+    location = g_strdup_printf("%s/segment-%%05d.%s", directory, extension);
+
+    testServerStart(&server, NULL);
+    testSessionDefaults(&create_session, 640, 360);
+    // two key units per segment so every cut has one to start at
+    create_session.encoder.gopLength = 15;
+    create_session.recording.location = location;
+    create_session.recording.container = container;
+    create_session.recording.segmentSeconds = SEGMENT_SECONDS;
+    create_session.recording.maxFiles = MAX_FILES;
+    TEST_CHECK(cuRTSPSessionCreate(&session, &create_session) == CUDA_SUCCESS);
+    // the recording starts with the mount, no client is needed
+    TEST_CHECK(cuRTSPSessionMount(session, server.server, "/record") == CUDA_SUCCESS);
+    testSleepMs(SECONDS * 1000);
+    TEST_CHECK(cuRTSPSessionUnmount(session, server.server, "/record") == CUDA_SUCCESS);
+    cuRTSPSessionDestroy(session);
+    testServerStop(&server);
+
+    files = 0;
+    newest = -1;
+    dir = g_dir_open(directory, 0, NULL);
+    TEST_CHECK(dir != NULL);
+    while ((name = g_dir_read_name(dir)) != NULL)
+    {
+        TEST_CHECK(sscanf(name, "segment-%d.", &index) == 1);
+        newest = MAX(newest, index);
+        files++;
+    }
+    g_dir_close(dir);
+    printf("%s: %d segments kept, newest is segment %d\n", extension, files, newest);
+    // older segments were deleted once newer ones rolled over
+    TEST_CHECK(files >= 2 && files <= MAX_FILES);
+    TEST_CHECK(newest >= MAX_FILES);
+
+    // the newest segment may still be open, every earlier one was finished at a cut
+    for (index = newest - files + 1; index <= newest; index++)
+    {
+        path = g_strdup_printf(location, index);
+        if (index < newest)
+        {
+            TEST_CHECK(firstIsKeyframe(path, demuxer));
+        }
+        g_remove(path);
+        g_free(path);
+    }
+    g_rmdir(directory);
+    g_free(location);
+    g_free(directory);
+}
+
+int main(void)
+{
+    size_t index;
+
+    testInit();
+    for (index = 0; index < G_N_ELEMENTS(ELEMENTS); index++)
+    {
+        if (!gst_element_factory_find(ELEMENTS[index]))
+        {
+            printf("skipped, %s is not installed\n", ELEMENTS[index]);
+            return TEST_SKIP;
+        }
+    }
+
+    record(CU_RTSP_CONTAINER_MPEGTS, "ts", "tsdemux");
+    record(CU_RTSP_CONTAINER_MP4, "mp4", "qtdemux");
+
+    cuRTSPDeinit();
+
+    return 0;
+}
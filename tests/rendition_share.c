@@ -0,0 +1,72 @@
+#include "harness.h"
+
+// every rung of a rendition ladder plays at the full rate while the producer runs once per frame period
+
+#define FPS 30
+#define SECONDS 3
+
+static void CUDA_CB countFrame(CUdeviceptr buffer, size_t size, void *user_data)
+{
+    testWriteFrame(buffer, size, NULL);
+    __atomic_fetch_add((uint64_t *)user_data, 1, __ATOMIC_SEQ_CST);
+}
+
+int main(void)
+{
+    static const CUDA_RTSP_RENDITION renditions[] = {{"mid", 320, 180, 0}, {"low", 160, 90, 0}};
+    static const char *const paths[] = {"/ladder", "/ladder/mid", "/ladder/low"};
+    test_server server;
+    CUDA_RTSP_SESSION create_session;
+    CUrtsp_session hSession;
+    test_client *clients[G_N_ELEMENTS(paths)];
+    test_client window;
+    uint64_t calls;
+    uint64_t start;
+    uint64_t produced;
+    size_t index;
+
+    testInit();
+    testServerStart(&server, NULL);
+
+    calls = 0;
+    testSessionDefaults(&create_session, 640, 360);
+    create_session.writeCallback = countFrame;
+    create_session.userData = &calls;
+    create_session.renditions = renditions;
+    create_session.renditionCount = G_N_ELEMENTS(renditions);
+    TEST_CHECK(cuRTSPSessionCreate(&hSession, &create_session) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionMount(hSession, server.server, "/ladder") == CUDA_SUCCESS);
+
+    for (index = 0; index < G_N_ELEMENTS(paths); index++)
+    {
+        clients[index] = testClientStart(server.port, paths[index], "udp");
+    }
+    for (index = 0; index < G_N_ELEMENTS(paths); index++)
+    {
+        TEST_CHECK(testClientWait(clients[index], FPS, 20000));
+        testClientReset(clients[index]);
+    }
+    start = __atomic_load_n(&calls, __ATOMIC_SEQ_CST);
+    testSleepMs(SECONDS * 1000);
+    produced = __atomic_load_n(&calls, __ATOMIC_SEQ_CST) - start;
+
+    printf("%llu producer calls in %d s\n", (unsigned long long)produced, SECONDS);
+    for (index = 0; index < G_N_ELEMENTS(paths); index++)
+    {
+        testClientSnapshot(clients[index], &window);
+        printf("%s: %.1f fps\n", paths[index], (double)window.frames / SECONDS);
+        TEST_CHECK(window.frames >= FPS * SECONDS * 0.8);
+    }
+    // three rungs asking separately would call it about three times per period
+    TEST_CHECK(produced <= FPS * SECONDS * 1.2);
+
+    for (index = 0; index < G_N_ELEMENTS(paths); index++)
+    {
+        testClientStop(clients[index]);
+    }
+    cuRTSPSessionDestroy(hSession);
+    testServerStop(&server);
+    cuRTSPDeinit();
+
+    return 0;
+}
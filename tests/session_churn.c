@@ -0,0 +1,80 @@
+#include "harness.h"
+
+#include <unistd.h>
+
+// thousands of sessions created, mounted, reconfigured and destroyed must not grow the resident set
+
+#define WARMUP 200
+#define CYCLES 3000
+#define PREWARM_WARMUP 10
+#define PREWARM_CYCLES 100
+#define MAX_GROWTH (4 << 20)
+
+static long residentBytes(void)
+{
+    FILE *statm;
+    long size;
+    long resident;
+
+    statm = fopen("/proc/self/statm", "r");
+    TEST_CHECK(statm != NULL);
+    TEST_CHECK(fscanf(statm, "%ld %ld", &size, &resident) == 2);
+    fclose(statm);
+
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+static void cycle(test_server *server, bool prewarm, size_t index)
+{
+    CUDA_RTSP_SESSION create_session;
+    CUrtsp_session session;
+    char path[32];
+
+    testSessionDefaults(&create_session, 640, 360);
+    create_session.prewarm = prewarm;
+    snprintf(path, sizeof(path), "/churn%zu", index % 8);
+    TEST_CHECK(cuRTSPSessionCreate(&session, &create_session) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionMount(session, server->server, path) == CUDA_SUCCESS);
+    // a format the encoder cannot read allocates a conversion pool, the next one releases it
+    TEST_CHECK(cuRTSPSessionReconfigure(session, 320, 240, CU_RTSP_FORMAT_BGRA, 30, 1) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionReconfigure(session, 640, 360, CU_RTSP_FORMAT_I420, 30, 1) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionUnmount(session, server->server, path) == CUDA_SUCCESS);
+    cuRTSPSessionDestroy(session);
+}
+
+static long churn(test_server *server, bool prewarm, size_t warmup, size_t cycles)
+{
+    long before;
+    long after;
+    size_t index;
+
+    for (index = 0; index < warmup; index++)
+    {
+        cycle(server, prewarm, index);
+    }
+    before = residentBytes();
+    for (index = 0; index < cycles; index++)
+    {
+        cycle(server, prewarm, index);
+    }
+    after = residentBytes();
+    printf("%zu %s cycles: resident %ld KiB -> %ld KiB\n", cycles, prewarm ? "prewarmed" : "plain", before >> 10, after >> 10);
+
+    return after - before;
+}
+
+int main(void)
+{
+    test_server server;
+
+    testInit();
+    testServerStart(&server, NULL);
+
+    TEST_CHECK(churn(&server, false, WARMUP, CYCLES) < MAX_GROWTH);
+    TEST_CHECK(churn(&server, true, PREWARM_WARMUP, PREWARM_CYCLES) < MAX_GROWTH);
+
+    testServerStop(&server);
+    cuRTSPDeinit();
+
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include "harness.h"
+
+// a shared session runs one pipeline however many clients watch it,
+// so the producer is asked for frames at the frame rate and not once per client
+
+#define FPS 30
+#define CLIENTS 24
+#define SECONDS 4
+
+static uint64_t CALLBACKS = 0;
+
+static void CUDA_CB countFrame(CUdeviceptr buffer, size_t size, void *user_data)
+{
+    __atomic_add_fetch(&CALLBACKS, 1, __ATOMIC_RELAXED);
+    testWriteFrame(buffer, size, user_data);
+}
+
+static double measureRate(void)
+{
+    uint64_t start;
+
+    start = __atomic_load_n(&CALLBACKS, __ATOMIC_RELAXED);
+    testSleepMs(SECONDS * 1000);
+
+    return (double)(__atomic_load_n(&CALLBACKS, __ATOMIC_RELAXED) - start) / SECONDS;
+}
+
+int main(void)
+{
+    test_server server;
+    CUDA_RTSP_SESSION create_session;
+    CUDA_RTSP_SESSION_STATS stats;
+    CUrtsp_session session;
+    test_client *clients[CLIENTS];
+    double single;
+    double many;
+    size_t index;
+
+    testInit();
+    testServerStart(&server, NULL);
+
+    testSessionDefaults(&create_session, 320, 240);
+    create_session.shared = true;
+    create_session.writeCallback = countFrame;
+    TEST_CHECK(cuRTSPSessionCreate(&session, &create_session) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionMount(session, server.server, "/shared") == CUDA_SUCCESS);
+
+    clients[0] = testClientStart(server.port, "/shared", "udp");
+    TEST_CHECK(testClientWait(clients[0], FPS, 10000));
+    single = measureRate();
+
+    for (index = 1; index < CLIENTS; index++)
+    {
+        clients[index] = testClientStart(server.port, "/shared", (index % 2 == 0) ? "udp" : "tcp");
+    }
+    for (index = 1; index < CLIENTS; index++)
+    {
+        TEST_CHECK(testClientWait(clients[index], FPS, 20000));
+    }
+    many = measureRate();
+
+    TEST_CHECK(cuRTSPSessionGetStats(session, &stats) == CUDA_SUCCESS);
+    printf("callbacks per second: %.1f with one client, %.1f with %d clients, %zu media\n", single, many, CLIENTS, stats.mediaCount);
+
+    TEST_CHECK(stats.mediaCount == 1);
+    TEST_CHECK(many <= FPS * 1.2);
+    TEST_CHECK(many <= single * 1.2);
+
+    for (index = 0; index < CLIENTS; index++)
+    {
+        testClientStop(clients[index]);
+    }
+    cuRTSPSessionDestroy(session);
+    testServerStop(&server);
+    cuRTSPDeinit();
+
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include "harness.h"
+
+// snapshots of one session at several sizes, each JPEG must have the size it was asked for
+
+#define MAX_JPEG (4 << 20)
+
+// reads the frame size from the JPEG's start-of-frame segment
+static bool jpegSize(const uint8_t *data, size_t size, size_t *pWidth, size_t *pHeight)
+{
+    size_t offset;
+
+    offset = 2;
+    while (offset + 9 <= size && data[offset] == 0xFF)
+    {
+        if (data[offset + 1] >= 0xC0 && data[offset + 1] <= 0xC3)
+        {
+            *pHeight = ((size_t)data[offset + 5] << 8) | data[offset + 6];
+            *pWidth = ((size_t)data[offset + 7] << 8) | data[offset + 8];
+            return true;
+        }
+        offset += 2 + (((size_t)data[offset + 2] << 8) | data[offset + 3]);
+    }
+
+    return false;
+}
+
+static void checkSnapshot(CUrtsp_session session, uint8_t *data, size_t width, size_t height, size_t expect_width, size_t expect_height)
+{
+    size_t size;
+    size_t jpeg_width;
+    size_t jpeg_height;
+
+    size = MAX_JPEG;
+    TEST_CHECK(cuRTSPSessionGetSnapshot(session, width, height, data, &size) == CUDA_SUCCESS);
+    TEST_CHECK(jpegSize(data, size, &jpeg_width, &jpeg_height));
+    printf("asked for %zux%zu, got a %zux%zu JPEG of %zu bytes\n", width, height, jpeg_width, jpeg_height, size);
+    TEST_CHECK(jpeg_width == expect_width && jpeg_height == expect_height);
+}
+
+int main(void)
+{
+    test_server server;
+    CUDA_RTSP_SESSION create_session;
+    CUrtsp_session session;
+    uint8_t *data;
+
+    testInit();
+    if (!gst_element_factory_find("jpegenc"))
+    {
+        printf("skipped, jpegenc is not installed\n");
+        return TEST_SKIP;
+    }
+    testServerStart(&server, NULL);
+    data = malloc(MAX_JPEG);
+
+    testSessionDefaults(&create_session, 640, 360);
+    TEST_CHECK(cuRTSPSessionCreate(&session, &create_session) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionMount(session, server.server, "/snapshot") == CUDA_SUCCESS);
+
+    // the same frame asked for at another size is encoded again rather than served from the cache
+    checkSnapshot(session, data, 320, 180, 320, 180);
+    checkSnapshot(session, data, 320, 180, 320, 180);
+    checkSnapshot(session, data, 160, 90, 160, 90);
+    checkSnapshot(session, data, 0, 0, 640, 360);
+    checkSnapshot(session, data, 320, 0, 320, 180);
+
+    free(data);
+    cuRTSPSessionDestroy(session);
+    testServerStop(&server);
+    cuRTSPDeinit();
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include "harness.h"
+
+// a stream callback produces on the session's own CUDA stream and its frames reach the client
+
+#define FPS 30
+#define SECONDS 2
+
+typedef struct producer_st
+{
+    CUstream stream;
+    uint64_t calls;
+    int other_stream;
+} producer;
+
+static void CUDA_CB streamFrame(CUdeviceptr buffer, size_t size, CUstream stream, void *user_data)
+{
+    producer *state;
+
+    state = (producer *)user_data;
+    TEST_CHECK(stream != NULL);
+    if (state->stream == NULL)
+    {
+        state->stream = stream;
+    }
+    else if (state->stream != stream)
+    {
+        state->other_stream = 1;
+    }
+    testWriteFrame(buffer, size, NULL);
+    __atomic_fetch_add(&state->calls, 1, __ATOMIC_SEQ_CST);
+}
+
+int main(void)
+{
+    test_server server;
+    CUDA_RTSP_SESSION create_session;
+    CUDA_RTSP_SESSION_STATS stats;
+    CUrtsp_session sessions[2];
+    producer states[2] = {0};
+    test_client *clients[2];
+    test_client window;
+    size_t index;
+
+    testInit();
+    testServerStart(&server, NULL);
+
+    for (index = 0; index < 2; index++)
+    {
+        testSessionDefaults(&create_session, 640, 360);
+        create_session.writeCallback = NULL;
+        create_session.streamCallback = streamFrame;
+        create_session.userData = &states[index];
+        TEST_CHECK(cuRTSPSessionCreate(&sessions[index], &create_session) == CUDA_SUCCESS);
+    }
+    TEST_CHECK(cuRTSPSessionMount(sessions[0], server.server, "/stream0") == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionMount(sessions[1], server.server, "/stream1") == CUDA_SUCCESS);
+
+    clients[0] = testClientStart(server.port, "/stream0", "udp");
+    clients[1] = testClientStart(server.port, "/stream1", "udp");
+    for (index = 0; index < 2; index++)
+    {
+        TEST_CHECK(testClientWait(clients[index], FPS, 20000));
+        testClientReset(clients[index]);
+    }
+    testSleepMs(SECONDS * 1000);
+
+    for (index = 0; index < 2; index++)
+    {
+        testClientSnapshot(clients[index], &window);
+        TEST_CHECK(cuRTSPSessionGetStats(sessions[index], &stats) == CUDA_SUCCESS);
+        printf("session %zu: %.1f fps, %llu callbacks, %llu frames encoded\n", index, (double)window.frames / SECONDS,
+               (unsigned long long)__atomic_load_n(&states[index].calls, __ATOMIC_SEQ_CST), (unsigned long long)stats.framesEncoded);
+        TEST_CHECK(window.frames >= FPS * SECONDS * 0.8);
+        TEST_CHECK(stats.framesProduced > 0 && stats.framesEncoded > 0);
+        // every frame of a session is produced on the same stream
+        TEST_CHECK(!states[index].other_stream);
+    }
+    // sessions do not serialise on each other's stream
+    TEST_CHECK(states[0].stream != states[1].stream);
+
+    for (index = 0; index < 2; index++)
+    {
+        testClientStop(clients[index]);
+        cuRTSPSessionDestroy(sessions[index]);
+    }
+    testServerStop(&server);
+    cuRTSPDeinit();
+
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include "harness.h"
+
+#include <glib/gstdio.h>
+#include <unistd.h>
+
+// two traces of one running stream: every stage is recorded once per frame, and the probes
+// installed for the first trace are gone before the second one installs its own
+
+#define SECONDS 2
+#define MAX_EVENTS 100000
+
+static size_t countEvents(const char *json, const char *name, char phase)
+{
+    char pattern[128];
+    const char *match;
+    size_t count;
+
+    count = 0;
+    snprintf(pattern, sizeof(pattern), "{\"name\":\"%s\",\"cat\":\"frame\",\"ph\":\"%c\"", name, phase);
+    for (match = strstr(json, pattern); match != NULL; match = strstr(match + 1, pattern))
+    {
+        count++;
+    }
+
+    return count;
+}
+
+static void traceStream(const char *path)
+{
+    gchar *json;
+    size_t pushed;
+    size_t payloaded;
+    size_t sent;
+
+    TEST_CHECK(cuRTSPTraceStart(path, MAX_EVENTS) == CUDA_SUCCESS);
+    testSleepMs(SECONDS * 1000);
+    TEST_CHECK(cuRTSPTraceStop() == CUDA_SUCCESS);
+    TEST_CHECK(g_file_get_contents(path, &json, NULL, NULL));
+
+    pushed = countEvents(json, "appsrc", 'b');
+    payloaded = countEvents(json, "rtph264pay", 'e');
+    sent = countEvents(json, "multiudpsink", 'n');
+    printf("%zu frames pushed, %zu payloaded, %zu sent\n", pushed, payloaded, sent);
+    // a stage probed twice would record each frame twice
+    TEST_CHECK(pushed > 0);
+    TEST_CHECK(payloaded > 0 && payloaded <= pushed);
+    TEST_CHECK(sent > 0 && sent <= pushed);
+
+    g_free(json);
+}
+
+int main(void)
+{
+    test_server server;
+    CUDA_RTSP_SESSION create_session;
+    CUrtsp_session session;
+    test_client *client;
+    char path[] = "/tmp/cuda-rtsp-trace-XXXXXX";
+    int fd;
+
+    testInit();
+    testServerStart(&server, NULL);
+    fd = g_mkstemp(path);
+    TEST_CHECK(fd >= 0);
+    close(fd);
+
+    testSessionDefaults(&create_session, 640, 360);
+    TEST_CHECK(cuRTSPSessionCreate(&session, &create_session) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionMount(session, server.server, "/trace") == CUDA_SUCCESS);
+    client = testClientStart(server.port, "/trace", "udp");
+    TEST_CHECK(testClientWait(client, 30, 10000));
+
+    TEST_CHECK(cuRTSPTraceStop() == CUDA_ERROR_NOT_READY);
+    traceStream(path);
+    testSleepMs(500);
+    traceStream(path);
+
+    g_unlink(path);
+    testClientStop(client);
+    cuRTSPSessionDestroy(session);
+    testServerStop(&server);
+    cuRTSPDeinit();
+
+    return 0;
+}
@@ -0,0 +1,237 @@
+#include "harness.h"
+
+#include <string.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// UDP egress of large pre-encoded access units with and without segmentation offload:
+// packet rate and process CPU per Gbit/s, which offload must lower, packets must arrive as valid RTP no larger than the MTU
+
+#define WIDTH 1280
+#define HEIGHT 720
+#define UNITS 90
+#define BITRATE 40000
+#define FPS 120
+#define MTU 1400
+#define SECONDS 5
+
+typedef struct egress_st
+{
+    CUrtsp_session session;
+    const test_access_unit *units;
+    int fd;
+    int stopped;
+    uint64_t packets;
+    uint64_t bytes;
+    uint64_t invalid;
+} egress;
+
+static gpointer pushLoop(gpointer data)
+{
+    egress *state;
+    uint64_t pts;
+    size_t index;
+
+    state = (egress *)data;
+    pts = 0;
+    for (index = 0; !__atomic_load_n(&state->stopped, __ATOMIC_SEQ_CST); index = (index + 1) % UNITS)
+    {
+        TEST_CHECK(cuRTSPSessionPushAccessUnit(state->session, state->units[index].data, state->units[index].size, pts, state->units[index].keyframe) == CUDA_SUCCESS);
+        pts += GST_SECOND / FPS;
+    }
+
+    return NULL;
+}
+
+static gpointer receiveLoop(gpointer data)
+{
+    egress *state;
+    uint8_t packet[65536];
+    ssize_t size;
+
+    state = (egress *)data;
+    while (!__atomic_load_n(&state->stopped, __ATOMIC_SEQ_CST))
+    {
+        size = recv(state->fd, packet, sizeof(packet), 0);
+        if (size <= 0)
+        {
+            continue;
+        }
+        // a datagram the kernel did not split again would be larger than the MTU
+        if (size < 12 || (packet[0] >> 6) != 2 || size > MTU)
+        {
+            __atomic_add_fetch(&state->invalid, 1, __ATOMIC_RELAXED);
+        }
+        __atomic_add_fetch(&state->packets, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&state->bytes, (uint64_t)size, __ATOMIC_RELAXED);
+    }
+
+    return NULL;
+}
+
+static int bindUdp(uint16_t port)
+{
+    struct sockaddr_in address;
+    struct timeval timeout = {0, 100000};
+    int receive_buffer;
+    int fd;
+
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    TEST_CHECK(fd >= 0);
+    receive_buffer = 8 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer));
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static double cpuSeconds(void)
+{
+    struct rusage usage;
+
+    TEST_CHECK(getrusage(RUSAGE_SELF, &usage) == 0);
+
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// the kernel refuses UDP_SEGMENT before 4.18, the session then falls back to one datagram per packet
+static bool segmentationSupported(void)
+{
+#ifdef UDP_SEGMENT
+    int segment;
+    int fd;
+    bool supported;
+
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    TEST_CHECK(fd >= 0);
+    segment = MTU;
+    supported = setsockopt(fd, IPPROTO_UDP, UDP_SEGMENT, &segment, sizeof(segment)) == 0;
+    close(fd);
+
+    return supported;
+#else
+    return false;
+#endif
+}
+
+// returns the process CPU seconds per Gbit/s received
+static double run(test_server *server, const test_access_unit *units, bool offload)
+{
+    CUDA_RTSP_SESSION create_session;
+    egress state;
+    GThread *pusher;
+    GThread *receiver;
+    char transport[64];
+    char session[128];
+    uint16_t client_port;
+    int rtcp_fd;
+    int fd;
+    double cpu;
+    double cpu_per_gbit;
+    uint64_t packets;
+    uint64_t bytes;
+
+    testSessionDefaults(&create_session, WIDTH, HEIGHT);
+    create_session.fpsNum = FPS;
+    create_session.input = CU_RTSP_INPUT_ENCODED;
+    create_session.writeCallback = NULL;
+    create_session.queueDepth = 4;
+    create_session.queuePolicy = CU_RTSP_QUEUE_BLOCK;
+    create_session.mtu = MTU;
+    create_session.sendBufferSize = 4 << 20;
+    create_session.segmentationOffload = offload;
+    memset(&state, 0, sizeof(state));
+    state.units = units;
+    TEST_CHECK(cuRTSPSessionCreate(&state.session, &create_session) == CUDA_SUCCESS);
+    TEST_CHECK(cuRTSPSessionMount(state.session, server->server, "/egress") == CUDA_SUCCESS);
+
+    // RTP needs an even port with the odd one above it free for RTCP
+    do
+    {
+        client_port = testFreePort() & ~1;
+        state.fd = bindUdp(client_port);
+        rtcp_fd = (state.fd >= 0) ? bindUdp(client_port + 1) : -1;
+        if (state.fd >= 0 && rtcp_fd < 0)
+        {
+            close(state.fd);
+            state.fd = -1;
+        }
+    } while (state.fd < 0);
+
+    fd = testRtspConnect(server->port, 0);
+    TEST_CHECK(fd >= 0);
+    snprintf(transport, sizeof(transport), "RTP/AVP;unicast;client_port=%u-%u", client_port, client_port + 1);
+    TEST_CHECK(testRtspPlay(fd, server->port, "/egress", transport, session, sizeof(session)));
+    pusher = g_thread_new("push", pushLoop, &state);
+    receiver = g_thread_new("receive", receiveLoop, &state);
+
+    testSleepMs(1000);
+    packets = __atomic_load_n(&state.packets, __ATOMIC_RELAXED);
+    bytes = __atomic_load_n(&state.bytes, __ATOMIC_RELAXED);
+    cpu = cpuSeconds();
+    testSleepMs(SECONDS * 1000);
+    cpu = cpuSeconds() - cpu;
+    packets = __atomic_load_n(&state.packets, __ATOMIC_RELAXED) - packets;
+    bytes = __atomic_load_n(&state.bytes, __ATOMIC_RELAXED) - bytes;
+    __atomic_store_n(&state.stopped, 1, __ATOMIC_SEQ_CST);
+    g_thread_join(pusher);
+    g_thread_join(receiver);
+
+    // the process CPU includes the receiving thread, which is the same in both runs
+    cpu_per_gbit = (bytes > 0) ? cpu / (bytes * 8.0 / 1e9) : 0.0;
+    printf("offload %s: %.0f packets/s, %.1f Mbit/s, %.2f CPU s per Gbit, %llu invalid\n", offload ? "on " : "off",
+           (double)packets / SECONDS, bytes * 8.0 / SECONDS / 1e6, cpu_per_gbit, (unsigned long long)state.invalid);
+    TEST_CHECK(packets > 0);
+    TEST_CHECK(state.invalid == 0);
+
+    close(fd);
+    close(rtcp_fd);
+    close(state.fd);
+    TEST_CHECK(cuRTSPSessionUnmount(state.session, server->server, "/egress") == CUDA_SUCCESS);
+    cuRTSPSessionDestroy(state.session);
+
+    return cpu_per_gbit;
+}
+
+int main(void)
+{
+    test_server server;
+    test_access_unit *units;
+    double plain;
+    double offloaded;
+
+    testInit();
+    units = testAccessUnitsEncode(WIDTH, HEIGHT, UNITS, BITRATE, UNITS);
+    testServerStart(&server, NULL);
+
+    plain = run(&server, units, false);
+    offloaded = run(&server, units, true);
+    if (segmentationSupported())
+    {
+        TEST_CHECK(offloaded < plain);
+    }
+    else
+    {
+        printf("UDP_SEGMENT is not supported, both runs sent one datagram per packet\n");
+    }
+
+    testServerStop(&server);
+    testAccessUnitsFree(units, UNITS);
+    cuRTSPDeinit();
+
+    return 0;
+}